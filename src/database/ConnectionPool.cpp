@@ -0,0 +1,351 @@
+/**
+ * @file ConnectionPool.cpp
+ * @brief Bounded pool of MySQL connections shared by the database threads
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "ConnectionPool.h"
+#include "DatabaseManager.h"
+#include "DatabaseQueries.h"
+#include <QObject>
+#include <QThread>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDebug>
+
+PooledConnection::~PooledConnection()
+{
+    release();
+}
+
+PooledConnection::PooledConnection(PooledConnection&& other) noexcept
+    : m_name(std::move(other.m_name))
+{
+    other.m_name.clear();
+}
+
+PooledConnection& PooledConnection::operator=(PooledConnection&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_name = std::move(other.m_name);
+        other.m_name.clear();
+    }
+    return *this;
+}
+
+QSqlDatabase PooledConnection::database() const
+{
+    return QSqlDatabase::database(m_name, false);
+}
+
+void PooledConnection::release()
+{
+    if (!m_name.isEmpty()) {
+        ConnectionPool::getInstance().release(m_name);
+        m_name.clear();
+    }
+}
+
+ConnectionPool& ConnectionPool::getInstance()
+{
+    static ConnectionPool instance;
+    return instance;
+}
+
+void ConnectionPool::registerThread(QObject* context)
+{
+    QMutexLocker locker(&m_mutex);
+    m_contexts.insert(QThread::currentThread(), context);
+}
+
+PooledConnection ConnectionPool::acquire()
+{
+    const DatabaseManager::PoolConfig& config = DatabaseManager::PoolConfig::instance;
+    QThread* thread = QThread::currentThread();
+
+    QElapsedTimer waitTimer;
+    bool waited = false;
+    bool evicted = false;
+
+    dropExpired(thread);
+
+    QMutexLocker locker(&m_mutex);
+    forever {
+        QList<IdleConnection>& idle = m_idle[thread];
+        if (!idle.isEmpty()) {
+            // Ostatnio zwrócone połączenie jest najpewniej wciąż żywe
+            IdleConnection connection = idle.takeLast();
+            ++m_inUse;
+            locker.unlock();
+
+            bool stale = QDateTime::currentMSecsSinceEpoch() - connection.releasedAt
+                         > config.validationInterval;
+            if (stale && !validate(connection.name)) {
+                dropConnection(connection.name);
+                locker.relock();
+                --m_inUse;
+                --m_total;
+                m_owners.remove(connection.name);
+                ++m_metrics.validationFailures;
+                continue;
+            }
+
+            locker.relock();
+            ++m_metrics.acquired;
+            if (waited) {
+                qint64 elapsed = waitTimer.elapsed();
+                m_metrics.totalWaitMs += elapsed;
+                m_metrics.maxWaitMs = qMax(m_metrics.maxWaitMs, elapsed);
+            }
+            return PooledConnection(connection.name);
+        }
+
+        if (m_total < config.maxSize) {
+            QString name = QString("Pool_%1").arg(++m_nextId);
+            ++m_total;
+            ++m_inUse;
+            m_owners.insert(name, thread);
+            locker.unlock();
+
+            bool opened = openConnection(name);
+
+            locker.relock();
+            if (!opened) {
+                --m_total;
+                --m_inUse;
+                m_owners.remove(name);
+                m_available.wakeOne();
+                return PooledConnection();
+            }
+
+            ++m_metrics.created;
+            ++m_metrics.acquired;
+            if (waited) {
+                qint64 elapsed = waitTimer.elapsed();
+                m_metrics.totalWaitMs += elapsed;
+                m_metrics.maxWaitMs = qMax(m_metrics.maxWaitMs, elapsed);
+            }
+            return PooledConnection(name);
+        }
+
+        // Limit osiągnięty - zwalniamy miejsce po wolnym połączeniu innego
+        // wątku (zamknie je właściciel) albo czekamy na zwrot
+        if (!evicted) {
+            evicted = expireForeignIdle(thread);
+        }
+        if (!waited) {
+            waited = true;
+            waitTimer.start();
+            ++m_metrics.waits;
+        }
+
+        qint64 remaining = config.acquireTimeout - waitTimer.elapsed();
+        if (remaining <= 0) {
+            ++m_metrics.timeouts;
+            qWarning() << "Timed out waiting for a database connection after"
+                       << waitTimer.elapsed() << "ms";
+            return PooledConnection();
+        }
+
+        ++m_metrics.waiting;
+        m_available.wait(&m_mutex, static_cast<unsigned long>(remaining));
+        --m_metrics.waiting;
+    }
+}
+
+void ConnectionPool::release(const QString& name)
+{
+    QMutexLocker locker(&m_mutex);
+    --m_inUse;
+    m_idle[m_owners.value(name)].append({name, QDateTime::currentMSecsSinceEpoch()});
+    m_available.wakeOne();
+}
+
+bool ConnectionPool::expireForeignIdle(QThread* thread)
+{
+    // Wywoływane pod blokadą; wybiera najdłużej nieużywane połączenie innego
+    // wątku. Miejsce w limicie zwolni się dopiero po zamknięciu go przez właściciela.
+    QThread* oldestOwner = nullptr;
+    qint64 oldestReleasedAt = 0;
+    for (auto it = m_idle.constBegin(); it != m_idle.constEnd(); ++it) {
+        if (it.key() == thread || it.value().isEmpty()) {
+            continue;
+        }
+        if (!oldestOwner || it.value().first().releasedAt < oldestReleasedAt) {
+            oldestOwner = it.key();
+            oldestReleasedAt = it.value().first().releasedAt;
+        }
+    }
+
+    if (!oldestOwner) {
+        return false;
+    }
+
+    expire(oldestOwner, m_idle[oldestOwner].takeFirst().name);
+    return true;
+}
+
+void ConnectionPool::expire(QThread* owner, const QString& name)
+{
+    // Wywoływane pod blokadą
+    m_owners.remove(name);
+    m_expired[owner].append(name);
+    ++m_expiredCount;
+
+    QObject* context = m_contexts.value(owner);
+    if (context) {
+        QMetaObject::invokeMethod(context, [owner]() {
+            ConnectionPool::getInstance().dropExpired(owner);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void ConnectionPool::dropExpired(QThread* thread)
+{
+    QStringList expired;
+    {
+        QMutexLocker locker(&m_mutex);
+        expired = m_expired.take(thread);
+    }
+
+    if (expired.isEmpty()) {
+        return;
+    }
+
+    for (const QString& name : expired) {
+        dropConnection(name);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_total -= expired.size();
+    m_expiredCount -= expired.size();
+    m_available.wakeAll();
+}
+
+void ConnectionPool::closeThreadConnections()
+{
+    QThread* thread = QThread::currentThread();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_contexts.remove(thread);
+        const QList<IdleConnection> idle = m_idle.take(thread);
+        for (const IdleConnection& connection : idle) {
+            expire(thread, connection.name);
+        }
+    }
+    dropExpired(thread);
+}
+
+void ConnectionPool::reapIdle()
+{
+    const DatabaseManager::PoolConfig& config = DatabaseManager::PoolConfig::instance;
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int reaped = 0;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+            QList<IdleConnection>& idle = it.value();
+            // Listy są uporządkowane od najdawniej zwróconego połączenia
+            while (!idle.isEmpty() && m_total - m_expiredCount > config.minSize
+                   && now - idle.first().releasedAt > config.idleTimeout) {
+                // Reaper działa w głównym wątku - zamknięcie zostawiamy właścicielowi
+                expire(it.key(), idle.takeFirst().name);
+                ++m_metrics.reaped;
+                ++reaped;
+            }
+        }
+    }
+
+    Metrics current = metrics();
+    qDebug() << "Connection pool: total" << current.total << "idle" << current.idle
+             << "in use" << current.inUse << "waits" << current.waits
+             << "timeouts" << current.timeouts << "max wait" << current.maxWaitMs << "ms"
+             << "reaped" << reaped;
+}
+
+void ConnectionPool::clear()
+{
+    QStringList names;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const QList<IdleConnection>& idle : std::as_const(m_idle)) {
+            for (const IdleConnection& connection : idle) {
+                names.append(connection.name);
+                m_owners.remove(connection.name);
+            }
+        }
+        m_idle.clear();
+        for (const QStringList& expired : std::as_const(m_expired)) {
+            names.append(expired);
+        }
+        m_expired.clear();
+        m_expiredCount = 0;
+        m_contexts.clear();
+        m_total -= names.size();
+    }
+
+    for (const QString& name : names) {
+        dropConnection(name);
+    }
+}
+
+ConnectionPool::Metrics ConnectionPool::metrics() const
+{
+    QMutexLocker locker(&m_mutex);
+    Metrics result = m_metrics;
+    result.total = m_total;
+    result.inUse = m_inUse;
+    result.idle = m_total - m_inUse - m_expiredCount;
+    return result;
+}
+
+bool ConnectionPool::openConnection(const QString& name)
+{
+    const DatabaseManager::DatabaseConfig& config = DatabaseManager::DatabaseConfig::instance;
+    bool opened;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL", name);
+        db.setHostName(config.hostname);
+        db.setDatabaseName(config.database);
+        db.setUserName(config.username);
+        db.setPassword(config.password);
+        db.setPort(config.port);
+
+        opened = db.open();
+        if (!opened) {
+            qWarning() << "Failed to open pooled connection" << name << "-" << db.lastError().text();
+        }
+    }
+
+    if (!opened) {
+        QSqlDatabase::removeDatabase(name);
+    }
+    return opened;
+}
+
+bool ConnectionPool::validate(const QString& name)
+{
+    QSqlDatabase db = QSqlDatabase::database(name, false);
+    if (!db.isOpen() && !db.open()) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec(DatabaseQueries::Pool::VALIDATE)) {
+        qWarning() << "Pooled connection" << name << "failed validation:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void ConnectionPool::dropConnection(const QString& name)
+{
+    // Tylko w wątku, który otworzył połączenie (albo po jego zakończeniu) -
+    // Qt nie pozwala zamykać połączeń z innych wątków
+    QSqlDatabase::removeDatabase(name);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file ConnectionPool.h
+ * @brief Bounded pool of MySQL connections shared by the database threads
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QSqlDatabase>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+
+class QObject;
+class QThread;
+class ConnectionPool;
+
+// Wypożyczone połączenie; zwracane do puli w destruktorze
+class PooledConnection
+{
+public:
+    PooledConnection() = default;
+    ~PooledConnection();
+
+    PooledConnection(PooledConnection&& other) noexcept;
+    PooledConnection& operator=(PooledConnection&& other) noexcept;
+    PooledConnection(const PooledConnection&) = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
+
+    bool isValid() const { return !m_name.isEmpty(); }
+    QSqlDatabase database() const;
+    void release();
+
+private:
+    friend class ConnectionPool;
+    explicit PooledConnection(const QString& name) : m_name(name) {}
+
+    QString m_name;
+};
+
+// Połączenia QSqlDatabase są związane z wątkiem, który je otworzył, dlatego
+// wolne połączenia są trzymane osobno dla każdego wątku. Gdy wątek nie ma
+// własnego wolnego połączenia, a limit został osiągnięty, przejmuje miejsce
+// po wolnym połączeniu innego wątku albo czeka na zwrot.
+// Połączenie można zamknąć tylko w wątku właściciela: przejęte i wygasłe
+// połączenia liczą się do limitu, dopóki właściciel ich nie zamknie - zamknięcie
+// jest zlecane kolejkowanym wywołaniem na jego obiekcie kontekstu (registerThread),
+// a bez kontekstu wykonuje się przy najbliższym acquire wątku właściciela.
+class ConnectionPool
+{
+public:
+    struct Metrics {
+        int total = 0;
+        int idle = 0;
+        int inUse = 0;
+        int waiting = 0;
+        quint64 acquired = 0;
+        quint64 created = 0;
+        quint64 waits = 0;
+        quint64 timeouts = 0;
+        quint64 validationFailures = 0;
+        quint64 reaped = 0;
+        qint64 totalWaitMs = 0;
+        qint64 maxWaitMs = 0;
+    };
+
+    static ConnectionPool& getInstance();
+
+    // Obiekt żyjący w bieżącym wątku, przez który pula zleca zamykanie jego połączeń
+    void registerThread(QObject* context);
+    PooledConnection acquire();
+    void reapIdle();
+    // Zamyka wolne i wygasłe połączenia bieżącego wątku - przed jego zakończeniem
+    void closeThreadConnections();
+    // Po zakończeniu wszystkich wątków, które otwierały połączenia
+    void clear();
+    Metrics metrics() const;
+
+private:
+    friend class PooledConnection;
+
+    struct IdleConnection {
+        QString name;
+        qint64 releasedAt;
+    };
+
+    ConnectionPool() = default;
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    void release(const QString& name);
+    bool openConnection(const QString& name);
+    bool validate(const QString& name);
+    static void dropConnection(const QString& name);
+    void dropExpired(QThread* thread);
+    bool expireForeignIdle(QThread* thread);
+    void expire(QThread* owner, const QString& name);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_available;
+    QHash<QThread*, QList<IdleConnection>> m_idle;
+    QHash<QString, QThread*> m_owners;
+    QHash<QThread*, QStringList> m_expired;  // do zamknięcia w wątku właściciela
+    QHash<QThread*, QObject*> m_contexts;
+    int m_total = 0;      // razem z wygasłymi, jeszcze niezamkniętymi
+    int m_expiredCount = 0;
+    int m_inUse = 0;
+    quint64 m_nextId = 0;
+    Metrics m_metrics;
+};
+
+#endif // CONNECTIONPOOL_H
@@ -0,0 +1,35 @@
+/**
+ * @file ConversationHeads.cpp
+ * @brief Newest message id of each conversation kept in memory
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "ConversationHeads.h"
+
+ConversationHeads& ConversationHeads::getInstance()
+{
+    static ConversationHeads instance;
+    return instance;
+}
+
+qint64 ConversationHeads::head(qint64 conversationId) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_heads.value(conversationId, UNKNOWN);
+}
+
+void ConversationHeads::raise(qint64 conversationId, qint64 messageId)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64& head = m_heads[conversationId];
+    if (messageId > head) {
+        head = messageId;
+    }
+}
+
+void ConversationHeads::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_heads.clear();
+}
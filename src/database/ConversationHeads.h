@@ -0,0 +1,38 @@
+/**
+ * @file ConversationHeads.h
+ * @brief Newest message id of each conversation kept in memory
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef CONVERSATIONHEADS_H
+#define CONVERSATIONHEADS_H
+
+#include <QHash>
+#include <QMutex>
+
+// Id najnowszej wiadomości w rozmowie (conversations.last_message_id) wspólne
+// dla wszystkich wątków bazy. Razem z kursorami odczytu wyznacza liczbę
+// nieprzeczytanych wiadomości bez przeglądania tabeli wiadomości.
+class ConversationHeads
+{
+public:
+    static constexpr qint64 UNKNOWN = -1;
+
+    static ConversationHeads& getInstance();
+
+    qint64 head(qint64 conversationId) const;
+    // Wartość tylko rośnie - zapisy z różnych wątków mogą przyjść w dowolnej kolejności
+    void raise(qint64 conversationId, qint64 messageId);
+    void clear();
+
+private:
+    ConversationHeads() = default;
+    ConversationHeads(const ConversationHeads&) = delete;
+    ConversationHeads& operator=(const ConversationHeads&) = delete;
+
+    mutable QMutex m_mutex;
+    QHash<qint64, qint64> m_heads;
+};
+
+#endif // CONVERSATIONHEADS_H
@@ -1,5 +1,11 @@
 #include "DatabaseManager.h"
 #include "DatabaseQueries.h"
+#include "FriendGraph.h"
+#include "ConversationHeads.h"
+#include "SyncVersions.h"
+#include "RecentMessageCache.h"
+#include "UserDirectory.h"
+#include "UsernameIndex.h"
 #include "network/Protocol.h"
 #include <QCryptographicHash>
 #include <QDateTime>
@@ -8,11 +14,36 @@
 #include <QSqlError>
 #include <QDebug>
 #include <QSettings>
+#include <QSet>
 #include <QFile>
 #include <QDir>
+#include <algorithm>
+#include <limits>
 
 DatabaseManager::DatabaseConfig DatabaseManager::DatabaseConfig::instance;
+DatabaseManager::PoolConfig DatabaseManager::PoolConfig::instance;
+DatabaseManager::MigrationConfig DatabaseManager::MigrationConfig::instance;
+DatabaseManager::GroupCommitConfig DatabaseManager::GroupCommitConfig::instance;
+DatabaseManager::JournalConfig DatabaseManager::JournalConfig::instance;
+DatabaseManager::RecentMessagesConfig DatabaseManager::RecentMessagesConfig::instance;
 bool DatabaseManager::mainInitialized = false;
+std::atomic<DatabaseManager::MessageStorage> DatabaseManager::storageMode{DatabaseManager::MessageStorage::Legacy};
+
+namespace {
+
+// Znajomi na jedno zapytanie liczników w trybie Legacy
+constexpr int UNREAD_CHUNK_SIZE = 200;
+
+// "(?, ?), (?, ?), ..." dla wielowierszowego INSERT
+QString placeholderRows(int rows, int columns)
+{
+    QStringList marks(columns, QStringLiteral("?"));
+    QString row = QLatin1Char('(') + marks.join(QLatin1String(", ")) + QLatin1Char(')');
+    QStringList all(rows, row);
+    return all.join(QLatin1String(", "));
+}
+
+}
 
 DatabaseManager::DatabaseManager(QObject *parent)
     : QObject(parent)
@@ -63,6 +94,52 @@ bool DatabaseManager::init()
     DatabaseConfig::instance.username = settings.value("Database/username").toString();
     DatabaseConfig::instance.password = settings.value("Database/password").toString();
     DatabaseConfig::instance.port = settings.value("Database/port").toInt();
+    DatabaseConfig::instance.workerThreads = settings.value("Database/worker_threads",
+                                                            DatabaseConfig::instance.workerThreads).toInt();
+
+    PoolConfig& pool = PoolConfig::instance;
+    pool.minSize = qMax(0, settings.value("Pool/min_size", pool.minSize).toInt());
+    pool.maxSize = qMax(qMax(1, pool.minSize), settings.value("Pool/max_size", pool.maxSize).toInt());
+    pool.idleTimeout = settings.value("Pool/idle_timeout_ms", pool.idleTimeout).toInt();
+    pool.validationInterval = settings.value("Pool/validation_interval_ms", pool.validationInterval).toInt();
+    pool.acquireTimeout = settings.value("Pool/acquire_timeout_ms", pool.acquireTimeout).toInt();
+
+    MigrationConfig& migration = MigrationConfig::instance;
+    QString storage = settings.value("Migration/messages", "consolidated").toString().trimmed().toLower();
+    if (storage == "legacy") {
+        migration.messageStorage = MessageStorage::Legacy;
+    } else if (storage == "dual_write") {
+        migration.messageStorage = MessageStorage::DualWrite;
+    } else {
+        migration.messageStorage = MessageStorage::Consolidated;
+    }
+    migration.backfillBatchSize = qMax(1, settings.value("Migration/backfill_batch_size",
+                                                         migration.backfillBatchSize).toInt());
+
+    // Górna granica trzyma liczbę parametrów INSERT daleko od limitu MySQL (65535)
+    GroupCommitConfig& groupCommit = GroupCommitConfig::instance;
+    groupCommit.maxBatchSize = qBound(1, settings.value("GroupCommit/max_batch_size",
+                                                        groupCommit.maxBatchSize).toInt(), 1000);
+    groupCommit.lingerMs = qMax(0, settings.value("GroupCommit/linger_ms", groupCommit.lingerMs).toInt());
+    groupCommit.slowFlushMs = qMax(1, settings.value("GroupCommit/slow_flush_ms",
+                                                     groupCommit.slowFlushMs).toInt());
+
+    JournalConfig& journal = JournalConfig::instance;
+    journal.enabled = settings.value("Journal/enabled", journal.enabled).toBool();
+    journal.directory = settings.value("Journal/directory", journal.directory).toString();
+    journal.name = settings.value("Journal/name", journal.name).toString();
+    journal.segmentSize = qMax<qint64>(4096, settings.value("Journal/segment_size_bytes",
+                                                            journal.segmentSize).toLongLong());
+    journal.drainBatchSize = qBound(1, settings.value("Journal/drain_batch_size",
+                                                      journal.drainBatchSize).toInt(), 1000);
+    journal.retryInterval = qMax(10, settings.value("Journal/retry_interval_ms",
+                                                    journal.retryInterval).toInt());
+
+    RecentMessagesConfig& recent = RecentMessagesConfig::instance;
+    recent.perConversation = qBound(0, settings.value("RecentMessages/per_conversation",
+                                                      recent.perConversation).toInt(), 1000);
+    recent.budgetBytes = qMax<qint64>(0, settings.value("RecentMessages/budget_bytes",
+                                                        recent.budgetBytes).toLongLong());
 
     // Sprawdź czy wszystkie wymagane wartości są ustawione
     if (DatabaseConfig::instance.hostname.isEmpty() ||
@@ -111,6 +188,34 @@ bool DatabaseManager::createTablesIfNotExist()
             throw std::runtime_error("Failed to create users table: " + query.lastError().text().toStdString());
         }
 
+        if (!query.exec(DatabaseQueries::Create::FRIENDSHIPS_TABLE)) {
+            throw std::runtime_error("Failed to create friendships table: " + query.lastError().text().toStdString());
+        }
+
+        if (!query.exec(DatabaseQueries::Create::FRIEND_INVITATIONS_TABLE)) {
+            throw std::runtime_error("Failed to create friend invitations table: " + query.lastError().text().toStdString());
+        }
+
+        if (!query.exec(DatabaseQueries::Create::CONVERSATIONS_TABLE)) {
+            throw std::runtime_error("Failed to create conversations table: " + query.lastError().text().toStdString());
+        }
+
+        if (!query.exec(DatabaseQueries::Create::CONVERSATION_MESSAGES_TABLE)) {
+            throw std::runtime_error("Failed to create conversation messages table: " + query.lastError().text().toStdString());
+        }
+
+        if (!query.exec(DatabaseQueries::Create::READ_CURSORS_TABLE)) {
+            throw std::runtime_error("Failed to create read cursors table: " + query.lastError().text().toStdString());
+        }
+
+        if (!query.exec(DatabaseQueries::Create::JOURNAL_CHECKPOINTS_TABLE)) {
+            throw std::runtime_error("Failed to create journal checkpoints table: " + query.lastError().text().toStdString());
+        }
+
+        if (!query.exec(DatabaseQueries::Create::SCHEMA_MIGRATIONS_TABLE)) {
+            throw std::runtime_error("Failed to create schema migrations table: " + query.lastError().text().toStdString());
+        }
+
         /*if (!query.exec(DatabaseQueries::Create::SESSIONS_TABLE)) {
             throw std::runtime_error("Failed to create sessions table: " + query.lastError().text().toStdString());
         }*/
@@ -130,6 +235,11 @@ bool DatabaseManager::createTablesIfNotExist()
 }
 
 bool DatabaseManager::authenticateUser(const QString& username, const QString& password, quint32& userId)
+{
+    return verifyCredentials(username, password, userId) && updateUserStatus(userId, "online");
+}
+
+bool DatabaseManager::verifyCredentials(const QString& username, const QString& password, quint32& userId)
 {
     qDebug() << "=== Starting authentication for user:" << username << "===";
 
@@ -142,12 +252,6 @@ bool DatabaseManager::authenticateUser(const QString& username, const QString& p
         }
     }
 
-    if (!database.transaction()) {
-        qWarning() << "Failed to start transaction for user authentication";
-        qWarning() << "Transaction error:" << database.lastError().text();
-        return false;
-    }
-
     try {
         QSqlQuery query(database);
         query.prepare(DatabaseQueries::Users::AUTHENTICATE);
@@ -188,19 +292,10 @@ bool DatabaseManager::authenticateUser(const QString& username, const QString& p
             throw std::runtime_error("Invalid password");
         }
 
-        if (!updateUserStatus(userId, "online")) {
-            throw std::runtime_error("Failed to update user status");
-        }
-
-        if (!database.commit()) {
-            throw std::runtime_error("Failed to commit transaction");
-        }
-
         return true;
     }
     catch (const std::exception& e) {
         qWarning() << "Authentication error:" << e.what();
-        database.rollback();
         return false;
     }
 }
@@ -242,19 +337,11 @@ bool DatabaseManager::registerUser(const QString& username, const QString& passw
         // Pobierz ID nowo utworzonego użytkownika
         quint32 userId = query.lastInsertId().toUInt();
 
-        // Utwórz tabelę przyjaciół dla nowego użytkownika
-        if (!createFriendsList(userId)) {
-            throw std::runtime_error("Failed to create friends list table");
-        }
-
-        // Utwórz tabele zaproszeń dla nowego użytkownika
-        if (!createInvitationTables(userId)) {
-            throw std::runtime_error("Failed to create invitation tables");
-        }
-
         if (!database.commit()) {
             throw std::runtime_error("Failed to commit registration");
         }
+        UserDirectory::getInstance().add(userId, username);
+        UsernameIndex::getInstance().add(userId, username);
 
         qDebug() << "Successfully registered user:" << username << "with ID:" << userId;
         return true;
@@ -350,37 +437,235 @@ bool DatabaseManager::updateUserStatus(quint32 userId, const QString& status)
     }
 }
 
-bool DatabaseManager::storeMessage(quint32 senderId, quint32 receiverId, const QString& message)
+bool DatabaseManager::updateUserStatuses(const QHash<quint32, QString>& statuses)
 {
-    if (!createChatTableIfNotExists(senderId, receiverId)) {
+    if (statuses.isEmpty()) {
+        return true;
+    }
+
+    if (!database.transaction()) {
+        qWarning() << "Failed to start transaction for batched status update";
         return false;
     }
 
+    try {
+        // Jedno zapytanie na paczkę: CASE id WHEN ? THEN ? ... END WHERE id IN (...)
+        QList<quint32> userIds = statuses.keys();
+        for (int start = 0; start < userIds.size(); start += STATUS_BATCH_SIZE) {
+            QList<quint32> batch = userIds.mid(start, STATUS_BATCH_SIZE);
+
+            QStringList cases;
+            QStringList placeholders;
+            for (int i = 0; i < batch.size(); ++i) {
+                cases.append("WHEN ? THEN ?");
+                placeholders.append("?");
+            }
+
+            QSqlQuery query(database);
+            query.prepare(DatabaseQueries::Users::UPDATE_STATUS_BATCH
+                              .arg(cases.join(' '), placeholders.join(", ")));
+            for (quint32 userId : batch) {
+                query.addBindValue(userId);
+                query.addBindValue(statuses.value(userId));
+            }
+            for (quint32 userId : batch) {
+                query.addBindValue(userId);
+            }
+
+            if (!query.exec()) {
+                throw std::runtime_error("Failed to update user statuses: " + query.lastError().text().toStdString());
+            }
+        }
+
+        if (!database.commit()) {
+            throw std::runtime_error("Failed to commit status update");
+        }
+
+        qDebug() << "Flushed statuses of" << statuses.size() << "users";
+        return true;
+    }
+    catch (const std::exception& e) {
+        qWarning() << "Batched status update error:" << e.what();
+        database.rollback();
+        return false;
+    }
+}
+
+bool DatabaseManager::resetUserStatuses()
+{
+    QSqlQuery query(database);
+    if (!query.exec(DatabaseQueries::Users::RESET_STATUSES)) {
+        qWarning() << "Failed to reset user statuses:" << query.lastError().text();
+        return false;
+    }
+
+    qDebug() << "Reset status of" << query.numRowsAffected() << "users to offline";
+    return true;
+}
+
+bool DatabaseManager::storeMessage(quint32 senderId, quint32 receiverId, const QString& message, quint64 globalId)
+{
+    QVector<OutgoingMessage> messages{{senderId, receiverId, message, QDateTime(), globalId}};
+    return storeMessages(messages);
+}
+
+bool DatabaseManager::storeMessages(QVector<OutgoingMessage>& messages,
+                                    const QString& journal, quint64 journalSequence)
+{
+    if (messages.isEmpty()) {
+        return true;
+    }
+
+    const MessageStorage mode = messageStorage();
+    const QDateTime now = QDateTime::currentDateTime();
+    for (OutgoingMessage& outgoing : messages) {
+        if (!outgoing.sentAt.isValid()) {
+            outgoing.sentAt = now;
+        }
+    }
+
+    // Indeksy wiadomości pogrupowane po parze, w kolejności kluczy - stała
+    // kolejność blokad wierszy conversations między transakcjami
+    QHash<quint64, QVector<int>> rowsByPair;
+    for (int i = 0; i < messages.size(); ++i) {
+        quint32 low = qMin(messages[i].senderId, messages[i].receiverId);
+        quint32 high = qMax(messages[i].senderId, messages[i].receiverId);
+        rowsByPair[(quint64(low) << 32) | high].append(i);
+    }
+    QVector<quint64> pairs(rowsByPair.keyBegin(), rowsByPair.keyEnd());
+    std::sort(pairs.begin(), pairs.end());
+
+    // DDL i rozmowy tworzymy przed transakcją - CREATE TABLE zatwierdza ją niejawnie,
+    // a wycofana rozmowa zostałaby w conversationCache
+    QHash<quint64, qint64> conversations;
+    for (quint64 pair : pairs) {
+        const OutgoingMessage& first = messages[rowsByPair[pair].first()];
+        if (mode != MessageStorage::Consolidated &&
+            !createChatTableIfNotExists(first.senderId, first.receiverId)) {
+            return false;
+        }
+        if (mode != MessageStorage::Legacy) {
+            qint64 conversation = conversationId(first.senderId, first.receiverId, true);
+            if (conversation == 0) {
+                return false;
+            }
+            conversations.insert(pair, conversation);
+        }
+    }
+
     if (!database.transaction()) {
-        qWarning() << "Failed to start transaction for storing message";
+        qWarning() << "Failed to start transaction for storing messages";
         return false;
     }
 
     try {
-        QString tableName = getChatTableName(senderId, receiverId);
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Messages::STORE_IN_CHAT.arg(tableName));
-        query.addBindValue(senderId);
-        query.addBindValue(message);
 
-        if (!query.exec()) {
-            throw std::runtime_error("Failed to store message: " + query.lastError().text().toStdString());
+        for (quint64 pair : pairs) {
+            const QVector<int>& rows = rowsByPair[pair];
+
+            if (mode != MessageStorage::Consolidated) {
+                const OutgoingMessage& first = messages[rows.first()];
+                query.prepare(DatabaseQueries::Messages::STORE_ROWS_IN_CHAT
+                                  .arg(getChatTableName(first.senderId, first.receiverId),
+                                       placeholderRows(rows.size(), 3)));
+                for (int row : rows) {
+                    query.addBindValue(messages[row].senderId);
+                    query.addBindValue(messages[row].message);
+                    query.addBindValue(messages[row].sentAt);
+                }
+                if (!query.exec()) {
+                    throw std::runtime_error("Failed to store messages: " + query.lastError().text().toStdString());
+                }
+                qint64 firstId = query.lastInsertId().toLongLong();
+                for (int i = 0; i < rows.size(); ++i) {
+                    messages[rows[i]].id = firstId + i;
+                }
+            }
+
+            if (mode == MessageStorage::Legacy) {
+                continue;
+            }
+
+            qint64 conversation = conversations.value(pair);
+            if (mode == MessageStorage::Consolidated) {
+                query.prepare(DatabaseQueries::Conversations::ALLOCATE_MESSAGE_IDS);
+                query.addBindValue(rows.size());
+                query.addBindValue(conversation);
+                if (!query.exec() || query.numRowsAffected() == 0 ||
+                    !query.exec(DatabaseQueries::Conversations::LAST_INSERT_ID) || !query.next()) {
+                    throw std::runtime_error("Failed to allocate message ids: " + query.lastError().text().toStdString());
+                }
+                qint64 firstId = query.value(0).toLongLong() - rows.size() + 1;
+                for (int i = 0; i < rows.size(); ++i) {
+                    messages[rows[i]].id = firstId + i;
+                }
+            } else {
+                // Zapis podwójny zachowuje id z chat_X_Y, żeby kursory klientów przetrwały przełączenie
+                query.prepare(DatabaseQueries::Conversations::RAISE_MESSAGE_ID);
+                query.addBindValue(messages[rows.last()].id);
+                query.addBindValue(conversation);
+                if (!query.exec()) {
+                    throw std::runtime_error("Failed to raise conversation message id: " + query.lastError().text().toStdString());
+                }
+            }
+        }
+
+        if (mode != MessageStorage::Legacy) {
+            query.prepare(DatabaseQueries::Conversations::STORE_MESSAGES
+                              .arg(placeholderRows(messages.size(), 6)));
+            for (const OutgoingMessage& outgoing : messages) {
+                quint32 low = qMin(outgoing.senderId, outgoing.receiverId);
+                quint32 high = qMax(outgoing.senderId, outgoing.receiverId);
+                qint64 conversation = conversations.value((quint64(low) << 32) | high);
+                query.addBindValue(conversation);
+                query.addBindValue(outgoing.id);
+                query.addBindValue(outgoing.senderId);
+                query.addBindValue(outgoing.message);
+                query.addBindValue(outgoing.sentAt);
+                query.addBindValue(outgoing.globalId != 0 ? QVariant(outgoing.globalId) : QVariant());
+            }
+            if (!query.exec()) {
+                throw std::runtime_error("Failed to store conversation messages: " + query.lastError().text().toStdString());
+            }
+        }
+
+        if (!journal.isEmpty()) {
+            query.prepare(DatabaseQueries::Journal::SET_CHECKPOINT);
+            query.addBindValue(journal);
+            query.addBindValue(journalSequence);
+            if (!query.exec()) {
+                throw std::runtime_error("Failed to update journal checkpoint: " + query.lastError().text().toStdString());
+            }
         }
 
         if (!database.commit()) {
             throw std::runtime_error("Failed to commit message storage");
         }
 
+        // Najpierw czoło, potem pamięć podręczna - RecentMessageCache::load na tym polega
+        ConversationHeads& heads = ConversationHeads::getInstance();
+        RecentMessageCache& recent = RecentMessageCache::getInstance();
+        for (quint64 pair : pairs) {
+            if (!conversations.contains(pair)) {
+                continue;
+            }
+            qint64 conversation = conversations.value(pair);
+            heads.raise(conversation, messages[rowsByPair[pair].last()].id);
+            for (int row : rowsByPair[pair]) {
+                const OutgoingMessage& stored = messages[row];
+                recent.append(conversation, {stored.id, stored.senderId, stored.message, stored.sentAt,
+                                             stored.globalId});
+            }
+        }
         return true;
     }
     catch (const std::exception& e) {
         qWarning() << "Message storage error:" << e.what();
         database.rollback();
+        for (OutgoingMessage& outgoing : messages) {
+            outgoing.id = 0;
+        }
         return false;
     }
 }
@@ -397,12 +682,9 @@ bool DatabaseManager::addFriend(quint32 userId, quint32 friendId)
             throw std::runtime_error("Invalid user or friend ID");
         }
 
-        if (!createFriendsList(userId)) {
-            throw std::runtime_error("Failed to create friends list");
-        }
-
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Friends::ADD.arg(userId));
+        query.prepare(DatabaseQueries::Friends::ADD);
+        query.addBindValue(userId);
         query.addBindValue(friendId);
 
         if (!query.exec()) {
@@ -413,6 +695,11 @@ bool DatabaseManager::addFriend(quint32 userId, quint32 friendId)
             throw std::runtime_error("Failed to commit adding friend");
         }
 
+        FriendGraph& graph = FriendGraph::getInstance();
+        if (graph.isLoaded()) {
+            graph.addFriend(userId, friendId, getUserUsername(friendId));
+        }
+        SyncVersions::getInstance().friendsChanged(userId);
         return true;
     }
     catch (const std::exception& e) {
@@ -426,6 +713,18 @@ QVector<QPair<quint32, QString>> DatabaseManager::getFriendsList(quint32 userId)
 {
     QVector<QPair<quint32, QString>> friendsList;
 
+    // Po wczytaniu grafu lista znajomych nie wymaga zapytania
+    const FriendGraph& graph = FriendGraph::getInstance();
+    if (graph.isLoaded()) {
+        for (quint32 friendId : graph.friendsOf(userId)) {
+            friendsList.append({friendId, graph.username(friendId)});
+        }
+        std::sort(friendsList.begin(), friendsList.end(), [](const auto& a, const auto& b) {
+            return a.second < b.second;
+        });
+        return friendsList;
+    }
+
     qDebug() << "Getting friends list for user:" << userId;  // Debug log
 
     if (!database.transaction()) {
@@ -434,12 +733,11 @@ QVector<QPair<quint32, QString>> DatabaseManager::getFriendsList(quint32 userId)
     }
 
     try {
-        QString queryStr = DatabaseQueries::Friends::LIST.arg(QString::number(userId));
         QSqlQuery query(database);
+        query.prepare(DatabaseQueries::Friends::LIST);
+        query.addBindValue(userId);
 
-        qDebug() << "Executing query:" << queryStr;  // Debug log
-
-        if (!query.exec(queryStr)) {
+        if (!query.exec()) {
             qWarning() << "Query error:" << query.lastError().text();  // Debug log
             throw std::runtime_error("Failed to get friends list: " + query.lastError().text().toStdString());
         }
@@ -467,6 +765,41 @@ QVector<QPair<quint32, QString>> DatabaseManager::getFriendsList(quint32 userId)
     }
 }
 
+bool DatabaseManager::getAllFriendships(QVector<QPair<quint32, quint32>>& edges,
+                                        QHash<quint32, QString>& usernames)
+{
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    if (!query.exec(DatabaseQueries::Friends::LOAD_ALL)) {
+        qWarning() << "Failed to load friendships:" << query.lastError().text();
+        return false;
+    }
+
+    while (query.next()) {
+        quint32 friendId = query.value(1).toUInt();
+        edges.append({query.value(0).toUInt(), friendId});
+        usernames.insert(friendId, query.value(2).toString());
+    }
+    return true;
+}
+
+bool DatabaseManager::getAllUsers(QVector<QPair<quint32, QString>>& users)
+{
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    if (!query.exec(DatabaseQueries::Users::LOAD_ALL)) {
+        qWarning() << "Failed to load users:" << query.lastError().text();
+        return false;
+    }
+
+    while (query.next()) {
+        users.append({query.value(0).toUInt(), query.value(1).toString()});
+    }
+    return true;
+}
+
 QVector<ChatMessage> DatabaseManager::getChatHistory(quint32 userId1, quint32 userId2,
                                                      int offset, int limit)
 {
@@ -477,54 +810,283 @@ QVector<ChatMessage> DatabaseManager::getChatHistory(quint32 userId1, quint32 us
         return history;
     }
 
-    QString tableName = getChatTableName(userId1, userId2);
-    if (!chatTableExists(tableName)) {
+    QSqlQuery query(database);
+    if (!prepareChatQuery(query, DatabaseQueries::Messages::GET_CHAT_HISTORY,
+                          DatabaseQueries::Conversations::GET_HISTORY, userId1, userId2)) {
+        return history;
+    }
+    query.addBindValue(limit);
+    query.addBindValue(offset);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to get chat history:" << query.lastError().text();
+        return history;
+    }
+
+    while (query.next()) {
+        history.append(chatMessageFromQuery(query));
+    }
+
+    return history;
+}
+
+QVector<ChatMessage> DatabaseManager::getChatHistoryBefore(quint32 userId1, quint32 userId2,
+                                                           qint64 beforeId, int limit, bool& hasMore)
+{
+    // Kursor 0 oznacza początek od najnowszej wiadomości
+    return getChatHistoryPage(DatabaseQueries::Messages::GET_CHAT_HISTORY_BEFORE,
+                              DatabaseQueries::Conversations::GET_HISTORY_BEFORE, userId1, userId2,
+                              beforeId > 0 ? beforeId : std::numeric_limits<qint64>::max(), limit, hasMore);
+}
+
+QVector<ChatMessage> DatabaseManager::getChatHistoryAfter(quint32 userId1, quint32 userId2,
+                                                          qint64 afterId, int limit, bool& hasMore)
+{
+    return getChatHistoryPage(DatabaseQueries::Messages::GET_CHAT_HISTORY_AFTER,
+                              DatabaseQueries::Conversations::GET_HISTORY_AFTER, userId1, userId2,
+                              afterId, limit, hasMore);
+}
+
+QVector<ChatMessage> DatabaseManager::getChatHistoryPage(const QString& legacyTemplate,
+                                                         const QString& consolidatedQuery,
+                                                         quint32 userId1, quint32 userId2,
+                                                         qint64 cursorId, int limit, bool& hasMore)
+{
+    QVector<ChatMessage> history;
+    hasMore = false;
+
+    if (!database.isOpen()) {
+        qWarning() << "Database is not open!";
         return history;
     }
 
-    QString queryStr = QString(DatabaseQueries::Messages::GET_CHAT_HISTORY).arg(tableName);
     QSqlQuery query(database);
-    query.prepare(queryStr);
-    query.bindValue(0, limit);
-    query.bindValue(1, offset);
+    if (!prepareChatQuery(query, legacyTemplate, consolidatedQuery, userId1, userId2)) {
+        return history;
+    }
+    query.addBindValue(cursorId);
+    query.addBindValue(limit + 1);
 
     if (!query.exec()) {
-        qWarning() << "Failed to get chat history:" << query.lastError().text();
+        qWarning() << "Failed to get chat history page:" << query.lastError().text();
         return history;
     }
 
     while (query.next()) {
-        ChatMessage msg;
-        msg.username = query.value("username").toString();
-        msg.message = query.value("message").toString();
-        msg.timestamp = query.value("sent_at").toDateTime();
-        msg.isRead = !query.value("read_at").isNull();
-        history.append(msg);
+        if (history.size() == limit) {
+            hasMore = true;
+            break;
+        }
+        history.append(chatMessageFromQuery(query));
     }
 
     return history;
 }
 
-bool DatabaseManager::hasMoreHistory(quint32 userId1, quint32 userId2, int offset)
+bool DatabaseManager::hasMessagesBefore(quint32 userId1, quint32 userId2, qint64 messageId)
 {
+    if (messageStorage() == MessageStorage::Consolidated) {
+        bool result = false;
+        qint64 conversation = conversationId(userId1, userId2);
+        if (conversation != 0 && RecentMessageCache::getInstance().hasBefore(conversation, messageId, result)) {
+            return result;
+        }
+    }
+
+    QSqlQuery query(database);
+    if (!prepareChatQuery(query, DatabaseQueries::Messages::HAS_MESSAGES_BEFORE,
+                          DatabaseQueries::Conversations::HAS_MESSAGES_BEFORE, userId1, userId2)) {
+        return false;
+    }
+    query.addBindValue(messageId);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to check for older messages:" << query.lastError().text();
+        return false;
+    }
+
+    return query.next();
+}
+
+bool DatabaseManager::prepareChatQuery(QSqlQuery& query, const QString& legacyTemplate,
+                                       const QString& consolidatedQuery,
+                                       quint32 userId1, quint32 userId2)
+{
+    // W trakcie zapisu podwójnego conversation_messages nie ma jeszcze pełnej historii
+    if (messageStorage() == MessageStorage::Consolidated) {
+        qint64 conversation = conversationId(userId1, userId2);
+        if (conversation == 0) {
+            return false;
+        }
+        query.prepare(consolidatedQuery);
+        query.addBindValue(conversation);
+        return true;
+    }
+
     QString tableName = getChatTableName(userId1, userId2);
     if (!chatTableExists(tableName)) {
         return false;
     }
+    query.prepare(QString(legacyTemplate).arg(tableName));
+    return true;
+}
+
+qint64 DatabaseManager::conversationId(quint32 userId1, quint32 userId2, bool create)
+{
+    quint32 low = qMin(userId1, userId2);
+    quint32 high = qMax(userId1, userId2);
+    quint64 key = (quint64(low) << 32) | high;
+
+    auto cached = conversationCache.constFind(key);
+    if (cached != conversationCache.constEnd()) {
+        return cached.value();
+    }
+
+    QSqlQuery query(database);
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        query.prepare(DatabaseQueries::Conversations::FIND);
+        query.addBindValue(low);
+        query.addBindValue(high);
+
+        if (!query.exec()) {
+            qWarning() << "Failed to find conversation:" << query.lastError().text();
+            return 0;
+        }
+        if (query.next()) {
+            qint64 id = query.value(0).toLongLong();
+            conversationCache.insert(key, id);
+            return id;
+        }
+        if (!create || attempt > 0) {
+            return 0;
+        }
+
+        // INSERT IGNORE - równoległe utworzenie tej samej rozmowy nie jest błędem
+        query.prepare(DatabaseQueries::Conversations::CREATE);
+        query.addBindValue(low);
+        query.addBindValue(high);
+        if (!query.exec()) {
+            qWarning() << "Failed to create conversation:" << query.lastError().text();
+            return 0;
+        }
+    }
+    return 0;
+}
+
+bool DatabaseManager::getJournalCheckpoint(const QString& journal, quint64& appliedSequence)
+{
+    QSqlQuery query(database);
+    query.prepare(DatabaseQueries::Journal::GET_CHECKPOINT);
+    query.addBindValue(journal);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to read journal checkpoint:" << query.lastError().text();
+        return false;
+    }
 
-    QString queryStr = QString(DatabaseQueries::Messages::GET_MESSAGES_COUNT).arg(tableName);
+    appliedSequence = query.next() ? query.value(0).toULongLong() : 0;
+    return true;
+}
+
+bool DatabaseManager::setJournalCheckpoint(const QString& journal, quint64 appliedSequence)
+{
     QSqlQuery query(database);
+    query.prepare(DatabaseQueries::Journal::SET_CHECKPOINT);
+    query.addBindValue(journal);
+    query.addBindValue(appliedSequence);
 
-    if (!query.exec(queryStr)) {
-        qWarning() << "Failed to get messages count:" << query.lastError().text();
+    if (!query.exec()) {
+        qWarning() << "Failed to update journal checkpoint:" << query.lastError().text();
         return false;
     }
+    return true;
+}
 
-    if (query.next()) {
-        return query.value(0).toInt() > offset + Protocol::ChatHistory::MESSAGE_BATCH_SIZE;
+qint64 DatabaseManager::conversationHead(qint64 conversationId)
+{
+    ConversationHeads& heads = ConversationHeads::getInstance();
+    qint64 head = heads.head(conversationId);
+    if (head != ConversationHeads::UNKNOWN) {
+        return head;
     }
 
-    return false;
+    QSqlQuery query(database);
+    query.prepare(DatabaseQueries::Conversations::GET_HEAD);
+    query.addBindValue(conversationId);
+
+    if (!query.exec() || !query.next()) {
+        qWarning() << "Failed to read conversation head:" << query.lastError().text();
+        return ConversationHeads::UNKNOWN;
+    }
+
+    head = query.value(0).toLongLong();
+    heads.raise(conversationId, head);
+    return head;
+}
+
+bool DatabaseManager::advanceReadCursor(quint32 userId, qint64 conversationId, qint64 messageId)
+{
+    if (messageId <= 0) {
+        return true;
+    }
+
+    QSqlQuery query(database);
+    query.prepare(DatabaseQueries::Conversations::ADVANCE_READ_CURSOR);
+    query.addBindValue(userId);
+    query.addBindValue(conversationId);
+    query.addBindValue(messageId);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to advance read cursor:" << query.lastError().text();
+        return false;
+    }
+    RecentMessageCache::getInstance().advanceCursor(conversationId, userId, messageId);
+    return true;
+}
+
+bool DatabaseManager::getReadCursors(quint32 userId, quint32 friendId, qint64& ownReadId, qint64& partnerReadId)
+{
+    ownReadId = 0;
+    partnerReadId = 0;
+    if (messageStorage() == MessageStorage::Legacy) {
+        return false;
+    }
+
+    qint64 conversation = conversationId(userId, friendId);
+    if (conversation == 0) {
+        return true;  // Rozmowa jeszcze się nie zaczęła
+    }
+
+    QSqlQuery query(database);
+    query.prepare(DatabaseQueries::Conversations::GET_READ_CURSORS);
+    query.addBindValue(conversation);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to read cursors:" << query.lastError().text();
+        return false;
+    }
+
+    while (query.next()) {
+        qint64 readId = query.value(1).toLongLong();
+        if (query.value(0).toUInt() == userId) {
+            ownReadId = readId;
+        } else {
+            partnerReadId = readId;
+        }
+    }
+    return true;
+}
+
+ChatMessage DatabaseManager::chatMessageFromQuery(const QSqlQuery& query)
+{
+    ChatMessage msg;
+    msg.id = query.value("id").toLongLong();
+    msg.globalId = query.value("global_id").toULongLong();
+    msg.username = getUserUsername(query.value("sender_id").toUInt());
+    msg.message = query.value("message").toString();
+    msg.timestamp = query.value("sent_at").toDateTime();
+    msg.isRead = query.value("is_read").toBool();
+    return msg;
 }
 
 QVector<UserSearchResult> DatabaseManager::searchUsers(const QString& query, quint32 currentUserId)
@@ -612,26 +1174,31 @@ bool DatabaseManager::validatePassword(const QString& password)
 
 bool DatabaseManager::userExists(const QString& username)
 {
+    UserDirectory& directory = UserDirectory::getInstance();
+    quint32 userId = 0;
+    UserDirectory::Lookup cached = directory.userId(username, userId);
+    if (cached != UserDirectory::Lookup::Unknown) {
+        return cached == UserDirectory::Lookup::Found;
+    }
+
     QSqlQuery query(database);
-    query.prepare(DatabaseQueries::Users::EXISTS_BY_NAME);
+    query.prepare(DatabaseQueries::Users::FIND_BY_NAME);
     query.addBindValue(username);
 
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt() > 0;
+    if (!query.exec()) {
+        return false;
+    }
+    if (!query.next()) {
+        directory.addMissing(username);
+        return false;
     }
-    return false;
+    directory.add(query.value(0).toUInt(), query.value(1).toString());
+    return true;
 }
 
 bool DatabaseManager::userExists(quint32 userId)
 {
-    QSqlQuery query(database);
-    query.prepare(DatabaseQueries::Users::EXISTS_BY_ID);
-    query.addBindValue(userId);
-
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt() > 0;
-    }
-    return false;
+    return !getUserUsername(userId).isEmpty();
 }
 
 QString DatabaseManager::generateSalt()
@@ -654,34 +1221,6 @@ QString DatabaseManager::hashPassword(const QString& password)
     return QString(hash.toHex());
 }
 
-bool DatabaseManager::createFriendsList(quint32 userId)
-{
-    if (!database.transaction()) {
-        qWarning() << "Failed to start transaction for creating friends list";
-        return false;
-    }
-
-    try {
-        QString createTableQuery = DatabaseQueries::Create::FRIENDS_TABLE.arg(userId);
-        QSqlQuery query(database);
-
-        if (!query.exec(createTableQuery)) {
-            throw std::runtime_error("Failed to create friends table: " + query.lastError().text().toStdString());
-        }
-
-        if (!database.commit()) {
-            throw std::runtime_error("Failed to commit friends table creation");
-        }
-
-        return true;
-    }
-    catch (const std::exception& e) {
-        qWarning() << "Error creating friends list:" << e.what();
-        database.rollback();
-        return false;
-    }
-}
-
 bool DatabaseManager::cloneConnection(const QString& connectionName)
 {
     qDebug() << "Cloning database connection for session:" << connectionName;
@@ -717,7 +1256,30 @@ bool DatabaseManager::cloneConnection(const QString& connectionName)
     database = newDb;
     initialized = true;
 
-    return true;
+    return true;
+}
+
+void DatabaseManager::attachConnection(const QSqlDatabase& connection)
+{
+    database = connection;
+    initialized = database.isOpen();
+}
+
+void DatabaseManager::detachConnection()
+{
+    // Nie trzymamy uchwytu po zwrocie - pula może usunąć połączenie
+    database = QSqlDatabase();
+    initialized = false;
+}
+
+bool DatabaseManager::isConnectionAlive()
+{
+    if (!database.isOpen()) {
+        return false;
+    }
+
+    QSqlQuery query(database);
+    return query.exec(DatabaseQueries::Pool::VALIDATE);
 }
 
 // Metoda pomocnicza do generowania nazwy tabeli chatu
@@ -796,6 +1358,25 @@ bool DatabaseManager::createChatTableIfNotExists(quint32 userId1, quint32 userId
 // Oznaczanie wiadomości jako przeczytanych
 bool DatabaseManager::markChatAsRead(quint32 userId, quint32 friendId)
 {
+    const MessageStorage mode = messageStorage();
+
+    // Kursor przesuwany do najnowszej wiadomości - jeden wiersz niezależnie
+    // od liczby nieprzeczytanych wiadomości
+    if (mode != MessageStorage::Legacy) {
+        qint64 conversation = conversationId(userId, friendId);
+        if (conversation != 0) {
+            qint64 head = conversationHead(conversation);
+            if (head == ConversationHeads::UNKNOWN || !advanceReadCursor(userId, conversation, head)) {
+                return false;
+            }
+        }
+
+        // W trakcie zapisu podwójnego odczyty idą jeszcze z chat_X_Y
+        if (mode == MessageStorage::Consolidated) {
+            return true;
+        }
+    }
+
     QString tableName = getChatTableName(userId, friendId);
 
     if (!chatTableExists(tableName)) {
@@ -839,18 +1420,23 @@ QVector<ChatMessage> DatabaseManager::getLatestMessages(quint32 userId1, quint32
         return history;
     }
 
-    QString tableName = getChatTableName(userId1, userId2);
-    if (!chatTableExists(tableName)) {
-        return history;
+    RecentMessageCache& recent = RecentMessageCache::getInstance();
+    if (messageStorage() == MessageStorage::Consolidated && recent.isEnabled() && limit <= recent.capacity()) {
+        qint64 conversation = conversationId(userId1, userId2);
+        if (conversation == 0 || recent.latest(conversation, limit, history)) {
+            return history;
+        }
+        if (loadRecentMessages(conversation, limit, history)) {
+            return history;
+        }
     }
 
-    QString queryStr = QString(DatabaseQueries::Messages::GET_LATEST_MESSAGES)
-                           .arg(tableName)
-                           .arg(tableName)
-                           .arg(tableName);
     QSqlQuery query(database);
-    query.prepare(queryStr);
-    query.bindValue(0, limit);
+    if (!prepareChatQuery(query, DatabaseQueries::Messages::GET_LATEST_MESSAGES,
+                          DatabaseQueries::Conversations::GET_LATEST, userId1, userId2)) {
+        return history;
+    }
+    query.addBindValue(limit);
 
     if (!query.exec()) {
         qWarning() << "Failed to get latest messages:" << query.lastError().text();
@@ -858,43 +1444,174 @@ QVector<ChatMessage> DatabaseManager::getLatestMessages(quint32 userId1, quint32
     }
 
     while (query.next()) {
-        ChatMessage msg;
-        msg.username = query.value("username").toString();
-        msg.message = query.value("message").toString();
-        msg.timestamp = query.value("sent_at").toDateTime();
-        msg.isRead = !query.value("read_at").isNull();
-        history.append(msg);
+        history.append(chatMessageFromQuery(query));
+    }
+
+    if (messageStorage() == MessageStorage::Consolidated) {
+        std::reverse(history.begin(), history.end());
     }
 
     return history;
 }
 
+bool DatabaseManager::loadRecentMessages(qint64 conversationId, int limit, QVector<ChatMessage>& messages)
+{
+    RecentMessageCache& recent = RecentMessageCache::getInstance();
+
+    QSqlQuery query(database);
+    query.prepare(DatabaseQueries::Conversations::GET_RECENT);
+    query.addBindValue(conversationId);
+    query.addBindValue(recent.capacity());
+    if (!query.exec()) {
+        qWarning() << "Failed to load recent messages:" << query.lastError().text();
+        return false;
+    }
+
+    QVector<RecentMessageCache::Message> newestFirst;
+    QHash<quint32, QString> usernames;
+    while (query.next()) {
+        RecentMessageCache::Message message;
+        message.id = query.value(0).toLongLong();
+        message.senderId = query.value(1).toUInt();
+        message.text = query.value(2).toString();
+        message.sentAt = query.value(3).toDateTime();
+        message.globalId = query.value(4).toULongLong();
+        newestFirst.append(message);
+    }
+
+    for (const RecentMessageCache::Message& message : newestFirst) {
+        if (!usernames.contains(message.senderId)) {
+            usernames.insert(message.senderId, getUserUsername(message.senderId));
+        }
+    }
+
+    query.prepare(DatabaseQueries::Conversations::GET_READ_CURSORS);
+    query.addBindValue(conversationId);
+    if (!query.exec()) {
+        qWarning() << "Failed to read cursors:" << query.lastError().text();
+        return false;
+    }
+
+    QHash<quint32, qint64> readCursors;
+    while (query.next()) {
+        readCursors.insert(query.value(0).toUInt(), query.value(1).toLongLong());
+    }
+
+    bool complete = newestFirst.size() < recent.capacity();
+    messages = recent.load(conversationId, newestFirst, usernames, readCursors, complete, limit);
+    return true;
+}
+
 QVector<quint32> DatabaseManager::getUnreadMessagesUsers(quint32 userId)
 {
     QVector<quint32> usersWithUnread;
-    QVector<QPair<quint32, QString>> friendsList = getFriendsList(userId);
+    for (const auto& unread : getUnreadCounts(userId)) {
+        usersWithUnread.append(unread.first);
+    }
+    return usersWithUnread;
+}
 
-    for (const auto& friend_ : friendsList) {
-        quint32 friendId = friend_.first;
-        QString tableName = getChatTableName(userId, friendId);
+QVector<QPair<quint32, int>> DatabaseManager::getUnreadCounts(quint32 userId)
+{
+    return getUnreadCounts(userId, getFriendsList(userId));
+}
+
+QVector<QPair<quint32, int>> DatabaseManager::getUnreadCounts(quint32 userId,
+                                                              const QVector<QPair<quint32, QString>>& friendsList)
+{
+    QVector<QPair<quint32, int>> unreadCounts;
+
+    if (messageStorage() == MessageStorage::Consolidated) {
+        QSqlQuery query(database);
+        query.prepare(DatabaseQueries::Conversations::GET_READ_STATE);
+        for (int i = 0; i < 5; ++i) {
+            query.addBindValue(userId);
+        }
+
+        if (!query.exec()) {
+            qWarning() << "Failed to get read state:" << query.lastError().text();
+            return unreadCounts;
+        }
+
+        ConversationHeads& heads = ConversationHeads::getInstance();
+        QHash<quint32, int> counts;
+        while (query.next()) {
+            heads.raise(query.value(0).toLongLong(), query.value(2).toLongLong());
+            qint64 unread = query.value(4).toLongLong();
+            if (unread > 0) {
+                counts.insert(query.value(1).toUInt(),
+                              static_cast<int>(qMin<qint64>(unread, std::numeric_limits<int>::max())));
+            }
+        }
+
+        // Wiadomości od byłych znajomych nie są zgłaszane
+        for (const auto& friend_ : friendsList) {
+            auto it = counts.constFind(friend_.first);
+            if (it != counts.constEnd()) {
+                unreadCounts.append({friend_.first, it.value()});
+            }
+        }
+        return unreadCounts;
+    }
+
+    // Tabele chat_X_Y: najpierw jedno zapytanie o istniejące, potem jedno
+    // UNION ALL z licznikami - zamiast dwóch zapytań na każdego znajomego
+    for (int offset = 0; offset < friendsList.size(); offset += UNREAD_CHUNK_SIZE) {
+        QVector<QPair<quint32, QString>> chunk = friendsList.mid(offset, UNREAD_CHUNK_SIZE);
+
+        QSqlQuery tables(database);
+        tables.prepare(DatabaseQueries::Messages::FIND_CHAT_TABLES.arg(placeholderRows(1, chunk.size())));
+        for (const auto& friend_ : chunk) {
+            tables.addBindValue(getChatTableName(userId, friend_.first));
+        }
+        if (!tables.exec()) {
+            qWarning() << "Failed to find chat tables:" << tables.lastError().text();
+            continue;
+        }
 
-        if (!chatTableExists(tableName)) {
+        QSet<QString> existing;
+        while (tables.next()) {
+            existing.insert(tables.value(0).toString());
+        }
+        if (existing.isEmpty()) {
             continue;
         }
 
+        QStringList parts;
+        for (const auto& friend_ : chunk) {
+            QString tableName = getChatTableName(userId, friend_.first);
+            if (existing.contains(tableName)) {
+                parts.append(DatabaseQueries::Messages::UNREAD_COUNT_PART.arg(tableName).arg(friend_.first));
+            }
+        }
+
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Messages::GET_UNREAD_COUNT.arg(tableName));
-        query.addBindValue(userId);
+        query.prepare(parts.join(QLatin1String(" UNION ALL ")));
+        for (int i = 0; i < parts.size(); ++i) {
+            query.addBindValue(userId);
+        }
+        if (!query.exec()) {
+            qWarning() << "Failed to count unread messages:" << query.lastError().text();
+            continue;
+        }
 
-        if (query.exec() && query.next()) {
-            int unreadCount = query.value(0).toInt();
+        QHash<quint32, int> counts;
+        while (query.next()) {
+            int unreadCount = query.value(1).toInt();
             if (unreadCount > 0) {
-                usersWithUnread.append(friendId);
+                counts.insert(query.value(0).toUInt(), unreadCount);
+            }
+        }
+        // Kolejność listy znajomych, jak przy osobnych zapytaniach
+        for (const auto& friend_ : chunk) {
+            auto it = counts.constFind(friend_.first);
+            if (it != counts.constEnd()) {
+                unreadCounts.append({friend_.first, it.value()});
             }
         }
     }
 
-    return usersWithUnread;
+    return unreadCounts;
 }
 
 bool DatabaseManager::removeFriend(quint32 userId, quint32 friendId)
@@ -919,7 +1636,8 @@ bool DatabaseManager::removeFriend(quint32 userId, quint32 friendId)
 
         // Usuń znajomego z listy użytkownika
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Friends::REMOVE.arg(userId));
+        query.prepare(DatabaseQueries::Friends::REMOVE);
+        query.addBindValue(userId);
         query.addBindValue(friendId);
 
         if (!query.exec()) {
@@ -928,7 +1646,8 @@ bool DatabaseManager::removeFriend(quint32 userId, quint32 friendId)
         }
 
         // Usuń użytkownika z listy znajomego
-        query.prepare(DatabaseQueries::Friends::REMOVE.arg(friendId));
+        query.prepare(DatabaseQueries::Friends::REMOVE);
+        query.addBindValue(friendId);
         query.addBindValue(userId);
 
         if (!query.exec()) {
@@ -940,6 +1659,12 @@ bool DatabaseManager::removeFriend(quint32 userId, quint32 friendId)
             throw std::runtime_error("Failed to commit friend removal");
         }
 
+        FriendGraph& graph = FriendGraph::getInstance();
+        graph.removeFriend(userId, friendId);
+        graph.removeFriend(friendId, userId);
+        SyncVersions::getInstance().friendsChanged(userId);
+        SyncVersions::getInstance().friendsChanged(friendId);
+
         qDebug() << "Successfully removed friend relationship between" << userId << "and" << friendId;
         return true;
     }
@@ -950,49 +1675,6 @@ bool DatabaseManager::removeFriend(quint32 userId, quint32 friendId)
     }
 }
 
-bool DatabaseManager::createInvitationTables(quint32 userId)
-{
-    if (!database.isOpen()) {
-        qWarning() << "Database is not open while creating invitation tables";
-        return false;
-    }
-
-    if (!database.transaction()) {
-        qWarning() << "Failed to start transaction for creating invitation tables";
-        return false;
-    }
-
-    try {
-        QSqlQuery query(database);
-
-        // Tworzenie tabeli wysłanych zaproszeń
-        QString sentTableQuery = DatabaseQueries::Create::SENT_INVITATIONS_TABLE.arg(userId);
-        if (!query.exec(sentTableQuery)) {
-            throw std::runtime_error("Failed to create sent invitations table: " +
-                                     query.lastError().text().toStdString());
-        }
-
-        // Tworzenie tabeli otrzymanych zaproszeń
-        QString receivedTableQuery = DatabaseQueries::Create::RECEIVED_INVITATIONS_TABLE.arg(userId);
-        if (!query.exec(receivedTableQuery)) {
-            throw std::runtime_error("Failed to create received invitations table: " +
-                                     query.lastError().text().toStdString());
-        }
-
-        if (!database.commit()) {
-            throw std::runtime_error("Failed to commit invitation tables creation");
-        }
-
-        qDebug() << "Successfully created invitation tables for user" << userId;
-        return true;
-    }
-    catch (const std::exception& e) {
-        qWarning() << "Error creating invitation tables:" << e.what();
-        database.rollback();
-        return false;
-    }
-}
-
 bool DatabaseManager::sendFriendInvitation(quint32 fromUserId, quint32 toUserId)
 {
     if (!database.isOpen()) {
@@ -1023,36 +1705,11 @@ bool DatabaseManager::sendFriendInvitation(quint32 fromUserId, quint32 toUserId)
     try {
         QSqlQuery query(database);
 
-        // Pobierz nazwę użytkownika docelowego
-        query.prepare(DatabaseQueries::Users::GET_USERNAME);
-        query.addBindValue(toUserId);
-        if (!query.exec() || !query.next()) {
-            throw std::runtime_error("Failed to get target username");
-        }
-        QString toUsername = query.value(0).toString();
-
-        // Dodaj wpis do tabeli wysłanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::ADD_SENT.arg(fromUserId));
-        query.addBindValue(toUserId);
-        query.addBindValue(toUsername);
-        if (!query.exec()) {
-            throw std::runtime_error("Failed to add sent invitation");
-        }
-
-        // Pobierz nazwę użytkownika wysyłającego
-        query.prepare(DatabaseQueries::Users::GET_USERNAME);
-        query.addBindValue(fromUserId);
-        if (!query.exec() || !query.next()) {
-            throw std::runtime_error("Failed to get sender username");
-        }
-        QString fromUsername = query.value(0).toString();
-
-        // Dodaj wpis do tabeli otrzymanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::ADD_RECEIVED.arg(toUserId));
+        query.prepare(DatabaseQueries::Invitations::ADD);
         query.addBindValue(fromUserId);
-        query.addBindValue(fromUsername);
+        query.addBindValue(toUserId);
         if (!query.exec()) {
-            throw std::runtime_error("Failed to add received invitation");
+            throw std::runtime_error("Failed to add invitation: " + query.lastError().text().toStdString());
         }
 
         if (!database.commit()) {
@@ -1084,46 +1741,30 @@ bool DatabaseManager::acceptFriendInvitation(quint32 userId, int requestId)
     try {
         QSqlQuery query(database);
 
-        // 1. Pobierz informacje o otrzymanym zaproszeniu
-        query.prepare(DatabaseQueries::Invitations::GET_FRIEND_INVITATION_INFO.arg(userId));
-        query.bindValue(0, requestId);
+        // 1. Zablokuj oczekujące zaproszenie i ustal nadawcę
+        query.prepare(DatabaseQueries::Invitations::GET_PENDING_RECEIVED);
+        query.addBindValue(requestId);
+        query.addBindValue(userId);
 
         if (!query.exec() || !query.next()) {
-            qWarning() << "Invitation not found";
-            throw std::runtime_error("Invitation not found");
-        }
-
-        QString currentStatus = query.value("status").toString();
-        if (currentStatus != "pending") {
-            qWarning() << "Cannot accept invitation with status:" << currentStatus;
-            throw std::runtime_error("Invitation is not in pending state");
+            qWarning() << "Pending invitation not found";
+            throw std::runtime_error("Invitation not found or not pending");
         }
 
         quint32 fromUserId = query.value("from_user_id").toUInt();
-        QDateTime createdAt = query.value("created_at").toDateTime();
-
-        // 2. Zaktualizuj status w tabeli otrzymanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::UPDATE_RECEIVED_INVITATION_STATUS_ACCEPT.arg(userId));
-        query.bindValue(0, Protocol::InvitationStatus::ACCEPTED);
-        query.bindValue(1, requestId);
-
-        if (!query.exec() || query.numRowsAffected() == 0) {
-            qWarning() << "Failed to update received invitation:" << query.lastError().text();
-            throw std::runtime_error("Failed to update received invitation");
-        }
 
-        // 3. Zaktualizuj status w tabeli wysłanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::UPDATE_SENT_INVITATION_STATUS_ACCEPT.arg(fromUserId));
-        query.bindValue(0, Protocol::InvitationStatus::ACCEPTED);
-        query.bindValue(1, userId);
-        query.bindValue(2, createdAt);
+        // 2. Zaktualizuj status zaproszenia
+        query.prepare(DatabaseQueries::Invitations::UPDATE_RECEIVED_STATUS);
+        query.addBindValue(Protocol::InvitationStatus::ACCEPTED);
+        query.addBindValue(requestId);
+        query.addBindValue(userId);
 
         if (!query.exec() || query.numRowsAffected() == 0) {
-            qWarning() << "Failed to update sent invitation:" << query.lastError().text();
-            throw std::runtime_error("Failed to update sent invitation");
+            qWarning() << "Failed to update invitation:" << query.lastError().text();
+            throw std::runtime_error("Failed to update invitation");
         }
 
-        // 4. Dodaj relację znajomych w obie strony
+        // 3. Dodaj relację znajomych w obie strony
         if (!addFriend(userId, fromUserId)) {
             qWarning() << "Failed to add friend relationship (user->friend)";
             throw std::runtime_error("Failed to create friend relationship (user->friend)");
@@ -1133,8 +1774,18 @@ bool DatabaseManager::acceptFriendInvitation(quint32 userId, int requestId)
             throw std::runtime_error("Failed to create friend relationship (friend->user)");
         }
 
-        // 5. Utwórz tabelę czatu
-        // 5. Utwórz tabelę czatu
+        // 4. Utwórz tabelę czatu; po konsolidacji rozmowa powstaje przy pierwszej wiadomości
+        if (messageStorage() == MessageStorage::Consolidated) {
+            if (!database.commit()) {
+                throw std::runtime_error("Failed to commit accepting invitation");
+            }
+
+            qDebug() << "Successfully accepted invitation" << requestId
+                     << "from user" << fromUserId
+                     << "to user" << userId;
+            return true;
+        }
+
         quint32 smallerId = qMin(userId, fromUserId);
         quint32 largerId = qMax(userId, fromUserId);
         QString chatTableName = QString("chat_%1_%2").arg(smallerId).arg(largerId);
@@ -1166,104 +1817,24 @@ bool DatabaseManager::acceptFriendInvitation(quint32 userId, int requestId)
 
 bool DatabaseManager::rejectFriendInvitation(quint32 userId, int requestId)
 {
-    if (!database.isOpen()) {
-        qWarning() << "Database is not open while rejecting invitation";
+    if (!updateInvitationStatus(userId, requestId, Protocol::InvitationStatus::REJECTED, false)) {
+        qWarning() << "Failed to reject invitation" << requestId << "for user" << userId;
         return false;
     }
 
-    if (!database.transaction()) {
-        qWarning() << "Failed to start transaction for rejecting invitation";
-        return false;
-    }
-
-    try {
-        QSqlQuery query(database);
-
-        // 1. Pobierz informacje o otrzymanym zaproszeniu
-        query.prepare(DatabaseQueries::Invitations::GET_RECEIVED_INVITATION_DETAILS.arg(userId));
-        query.bindValue(0, requestId);
-
-        if (!query.exec() || !query.next()) {
-            throw std::runtime_error("Received invitation not found or not pending");
-        }
-
-        quint32 fromUserId = query.value(0).toUInt();
-        QDateTime createdAt = query.value(1).toDateTime();
-
-        // 2. Zaktualizuj status w tabeli otrzymanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::UPDATE_RECEIVED_INVITATION_STATUS_REJECTED.arg(userId));
-        query.bindValue(0, requestId);
-
-        if (!query.exec() || query.numRowsAffected() == 0) {
-            throw std::runtime_error("Failed to update received invitation");
-        }
-
-        // 3. Znajdź i zaktualizuj odpowiednie zaproszenie w tabeli wysłanych
-        query.prepare(DatabaseQueries::Invitations::UPDATE_INVITATION_STATUS_REJECTED.arg(fromUserId));
-        query.bindValue(0, userId);
-        query.bindValue(1, createdAt);
-
-        if (!query.exec() || query.numRowsAffected() == 0) {
-            throw std::runtime_error("Failed to update sent invitation");
-        }
-
-        if (!database.commit()) {
-            throw std::runtime_error("Failed to commit rejecting invitation");
-        }
-
-        qDebug() << "Successfully rejected invitation" << requestId
-                 << "from user" << fromUserId
-                 << "to user" << userId;
-        return true;
-    }
-    catch (const std::exception& e) {
-        qWarning() << "Error rejecting invitation:" << e.what();
-        database.rollback();
-        return false;
-    }
+    qDebug() << "Successfully rejected invitation" << requestId << "to user" << userId;
+    return true;
 }
 
 bool DatabaseManager::cancelFriendInvitation(quint32 userId, int requestId)
 {
-    if (!database.isOpen()) {
-        qWarning() << "Database is not open while cancelling invitation";
+    if (!updateInvitationStatus(userId, requestId, Protocol::InvitationStatus::CANCELLED, true)) {
+        qWarning() << "Failed to cancel invitation" << requestId << "for user" << userId;
         return false;
     }
 
-    if (!database.transaction()) {
-        qWarning() << "Failed to start transaction for cancelling invitation";
-        return false;
-    }
-
-    try {
-        QSqlQuery query(database);
-
-        // Pobierz dane zaproszenia
-        query.prepare(DatabaseQueries::Invitations::GET_SENT.arg(userId));
-        query.addBindValue(requestId);
-        if (!query.exec() || !query.next()) {
-            throw std::runtime_error("Failed to get invitation details");
-        }
-
-        quint32 toUserId = query.value("to_user_id").toUInt();
-
-        // Aktualizuj status w obu tabelach
-        if (!updateBothInvitationStatuses(userId, toUserId, requestId, Protocol::InvitationStatus::CANCELLED)) {
-            throw std::runtime_error("Failed to update invitation statuses");
-        }
-
-        if (!database.commit()) {
-            throw std::runtime_error("Failed to commit cancelling invitation");
-        }
-
-        qDebug() << "Successfully cancelled invitation" << requestId << "for user" << userId;
-        return true;
-    }
-    catch (const std::exception& e) {
-        qWarning() << "Error cancelling invitation:" << e.what();
-        database.rollback();
-        return false;
-    }
+    qDebug() << "Successfully cancelled invitation" << requestId << "for user" << userId;
+    return true;
 }
 
 bool DatabaseManager::checkPendingInvitation(quint32 fromUserId, quint32 toUserId)
@@ -1275,7 +1846,8 @@ bool DatabaseManager::checkPendingInvitation(quint32 fromUserId, quint32 toUserI
 
     try {
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Invitations::CHECK_PENDING.arg(fromUserId));
+        query.prepare(DatabaseQueries::Invitations::CHECK_PENDING);
+        query.addBindValue(fromUserId);
         query.addBindValue(toUserId);
 
         if (!query.exec()) {
@@ -1305,13 +1877,11 @@ bool DatabaseManager::updateInvitationStatus(quint32 userId, int requestId,
 
     try {
         QSqlQuery query(database);
-        QString updateQuery = isSender ?
-                                  DatabaseQueries::Invitations::UPDATE_SENT_STATUS.arg(userId) :
-                                  DatabaseQueries::Invitations::UPDATE_RECEIVED_STATUS.arg(userId);
-
-        query.prepare(updateQuery);
+        query.prepare(isSender ? DatabaseQueries::Invitations::UPDATE_SENT_STATUS
+                               : DatabaseQueries::Invitations::UPDATE_RECEIVED_STATUS);
         query.addBindValue(status);
         query.addBindValue(requestId);
+        query.addBindValue(userId);
 
         if (!query.exec()) {
             throw std::runtime_error("Failed to update invitation status: " +
@@ -1326,67 +1896,6 @@ bool DatabaseManager::updateInvitationStatus(quint32 userId, int requestId,
     }
 }
 
-bool DatabaseManager::updateBothInvitationStatuses(quint32 fromUserId, quint32 toUserId,
-                                                   int requestId, const QString& status)
-{
-    if (!database.isOpen()) {
-        qWarning() << "Database is not open while updating both invitation statuses";
-        return false;
-    }
-
-    if (!database.transaction()) {
-        qWarning() << "Failed to start transaction for updating invitation statuses";
-        return false;
-    }
-
-    try {
-        QSqlQuery query(database);
-
-        // 1. Pobierz informacje o zaproszeniu z tabeli wysłanych
-        query.prepare(DatabaseQueries::Invitations::GET_SENT_INVITATION_DETAILS.arg(fromUserId));
-        query.bindValue(0, requestId);
-
-        if (!query.exec() || !query.next()) {
-            throw std::runtime_error("Sent invitation not found or not pending");
-        }
-
-        toUserId = query.value(0).toUInt();
-        QDateTime createdAt = query.value(1).toDateTime();
-
-        // 2. Aktualizuj status w tabeli wysłanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::UPDATE_SENT_INVITATION_STATUS.arg(fromUserId));
-        query.bindValue(0, status);
-        query.bindValue(1, requestId);
-
-        if (!query.exec() || query.numRowsAffected() == 0) {
-            throw std::runtime_error("Failed to update sent invitation");
-        }
-
-        // 3. Znajdź i zaktualizuj odpowiednie zaproszenie w tabeli otrzymanych
-        query.prepare(DatabaseQueries::Invitations::UPDATE_RECEIVED_INVITATION_STATUS_BY_TIMESTAMP.arg(toUserId));
-        query.bindValue(0, status);
-        query.bindValue(1, fromUserId);
-        query.bindValue(2, createdAt);
-
-        if (!query.exec() || query.numRowsAffected() == 0) {
-            throw std::runtime_error("Failed to update received invitation");
-        }
-
-        if (!database.commit()) {
-            throw std::runtime_error("Failed to commit invitation updates");
-        }
-
-        qDebug() << "Successfully updated invitation statuses from user" << fromUserId
-                 << "to user" << toUserId << "with status:" << status;
-        return true;
-    }
-    catch (const std::exception& e) {
-        qWarning() << "Error updating invitation statuses:" << e.what();
-        database.rollback();
-        return false;
-    }
-}
-
 QVector<FriendInvitation> DatabaseManager::getSentInvitations(quint32 userId)
 {
     QVector<FriendInvitation> invitations;
@@ -1398,7 +1907,8 @@ QVector<FriendInvitation> DatabaseManager::getSentInvitations(quint32 userId)
 
     try {
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Invitations::GET_SENT.arg(userId));
+        query.prepare(DatabaseQueries::Invitations::GET_SENT);
+        query.addBindValue(userId);
 
         if (!query.exec()) {
             throw std::runtime_error("Failed to get sent invitations: " +
@@ -1437,7 +1947,8 @@ QVector<FriendInvitation> DatabaseManager::getReceivedInvitations(quint32 userId
 
     try {
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Invitations::GET_RECEIVED.arg(userId));
+        query.prepare(DatabaseQueries::Invitations::GET_RECEIVED);
+        query.addBindValue(userId);
 
         if (!query.exec()) {
             throw std::runtime_error("Failed to get received invitations: " +
@@ -1495,8 +2006,9 @@ bool DatabaseManager::sendFriendRequest(int senderId, int targetUserId) {
         }
 
         // Sprawdź czy nie są już znajomymi
-        query.prepare(DatabaseQueries::Invitations::CHECK_IF_FRIENDS.arg(senderId));
-        query.bindValue(0, targetUserId);
+        query.prepare(DatabaseQueries::Invitations::CHECK_IF_FRIENDS);
+        query.bindValue(0, senderId);
+        query.bindValue(1, targetUserId);
 
         if (!query.exec() || !query.next()) {
             throw std::runtime_error("Failed to check if users are friends: " +
@@ -1508,8 +2020,9 @@ bool DatabaseManager::sendFriendRequest(int senderId, int targetUserId) {
         }
 
         // Sprawdź czy nie ma już oczekującego zaproszenia
-        query.prepare(DatabaseQueries::Invitations::CHECK_PENDING_INVITATION.arg(senderId));
-        query.bindValue(0, targetUserId);
+        query.prepare(DatabaseQueries::Invitations::CHECK_PENDING);
+        query.bindValue(0, senderId);
+        query.bindValue(1, targetUserId);
 
         if (!query.exec() || !query.next()) {
             throw std::runtime_error("Failed to check pending invitations: " +
@@ -1520,21 +2033,12 @@ bool DatabaseManager::sendFriendRequest(int senderId, int targetUserId) {
             throw std::runtime_error("Friend request already sent");
         }
 
-        // Dodaj zaproszenie do tabeli wysłanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::ADD_FRIEND_REQUEST_SENT.arg(senderId));
-        query.bindValue(0, targetUserId);
-
-        if (!query.exec()) {
-            throw std::runtime_error("Failed to add sent invitation: " +
-                                     query.lastError().text().toStdString());
-        }
-
-        // Dodaj zaproszenie do tabeli otrzymanych zaproszeń
-        query.prepare(DatabaseQueries::Invitations::ADD_FRIEND_REQUEST_RECEIVED.arg(targetUserId));
+        query.prepare(DatabaseQueries::Invitations::ADD);
         query.bindValue(0, senderId);
+        query.bindValue(1, targetUserId);
 
         if (!query.exec()) {
-            throw std::runtime_error("Failed to add received invitation: " +
+            throw std::runtime_error("Failed to add invitation: " +
                                      query.lastError().text().toStdString());
         }
 
@@ -1553,14 +2057,26 @@ bool DatabaseManager::sendFriendRequest(int senderId, int targetUserId) {
 }
 
 QString DatabaseManager::getUserUsername(quint32 userId) {
+    UserDirectory& directory = UserDirectory::getInstance();
+    QString username;
+    if (directory.username(userId, username) != UserDirectory::Lookup::Unknown) {
+        return username;
+    }
+
     QSqlQuery query(database);
-    query.prepare("SELECT username FROM users WHERE id = ?");
+    query.prepare(DatabaseQueries::Users::GET_USERNAME);
     query.addBindValue(userId);
 
-    if (query.exec() && query.next()) {
-        return query.value(0).toString();
+    if (!query.exec()) {
+        return QString();
     }
-    return QString();
+    if (!query.next()) {
+        directory.addMissing(userId);
+        return QString();
+    }
+    username = query.value(0).toString();
+    directory.add(userId, username);
+    return username;
 }
 
 quint32 DatabaseManager::getFriendRequestTargetUserId(quint32 userId, int requestId) {
@@ -1571,8 +2087,9 @@ quint32 DatabaseManager::getFriendRequestTargetUserId(quint32 userId, int reques
 
     try {
         QSqlQuery query(database);
-        query.prepare(DatabaseQueries::Invitations::GET_SENT.arg(userId));
+        query.prepare(DatabaseQueries::Invitations::GET_SENT_TARGET);
         query.addBindValue(requestId);
+        query.addBindValue(userId);
 
         if (!query.exec() || !query.next()) {
             qWarning() << "Failed to get invitation details for request ID:" << requestId;
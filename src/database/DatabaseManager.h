@@ -6,17 +6,31 @@
 #include <QSqlQuery>
 #include <QPair>
 #include <QVector>
+#include <QHash>
 #include <QDateTime>
+#include <atomic>
 #include "network/Protocol.h"
 
 // Struktura reprezentująca wiadomość w chacie
 struct ChatMessage {
+    qint64 id = 0;
+    quint64 globalId = 0;  // id z MessageIdGenerator, jak w powiadomieniu; 0 - brak
     QString username;
     QString message;
     QDateTime timestamp;
     bool isRead;
 };
 
+// Wiadomość do zapisu zbiorczego; id jest uzupełniane po zatwierdzeniu
+struct OutgoingMessage {
+    quint32 senderId = 0;
+    quint32 receiverId = 0;
+    QString message;
+    QDateTime sentAt;  // pusta = czas zapisu
+    quint64 globalId = 0;  // MessageIdGenerator; 0 = brak
+    qint64 id = 0;
+};
+
 // Struktura reprezentująca wynik wyszukiwania użytkowników
 struct UserSearchResult {
     quint32 id;
@@ -43,10 +57,74 @@ public:
         QString username;
         QString password;
         int port;
+        int workerThreads = 4;  // wątki DatabaseWorkerPool
 
         static DatabaseConfig instance;
     };
 
+    // Parametry ConnectionPool (sekcja [Pool]), czasy w milisekundach
+    struct PoolConfig {
+        int minSize = 2;
+        int maxSize = 16;
+        int idleTimeout = 300000;
+        int validationInterval = 30000;
+        int acquireTimeout = 5000;
+
+        static PoolConfig instance;
+    };
+
+    // Miejsce przechowywania wiadomości w trakcie migracji z tabel chat_X_Y
+    // do wspólnej tabeli conversation_messages:
+    //  - Legacy: tylko tabele chat_X_Y,
+    //  - DualWrite: zapis do obu, odczyt z chat_X_Y (trwa uzupełnianie historii),
+    //  - Consolidated: tylko conversation_messages.
+    enum class MessageStorage {
+        Legacy,
+        DualWrite,
+        Consolidated
+    };
+
+    // Sekcja [Migration]
+    struct MigrationConfig {
+        MessageStorage messageStorage = MessageStorage::Consolidated;
+        int backfillBatchSize = 1000;
+
+        static MigrationConfig instance;
+    };
+
+    // Sekcja [GroupCommit] - zbiorczy zapis wiadomości przez MessageBatcher
+    struct GroupCommitConfig {
+        int maxBatchSize = 128;  // wiadomości w jednej transakcji
+        int lingerMs = 2;        // jak długo pierwsza wiadomość czeka na kolejne
+        int slowFlushMs = 100;   // próg liczenia wolnych zapisów w metrykach
+
+        static GroupCommitConfig instance;
+    };
+
+    // Sekcja [Journal] - lokalny dziennik wiadomości (MessageJournal)
+    struct JournalConfig {
+        bool enabled = false;
+        QString directory = "journal";
+        QString name = "default";              // klucz punktu kontrolnego w bazie
+        qint64 segmentSize = 16 * 1024 * 1024;  // bajty
+        int drainBatchSize = 500;
+        int retryInterval = 1000;              // ms po nieudanym zapisie do bazy
+
+        static JournalConfig instance;
+    };
+
+    // Sekcja [RecentMessages] - ostatnie wiadomości rozmów w pamięci (RecentMessageCache)
+    struct RecentMessagesConfig {
+        int perConversation = 50;                  // 0 wyłącza pamięć podręczną
+        qint64 budgetBytes = 64 * 1024 * 1024;     // wspólny dla wszystkich rozmów
+
+        static RecentMessagesConfig instance;
+    };
+
+    // Tryb jest wspólny dla wszystkich połączeń; ustawia go SchemaMigrator
+    static MessageStorage messageStorage() { return storageMode.load(); }
+    static void setMessageStorage(MessageStorage mode) { storageMode.store(mode); }
+
     explicit DatabaseManager(QObject *parent = nullptr);
     explicit DatabaseManager(const QString& configPath, QObject *parent = nullptr);
     ~DatabaseManager();
@@ -57,7 +135,16 @@ public:
     QSqlDatabase& getDatabase() { return database; }
     bool isInitialized() const { return initialized; }
     bool cloneConnection(const QString& connectionName);
+    // Podpina połączenie wypożyczone z ConnectionPool na czas jednego zadania
+    void attachConnection(const QSqlDatabase& connection);
+    void detachConnection();
+    // Czy połączenie odpowiada na proste zapytanie - odróżnia awarię bazy od odrzuconych danych
+    bool isConnectionAlive();
     QVector<quint32> getUnreadMessagesUsers(quint32 userId);
+    // Znajomi z nieprzeczytanymi wiadomościami i ich liczba, w kolejności listy znajomych
+    QVector<QPair<quint32, int>> getUnreadCounts(quint32 userId);
+    // Jak wyżej dla już pobranej listy znajomych (logowanie czyta ją raz)
+    QVector<QPair<quint32, int>> getUnreadCounts(quint32 userId, const QVector<QPair<quint32, QString>>& friendsList);
 
 #ifdef QT_DEBUG
     bool reinitializeTables() { return createTablesIfNotExist(); }
@@ -66,28 +153,53 @@ public:
     // Operacje na użytkownikach
     bool registerUser(const QString& username, const QString& password, const QString& email);
     bool authenticateUser(const QString& username, const QString& password, quint32& userId);
+    // Tylko sprawdza hasło - status zalogowanego użytkownika prowadzi PresenceRegistry
+    bool verifyCredentials(const QString& username, const QString& password, quint32& userId);
     bool getUserStatus(quint32 userId, QString& status);
     bool updateUserStatus(quint32 userId, const QString& status);
+    bool updateUserStatuses(const QHash<quint32, QString>& statuses);
+    // Po starcie serwera nikt nie jest zalogowany
+    bool resetUserStatuses();
     QVector<UserSearchResult> searchUsers(const QString& query, quint32 currentUserId); // Nowa metoda
 
     // Operacje na wiadomościach - nowa implementacja chatów
-    bool storeMessage(quint32 senderId, quint32 receiverId, const QString& message);
+    bool storeMessage(quint32 senderId, quint32 receiverId, const QString& message, quint64 globalId = 0);
+    // Wszystkie wiadomości w jednej transakcji, po jednym wielowierszowym INSERT
+    // na tabelę; całość jest zapisywana albo wycofywana. Niepusty journal
+    // przesuwa w tej samej transakcji punkt kontrolny dziennika do journalSequence.
+    bool storeMessages(QVector<OutgoingMessage>& messages,
+                       const QString& journal = QString(), quint64 journalSequence = 0);
+    bool getJournalCheckpoint(const QString& journal, quint64& appliedSequence);
+    bool setJournalCheckpoint(const QString& journal, quint64 appliedSequence);
     QVector<ChatMessage> getChatHistory(quint32 userId1, quint32 userId2,
                                         int offset = 0,
                                         int limit = Protocol::ChatHistory::MESSAGE_BATCH_SIZE);
-    bool hasMoreHistory(quint32 userId1, quint32 userId2, int offset);
+    // Strona historii względem kursora; hasMore wyznacza dodatkowy, limit+1 wiersz.
+    // Starsze wiadomości są zwracane od najnowszej, nowsze - od najstarszej.
+    QVector<ChatMessage> getChatHistoryBefore(quint32 userId1, quint32 userId2,
+                                              qint64 beforeId, int limit, bool& hasMore);
+    QVector<ChatMessage> getChatHistoryAfter(quint32 userId1, quint32 userId2,
+                                             qint64 afterId, int limit, bool& hasMore);
+    bool hasMessagesBefore(quint32 userId1, quint32 userId2, qint64 messageId);
     bool markChatAsRead(quint32 userId, quint32 friendId);
+    // Kursory odczytu rozmowy; false w trybie Legacy, który ich nie prowadzi
+    bool getReadCursors(quint32 userId, quint32 friendId, qint64& ownReadId, qint64& partnerReadId);
+    // Identyfikator rozmowy pary użytkowników; 0 gdy nie istnieje (lub błąd)
+    qint64 conversationId(quint32 userId1, quint32 userId2, bool create = false);
 
     // Operacje na znajomych
     bool addFriend(quint32 userId, quint32 friendId);
     QVector<QPair<quint32, QString>> getFriendsList(quint32 userId);
+    // Cała tabela friendships dla FriendGraph; usernames: id znajomego -> nazwa
+    bool getAllFriendships(QVector<QPair<quint32, quint32>>& edges, QHash<quint32, QString>& usernames);
+    // Cała tabela users dla UserDirectory
+    bool getAllUsers(QVector<QPair<quint32, QString>>& users);
     QVector<ChatMessage> getLatestMessages(quint32 userId1, quint32 userId2,
                                            int limit = Protocol::ChatHistory::MESSAGE_BATCH_SIZE);
     QVector<QJsonObject> getNewMessages(quint32 userId, qint64 lastMessageId);
     bool removeFriend(quint32 userId, quint32 friendId);
 
     // Operacje na zaproszeniach
-    bool createInvitationTables(quint32 userId);
     bool sendFriendInvitation(quint32 fromUserId, quint32 toUserId);
     bool acceptFriendInvitation(quint32 userId, int requestId);
     bool rejectFriendInvitation(quint32 userId, int requestId);
@@ -108,29 +220,46 @@ private:
     bool userExists(quint32 userId);
     QString generateSalt();
     QString hashPassword(const QString& password);
-    bool createFriendsList(quint32 userId);
 
     // Nowe metody pomocnicze dla chatów
     QString getChatTableName(quint32 userId1, quint32 userId2);
     bool createChatTableIfNotExists(quint32 userId1, quint32 userId2);
     bool chatTableExists(const QString& tableName);
+    QVector<ChatMessage> getChatHistoryPage(const QString& legacyTemplate, const QString& consolidatedQuery,
+                                            quint32 userId1, quint32 userId2,
+                                            qint64 cursorId, int limit, bool& hasMore);
+    // Przygotowuje zapytanie o wiadomości pary w bieżącym trybie odczytu: dla
+    // conversation_messages wiąże conversation_id jako pierwszy parametr, dla
+    // chat_X_Y wstawia nazwę tabeli. false, gdy para nie ma jeszcze wiadomości.
+    bool prepareChatQuery(QSqlQuery& query, const QString& legacyTemplate,
+                          const QString& consolidatedQuery, quint32 userId1, quint32 userId2);
+    qint64 conversationHead(qint64 conversationId);
+    // Wczytuje rozmowę do RecentMessageCache i zwraca limit najnowszych wiadomości
+    bool loadRecentMessages(qint64 conversationId, int limit, QVector<ChatMessage>& messages);
+    bool advanceReadCursor(quint32 userId, qint64 conversationId, qint64 messageId);
+    // Nazwa nadawcy z UserDirectory zamiast złączenia z users
+    ChatMessage chatMessageFromQuery(const QSqlQuery& query);
     void createChatIndexes(const QString& tableName);
 
     // Metody pomocnicze dla zaproszeń
     bool checkPendingInvitation(quint32 fromUserId, quint32 toUserId);
+    // Jedna instrukcja po kluczu głównym; isSender wybiera stronę, która musi być właścicielem
     bool updateInvitationStatus(quint32 userId, int requestId, const QString& status, bool isSender);
-    bool updateBothInvitationStatuses(quint32 fromUserId, quint32 toUserId, int requestId, const QString& status);
 
     // Stałe
     static constexpr int SALT_LENGTH = 16;
+    static constexpr int STATUS_BATCH_SIZE = 500;
 
     static bool mainInitialized;
+    static std::atomic<MessageStorage> storageMode;
 
     // Pola prywatne
     QString configFilePath;
     QSqlDatabase database;
     bool initialized;
     QString mainConnectionName;
+    // Para (mniejsze id << 32 | większe id) -> id rozmowy; rozmowy nie są usuwane
+    QHash<quint64, qint64> conversationCache;
 };
 
 #endif // DATABASEMANAGER_H
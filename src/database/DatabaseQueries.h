@@ -9,10 +9,9 @@ namespace DatabaseQueries {
 namespace Tables {
 const QString USERS = "users";
 const QString SESSIONS = "user_sessions";
-const QString FRIENDS_PREFIX = "user_%1_friends"; // %1 będzie zastąpione przez user_id
+const QString FRIENDSHIPS = "friendships";
 const QString CHAT_PREFIX = "chat_%1_%2"; // %1, %2 będą ID użytkowników (mniejsze_ID_większe_ID)
-const QString SENT_INVITATIONS_PREFIX = "user_%1_sent_invitations"; // %1 będzie ID użytkownika
-const QString RECEIVED_INVITATIONS_PREFIX = "user_%1_received_invitations"; // %1 będzie ID użytkownika
+const QString FRIEND_INVITATIONS = "friend_invitations";
 }
 
 // Zapytania do tworzenia tabel
@@ -39,11 +38,14 @@ const QString SESSIONS_TABLE =
     "FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE"
     ") ENGINE=InnoDB;";
 
-const QString FRIENDS_TABLE =
-    "CREATE TABLE IF NOT EXISTS user_%1_friends ("
+// Jedna tabela sąsiedztwa; każda znajomość to dwa wiersze (po jednym w każdą stronę)
+const QString FRIENDSHIPS_TABLE =
+    "CREATE TABLE IF NOT EXISTS friendships ("
+    "user_id INT NOT NULL, "
     "friend_id INT NOT NULL, "
     "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-    "FOREIGN KEY (friend_id) REFERENCES users(id)"
+    "PRIMARY KEY (user_id, friend_id), "
+    "KEY idx_friendships_friend (friend_id)"
     ") ENGINE=InnoDB;";
 
 const QString CHAT_TABLE =
@@ -56,30 +58,75 @@ const QString CHAT_TABLE =
     "FOREIGN KEY (sender_id) REFERENCES users(id)"
     ") ENGINE=InnoDB;";
 
-const QString CHAT_INDEXES =
-    "CREATE INDEX IF NOT EXISTS idx_%1_timestamp ON %1(sent_at);"
-    "CREATE INDEX IF NOT EXISTS idx_%1_unread ON %1(read_at) WHERE read_at IS NULL;";
-
-const QString SENT_INVITATIONS_TABLE =
-    "CREATE TABLE IF NOT EXISTS user_%1_sent_invitations ("
-    "request_id INT AUTO_INCREMENT PRIMARY KEY, "
-    "to_user_id INT NOT NULL, "
-    "to_username VARCHAR(32) NOT NULL, "
-    "status ENUM('pending', 'accepted', 'rejected', 'cancelled') DEFAULT 'pending', "
+// Wspólna tabela wiadomości; rekordy jednej rozmowy leżą obok siebie
+// w indeksie klastrowym (conversation_id, message_id)
+const QString CONVERSATIONS_TABLE =
+    "CREATE TABLE IF NOT EXISTS conversations ("
+    "id BIGINT AUTO_INCREMENT PRIMARY KEY, "
+    "user_low INT NOT NULL, "
+    "user_high INT NOT NULL, "
+    "last_message_id BIGINT NOT NULL DEFAULT 0, "
     "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+    "UNIQUE KEY uq_conversation_pair (user_low, user_high), "
+    "KEY idx_conversation_high (user_high)"
+    ") ENGINE=InnoDB;";
+
+const QString CONVERSATION_MESSAGES_TABLE =
+    "CREATE TABLE IF NOT EXISTS conversation_messages ("
+    "conversation_id BIGINT NOT NULL, "
+    "message_id BIGINT NOT NULL, "
+    "sender_id INT NOT NULL, "
+    "message TEXT NOT NULL, "
+    "sent_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+    "read_at TIMESTAMP NULL, "
+    "global_id BIGINT UNSIGNED NULL, "  // MessageIdGenerator; NULL dla historii sprzed jego wprowadzenia
+    "PRIMARY KEY (conversation_id, message_id), "
+    "UNIQUE KEY uq_message_global (global_id)"
+    ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci;";
+
+// Ostatnia przeczytana wiadomość użytkownika w rozmowie; nieprzeczytane są
+// wiadomości o id większym niż kursor, aż do conversations.last_message_id
+const QString READ_CURSORS_TABLE =
+    "CREATE TABLE IF NOT EXISTS read_cursors ("
+    "user_id INT NOT NULL, "
+    "conversation_id BIGINT NOT NULL, "
+    "last_read_id BIGINT NOT NULL DEFAULT 0, "
     "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP, "
-    "FOREIGN KEY (to_user_id) REFERENCES users(id)"
+    "PRIMARY KEY (user_id, conversation_id)"
     ") ENGINE=InnoDB;";
 
-const QString RECEIVED_INVITATIONS_TABLE =
-    "CREATE TABLE IF NOT EXISTS user_%1_received_invitations ("
-    "request_id INT AUTO_INCREMENT PRIMARY KEY, "
+// Ostatni rekord dziennika wiadomości zapisany do bazy - aktualizowany
+// w tej samej transakcji co wiadomości, więc odtworzenie nie tworzy duplikatów
+const QString JOURNAL_CHECKPOINTS_TABLE =
+    "CREATE TABLE IF NOT EXISTS journal_checkpoints ("
+    "journal VARCHAR(64) PRIMARY KEY, "
+    "applied_sequence BIGINT UNSIGNED NOT NULL DEFAULT 0, "
+    "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP"
+    ") ENGINE=InnoDB;";
+
+const QString SCHEMA_MIGRATIONS_TABLE =
+    "CREATE TABLE IF NOT EXISTS schema_migrations ("
+    "name VARCHAR(64) PRIMARY KEY, "
+    "state VARCHAR(32) NOT NULL, "
+    "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP"
+    ") ENGINE=InnoDB;";
+
+const QString CHAT_INDEXES =
+    "CREATE INDEX IF NOT EXISTS idx_%1_timestamp ON %1(sent_at);"
+    "CREATE INDEX IF NOT EXISTS idx_%1_unread ON %1(read_at) WHERE read_at IS NULL;";
+
+// Jedno zaproszenie to jeden wiersz; oczekujące zaproszenia użytkownika
+// wyszukuje się po (to_user_id, status) lub (from_user_id, status)
+const QString FRIEND_INVITATIONS_TABLE =
+    "CREATE TABLE IF NOT EXISTS friend_invitations ("
+    "id INT AUTO_INCREMENT PRIMARY KEY, "
     "from_user_id INT NOT NULL, "
-    "from_username VARCHAR(32) NOT NULL, "
-    "status ENUM('pending', 'accepted', 'rejected', 'cancelled') DEFAULT 'pending', "
+    "to_user_id INT NOT NULL, "
+    "status ENUM('pending', 'accepted', 'rejected', 'cancelled') NOT NULL DEFAULT 'pending', "
     "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
     "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP, "
-    "FOREIGN KEY (from_user_id) REFERENCES users(id)"
+    "KEY idx_invitations_to (to_user_id, status), "
+    "KEY idx_invitations_from (from_user_id, status)"
     ") ENGINE=InnoDB;";
 
 
@@ -103,14 +150,18 @@ const QString UPDATE_STATUS =
 const QString GET_STATUS =
     "SELECT status FROM users WHERE id = ?";
 
-// Sprawdzanie istnienia
-const QString EXISTS_BY_NAME =
-    "SELECT COUNT(*) FROM users WHERE username = ?";
+// %1 - pary "WHEN ? THEN ?", %2 - znaki zapytania dla listy id
+const QString UPDATE_STATUS_BATCH =
+    "UPDATE users SET status = CASE id %1 END, last_login = CURRENT_TIMESTAMP "
+    "WHERE id IN (%2)";
 
-const QString EXISTS_BY_ID =
-    "SELECT COUNT(*) FROM users WHERE id = ?";
+const QString RESET_STATUSES =
+    "UPDATE users SET status = 'offline' WHERE status <> 'offline'";
+
+// Pobieranie informacji; wyniki trafiają do UserDirectory
+const QString FIND_BY_NAME =
+    "SELECT id, username FROM users WHERE username = ?";
 
-// Pobieranie informacji
 const QString GET_USERNAME =
     "SELECT username FROM users WHERE id = ?";
 
@@ -122,6 +173,10 @@ const QString UPDATE_LAST_LOGIN =
     "UPDATE users SET last_login = CURRENT_TIMESTAMP "
     "WHERE id = ?";
 
+// Cała tabela dla UserDirectory
+const QString LOAD_ALL =
+    "SELECT id, username FROM users";
+
 const QString SEARCH_USERS =
     "SELECT id, username FROM users "
     "WHERE username LIKE ? "
@@ -136,24 +191,46 @@ const QString STORE_IN_CHAT =
     "INSERT INTO %1 (sender_id, message) "  // %1 będzie nazwą tabeli chat_X_Y
     "VALUES (?, ?)";
 
+// Zapis zbiorczy; %2 to lista "(?, ?, ?), ..." - id wierszy są kolejne od lastInsertId
+const QString STORE_ROWS_IN_CHAT =
+    "INSERT INTO %1 (sender_id, message, sent_at) VALUES %2";
+
 const QString GET_CHAT_HISTORY =
-    "SELECT c.id, u.username, c.message, c.sent_at, c.read_at "
+    "SELECT c.id, c.sender_id, c.message, c.sent_at, (c.read_at IS NOT NULL) AS is_read, "
+    "NULL AS global_id "  // chat_X_Y nie przechowują id z MessageIdGenerator
     "FROM %1 c "  // %1 będzie nazwą tabeli chat_X_Y
-    "INNER JOIN users u ON c.sender_id = u.id "
-    "ORDER BY c.sent_at DESC, c.id DESC "  // Dodano sortowanie po ID
+    "ORDER BY c.id DESC "  // kolejność wstawiania; sent_at ma rozdzielczość sekundy
     "LIMIT ? OFFSET ?";
 
+// Stronicowanie po kluczu głównym - koszt strony nie zależy od tego,
+// jak daleko w historii jest kursor
+const QString GET_CHAT_HISTORY_BEFORE =
+    "SELECT c.id, c.sender_id, c.message, c.sent_at, (c.read_at IS NOT NULL) AS is_read, "
+    "NULL AS global_id "
+    "FROM %1 c "
+    "WHERE c.id < ? "
+    "ORDER BY c.id DESC "
+    "LIMIT ?";
+
+const QString GET_CHAT_HISTORY_AFTER =
+    "SELECT c.id, c.sender_id, c.message, c.sent_at, (c.read_at IS NOT NULL) AS is_read, "
+    "NULL AS global_id "
+    "FROM %1 c "
+    "WHERE c.id > ? "
+    "ORDER BY c.id ASC "
+    "LIMIT ?";
+
+const QString HAS_MESSAGES_BEFORE =
+    "SELECT 1 FROM %1 WHERE id < ? LIMIT 1";
+
 const QString GET_LATEST_MESSAGES =
-    "SELECT c.id, u.username, c.message, c.sent_at, c.read_at "
+    "SELECT c.id, c.sender_id, c.message, c.sent_at, (c.read_at IS NOT NULL) AS is_read, "
+    "NULL AS global_id "
     "FROM %1 c "
-    "INNER JOIN users u ON c.sender_id = u.id "
     "WHERE c.id <= (SELECT MAX(id) FROM %1) "  // pobierz od najwyższego ID
     "AND c.id > (SELECT MAX(id) FROM %1) - ? "  // limit określa ile wiadomości od końca
     "ORDER BY c.sent_at ASC, c.id ASC";  // sortuj rosnąco dla prawidłowej kolejności
 
-const QString GET_MESSAGES_COUNT =
-    "SELECT COUNT(*) FROM %1";  // %1 będzie nazwą tabeli chat_X_Y
-
 const QString MARK_CHAT_READ =
     "UPDATE %1 "  // %1 będzie nazwą tabeli chat_X_Y
     "SET read_at = CURRENT_TIMESTAMP "
@@ -163,6 +240,17 @@ const QString GET_UNREAD_COUNT =
     "SELECT COUNT(*) FROM %1 "  // %1 będzie nazwą tabeli chat_X_Y
     "WHERE sender_id != ? AND read_at IS NULL";
 
+// Które z tabel chat_X_Y istnieją; %1 to lista "(?, ...)"
+const QString FIND_CHAT_TABLES =
+    "SELECT table_name FROM information_schema.tables "
+    "WHERE table_schema = DATABASE() AND table_name IN %1";
+
+// Jedna część UNION ALL na rozmowę - liczniki wszystkich rozmów jednym zapytaniem;
+// %1 to tabela chat_X_Y, %2 - id znajomego
+const QString UNREAD_COUNT_PART =
+    "SELECT %2 AS friend_id, COUNT(*) FROM %1 "
+    "WHERE sender_id != ? AND read_at IS NULL";
+
 const QString CHECK_CHAT_TABLE_EXISTS =
     "SELECT COUNT(*) FROM information_schema.tables "
     "WHERE table_schema = DATABASE() AND table_name = ?";
@@ -177,29 +265,207 @@ const QString GET_NEW_MESSAGES =
     "ORDER BY m.sent_at ASC, m.id ASC";
 }
 
+// Wiadomości we wspólnej tabeli conversation_messages; pierwszym parametrem
+// zapytań o rozmowę jest conversation_id
+namespace Conversations {
+const QString FIND =
+    "SELECT id FROM conversations WHERE user_low = ? AND user_high = ?";
+
+const QString CREATE =
+    "INSERT IGNORE INTO conversations (user_low, user_high) VALUES (?, ?)";
+
+// Rezerwuje kolejne numery wiadomości rozmowy (LAST_INSERT_ID zwraca ostatni);
+// blokada wiersza szereguje zapisy w rozmowie
+const QString ALLOCATE_MESSAGE_IDS =
+    "UPDATE conversations SET last_message_id = LAST_INSERT_ID(last_message_id + ?) "
+    "WHERE id = ?";
+
+const QString LAST_INSERT_ID =
+    "SELECT LAST_INSERT_ID()";
+
+// Zapis podwójny i migracja zachowują identyfikatory z chat_X_Y
+const QString RAISE_MESSAGE_ID =
+    "UPDATE conversations SET last_message_id = GREATEST(last_message_id, ?) "
+    "WHERE id = ?";
+
+// %1 to lista "(?, ?, ?, ?, ?, ?), ..." - jeden wiersz na wiadomość
+const QString STORE_MESSAGES =
+    "INSERT INTO conversation_messages (conversation_id, message_id, sender_id, message, sent_at, global_id) "
+    "VALUES %1";
+
+const QString GET_HISTORY =
+    "SELECT m.message_id AS id, m.sender_id, m.message, m.sent_at, "
+    "(m.message_id <= COALESCE(rc.last_read_id, 0)) AS is_read, m.global_id "
+    "FROM conversation_messages m "
+    "LEFT JOIN read_cursors rc ON rc.conversation_id = m.conversation_id AND rc.user_id != m.sender_id "
+    "WHERE m.conversation_id = ? "
+    "ORDER BY m.message_id DESC "
+    "LIMIT ? OFFSET ?";
+
+const QString GET_HISTORY_BEFORE =
+    "SELECT m.message_id AS id, m.sender_id, m.message, m.sent_at, "
+    "(m.message_id <= COALESCE(rc.last_read_id, 0)) AS is_read, m.global_id "
+    "FROM conversation_messages m "
+    "LEFT JOIN read_cursors rc ON rc.conversation_id = m.conversation_id AND rc.user_id != m.sender_id "
+    "WHERE m.conversation_id = ? AND m.message_id < ? "
+    "ORDER BY m.message_id DESC "
+    "LIMIT ?";
+
+const QString GET_HISTORY_AFTER =
+    "SELECT m.message_id AS id, m.sender_id, m.message, m.sent_at, "
+    "(m.message_id <= COALESCE(rc.last_read_id, 0)) AS is_read, m.global_id "
+    "FROM conversation_messages m "
+    "LEFT JOIN read_cursors rc ON rc.conversation_id = m.conversation_id AND rc.user_id != m.sender_id "
+    "WHERE m.conversation_id = ? AND m.message_id > ? "
+    "ORDER BY m.message_id ASC "
+    "LIMIT ?";
+
+// Malejąco - wynik jest odwracany, żeby zachować kolejność GET_LATEST_MESSAGES
+const QString GET_LATEST =
+    "SELECT m.message_id AS id, m.sender_id, m.message, m.sent_at, "
+    "(m.message_id <= COALESCE(rc.last_read_id, 0)) AS is_read, m.global_id "
+    "FROM conversation_messages m "
+    "LEFT JOIN read_cursors rc ON rc.conversation_id = m.conversation_id AND rc.user_id != m.sender_id "
+    "WHERE m.conversation_id = ? "
+    "ORDER BY m.message_id DESC "
+    "LIMIT ?";
+
+// Wiersze dla RecentMessageCache - z id nadawcy, bez is_read (liczone z kursorów)
+const QString GET_RECENT =
+    "SELECT m.message_id, m.sender_id, m.message, m.sent_at, m.global_id "
+    "FROM conversation_messages m "
+    "WHERE m.conversation_id = ? "
+    "ORDER BY m.message_id DESC "
+    "LIMIT ?";
+
+const QString HAS_MESSAGES_BEFORE =
+    "SELECT 1 FROM conversation_messages "
+    "WHERE conversation_id = ? AND message_id < ? LIMIT 1";
+
+const QString GET_HEAD =
+    "SELECT last_message_id FROM conversations WHERE id = ?";
+
+// Kursor tylko rośnie - spóźnione oznaczenie nie cofa nowszego
+const QString ADVANCE_READ_CURSOR =
+    "INSERT INTO read_cursors (user_id, conversation_id, last_read_id) VALUES (?, ?, ?) "
+    "ON DUPLICATE KEY UPDATE last_read_id = GREATEST(last_read_id, VALUES(last_read_id))";
+
+// Kursory obu uczestników rozmowy
+const QString GET_READ_CURSORS =
+    "SELECT user_id, last_read_id FROM read_cursors WHERE conversation_id = ?";
+
+// Wszystkie rozmowy użytkownika z jego kursorem - jedno zapytanie zamiast
+// osobnego COUNT(*) na każdego znajomego
+// Nieprzeczytane to wiadomości rozmówcy powyżej kursora - liczone, bo id
+// przeniesione z chat_X_Y mogą mieć luki; podzapytanie czyta tylko zakres
+// klucza głównego nad kursorem
+const QString GET_READ_STATE =
+    "SELECT c.id, IF(c.user_low = ?, c.user_high, c.user_low) AS partner_id, "
+    "c.last_message_id, COALESCE(rc.last_read_id, 0) AS last_read_id, "
+    "(SELECT COUNT(*) FROM conversation_messages m "
+    "WHERE m.conversation_id = c.id AND m.message_id > COALESCE(rc.last_read_id, 0) "
+    "AND m.sender_id != ?) AS unread "
+    "FROM conversations c "
+    "LEFT JOIN read_cursors rc ON rc.conversation_id = c.id AND rc.user_id = ? "
+    "WHERE c.user_low = ? OR c.user_high = ?";
+}
+
+// Stan migracji schematu
+namespace Migrations {
+const QString CONSOLIDATED_MESSAGES = "consolidated_messages";
+const QString FRIENDSHIPS = "friendships";
+const QString FRIEND_INVITATIONS = "friend_invitations";
+const QString MESSAGE_GLOBAL_IDS = "message_global_ids";
+
+const QString GET_STATE =
+    "SELECT state FROM schema_migrations WHERE name = ?";
+
+const QString SET_STATE =
+    "INSERT INTO schema_migrations (name, state) VALUES (?, ?) "
+    "ON DUPLICATE KEY UPDATE state = VALUES(state)";
+
+const QString LIST_CHAT_TABLES =
+    "SELECT table_name FROM information_schema.tables "
+    "WHERE table_schema = DATABASE() AND table_name LIKE 'chat\\_%\\_%'";
+
+const QString LIST_FRIEND_TABLES =
+    "SELECT table_name FROM information_schema.tables "
+    "WHERE table_schema = DATABASE() AND table_name LIKE 'user\\_%\\_friends'";
+
+// %1 - id właściciela tabeli, %2 - nazwa tabeli user_X_friends
+const QString COPY_FRIEND_TABLE =
+    "INSERT IGNORE INTO friendships (user_id, friend_id) "
+    "SELECT %1, friend_id FROM %2";
+
+const QString LIST_SENT_INVITATION_TABLES =
+    "SELECT table_name FROM information_schema.tables "
+    "WHERE table_schema = DATABASE() AND table_name LIKE 'user\\_%\\_sent\\_invitations'";
+
+// Tabele wysłanych zaproszeń zawierają każde zaproszenie dokładnie raz;
+// %1 - id nadawcy, %2 - nazwa tabeli user_X_sent_invitations
+const QString COPY_SENT_INVITATIONS =
+    "INSERT INTO friend_invitations (from_user_id, to_user_id, status, created_at, updated_at) "
+    "SELECT %1, to_user_id, status, created_at, updated_at FROM %2";
+
+// Kursor uczestnika %2 z read_at wiadomości od rozmówcy; %1 - tabela chat_X_Y
+const QString SEED_READ_CURSOR =
+    "INSERT INTO read_cursors (user_id, conversation_id, last_read_id) "
+    "SELECT %2, ?, COALESCE(MAX(id), 0) FROM %1 WHERE sender_id != %2 AND read_at IS NOT NULL "
+    "ON DUPLICATE KEY UPDATE last_read_id = GREATEST(last_read_id, VALUES(last_read_id))";
+
+// Tabele utworzone przed wprowadzeniem MessageIdGenerator nie mają kolumny global_id
+const QString HAS_GLOBAL_ID_COLUMN =
+    "SELECT COUNT(*) FROM information_schema.columns "
+    "WHERE table_schema = DATABASE() AND table_name = 'conversation_messages' "
+    "AND column_name = 'global_id'";
+
+const QString ADD_GLOBAL_ID_COLUMN =
+    "ALTER TABLE conversation_messages "
+    "ADD COLUMN global_id BIGINT UNSIGNED NULL, "
+    "ADD UNIQUE KEY uq_message_global (global_id)";
+
+const QString CHAT_TABLE_MAX_ID =
+    "SELECT COALESCE(MAX(id), 0) FROM %1";
+
+// Wiersze zapisane już przez zapis podwójny są pomijane dzięki INSERT IGNORE
+const QString BACKFILL_CHAT_TABLE =
+    "INSERT IGNORE INTO conversation_messages "
+    "(conversation_id, message_id, sender_id, message, sent_at, read_at) "
+    "SELECT ?, id, sender_id, message, sent_at, read_at FROM %1 "
+    "WHERE id > ? AND id <= ?";
+}
+
 // Zapytania związane ze znajomymi
 namespace Friends {
 const QString LIST =
     "SELECT u.id, u.username, u.status "
-    "FROM users u "
-    "INNER JOIN user_%1_friends f ON f.friend_id = u.id "
+    "FROM friendships f "
+    "INNER JOIN users u ON f.friend_id = u.id "
+    "WHERE f.user_id = ? "
     "ORDER BY u.status, u.username";
 
 const QString ADD =
-    "INSERT INTO user_%1_friends (friend_id) VALUES (?)";
+    "INSERT IGNORE INTO friendships (user_id, friend_id) VALUES (?, ?)";
 
 const QString REMOVE =
-    "DELETE FROM user_%1_friends WHERE friend_id = ?";
+    "DELETE FROM friendships WHERE user_id = ? AND friend_id = ?";
 
 const QString CHECK =
-    "SELECT COUNT(*) FROM user_%1_friends "
-    "WHERE friend_id = ?";
+    "SELECT COUNT(*) FROM friendships "
+    "WHERE user_id = ? AND friend_id = ?";
 
 const QString GET_ONLINE =
     "SELECT u.id, u.username "
-    "FROM users u "
-    "INNER JOIN user_%1_friends f ON f.friend_id = u.id "
-    "WHERE u.status = 'online'";
+    "FROM friendships f "
+    "INNER JOIN users u ON f.friend_id = u.id "
+    "WHERE f.user_id = ? AND u.status = 'online'";
+
+// Cała tabela dla FriendGraph, w kolejności wierszy CSR
+const QString LOAD_ALL =
+    "SELECT f.user_id, f.friend_id, u.username "
+    "FROM friendships f "
+    "INNER JOIN users u ON f.friend_id = u.id "
+    "ORDER BY f.user_id, f.friend_id";
 }
 
 // Zapytania związane z sesjami
@@ -225,52 +491,45 @@ const QString CLEANUP =
 }
 
 namespace Invitations {
-// Zapytania dla wysyłającego
-const QString ADD_SENT =
-    "INSERT INTO user_%1_sent_invitations "
-    "(to_user_id, to_username) "
-    "VALUES (?, ?)";
-
-const QString UPDATE_SENT_STATUS =
-    "UPDATE user_%1_sent_invitations "
-    "SET status = ? "
-    "WHERE request_id = ?";
+const QString ADD =
+    "INSERT INTO friend_invitations (from_user_id, to_user_id) VALUES (?, ?)";
 
 const QString GET_SENT =
-    "SELECT request_id, to_user_id, to_username, status, created_at "
-    "FROM user_%1_sent_invitations "
-    "WHERE status = 'pending' "
-    "ORDER BY created_at DESC";
-
-// Zapytania dla otrzymującego
-const QString ADD_RECEIVED =
-    "INSERT INTO user_%1_received_invitations "
-    "(from_user_id, from_username) "
-    "VALUES (?, ?)";
-
-const QString UPDATE_RECEIVED_STATUS =
-    "UPDATE user_%1_received_invitations "
-    "SET status = ? "
-    "WHERE request_id = ?";
+    "SELECT i.id AS request_id, i.to_user_id, u.username AS to_username, i.status, i.created_at "
+    "FROM friend_invitations i "
+    "INNER JOIN users u ON i.to_user_id = u.id "
+    "WHERE i.from_user_id = ? AND i.status = 'pending' "
+    "ORDER BY i.created_at DESC";
 
 const QString GET_RECEIVED =
-    "SELECT request_id, from_user_id, from_username, status, created_at "
-    "FROM user_%1_received_invitations "
-    "WHERE status = 'pending' "
-    "ORDER BY created_at DESC";
-
-// Zapytania sprawdzające
-const QString CHECK_PENDING =
-    "SELECT COUNT(*) FROM user_%1_sent_invitations "
-    "WHERE to_user_id = ? AND status = 'pending'";
+    "SELECT i.id AS request_id, i.from_user_id, u.username AS from_username, i.status, i.created_at "
+    "FROM friend_invitations i "
+    "INNER JOIN users u ON i.from_user_id = u.id "
+    "WHERE i.to_user_id = ? AND i.status = 'pending' "
+    "ORDER BY i.created_at DESC";
+
+// Oczekujące zaproszenie otrzymane przez użytkownika; blokuje wiersz do końca transakcji
+const QString GET_PENDING_RECEIVED =
+    "SELECT from_user_id FROM friend_invitations "
+    "WHERE id = ? AND to_user_id = ? AND status = 'pending' "
+    "FOR UPDATE";
+
+const QString GET_SENT_TARGET =
+    "SELECT to_user_id FROM friend_invitations "
+    "WHERE id = ? AND from_user_id = ?";
+
+// Zmiana statusu po kluczu głównym; drugi warunek sprawdza stronę zaproszenia
+const QString UPDATE_SENT_STATUS =
+    "UPDATE friend_invitations SET status = ? "
+    "WHERE id = ? AND from_user_id = ? AND status = 'pending'";
 
-const QString GET_REQUEST_STATUS =
-    "SELECT status FROM user_%1_sent_invitations "
-    "WHERE request_id = ?";
+const QString UPDATE_RECEIVED_STATUS =
+    "UPDATE friend_invitations SET status = ? "
+    "WHERE id = ? AND to_user_id = ? AND status = 'pending'";
 
-const QString CHECK_REQUEST_EXISTS =
-    "SELECT COUNT(*) FROM user_%1_received_invitations "
-    "WHERE request_id = ? AND from_user_id = ?";
+const QString CHECK_PENDING =
+    "SELECT COUNT(*) FROM friend_invitations "
+    "WHERE from_user_id = ? AND to_user_id = ? AND status = 'pending'";
 
 // Sprawdzanie czy użytkownik istnieje
 const QString CHECK_USER_EXISTS =
@@ -278,115 +537,23 @@ const QString CHECK_USER_EXISTS =
 
 // Sprawdzanie czy już są znajomymi
 const QString CHECK_IF_FRIENDS =
-    "SELECT COUNT(*) FROM user_%1_friends WHERE friend_id = ?";
-
-// Sprawdzanie czy jest już oczekujące zaproszenie
-const QString CHECK_PENDING_INVITATION =
-    "SELECT COUNT(*) FROM user_%1_sent_invitations "
-    "WHERE to_user_id = ? AND status = 'pending'";
-
-// Dodawanie zaproszenia wysłanego
-const QString ADD_FRIEND_REQUEST_SENT =
-    "INSERT INTO user_%1_sent_invitations (to_user_id, to_username) "
-    "SELECT id, username FROM users WHERE id = ?";
+    "SELECT COUNT(*) FROM friendships WHERE user_id = ? AND friend_id = ?";
+}
 
-// Dodawanie zaproszenia otrzymanego
-const QString ADD_FRIEND_REQUEST_RECEIVED =
-    "INSERT INTO user_%1_received_invitations (from_user_id, from_username) "
-    "SELECT id, username FROM users WHERE id = ?";
+// Punkt kontrolny MessageJournal
+namespace Journal {
+const QString GET_CHECKPOINT =
+    "SELECT applied_sequence FROM journal_checkpoints WHERE journal = ?";
 
-// Pobieranie nazwy użytkownika dla zaproszenia
-const QString GET_USERNAME_FOR_INVITATION =
-    "SELECT username FROM users WHERE id = ?";
+// Samodzielnie także po rekordzie przeniesionym do kwarantanny
+const QString SET_CHECKPOINT =
+    "INSERT INTO journal_checkpoints (journal, applied_sequence) VALUES (?, ?) "
+    "ON DUPLICATE KEY UPDATE applied_sequence = GREATEST(applied_sequence, VALUES(applied_sequence))";
+}
 
-const QString GET_SENT_INVITATION_DETAILS =
-    "SELECT to_user_id, created_at FROM user_%1_sent_invitations "
-    "WHERE request_id = ? AND status = 'pending'";
-
-const QString UPDATE_SENT_INVITATION_STATUS =
-    "UPDATE user_%1_sent_invitations "
-    "SET status = ? "
-    "WHERE request_id = ? AND status = 'pending'";
-
-const QString UPDATE_RECEIVED_INVITATION_STATUS =
-    "UPDATE user_%1_received_invitations "
-    "SET status = ? "
-    "WHERE request_id = ? AND status = 'pending'";
-
-const QString UPDATE_RECEIVED_INVITATION_STATUS_BY_TIMESTAMP =
-    "UPDATE user_%1_received_invitations "
-    "SET status = ? "
-    "WHERE from_user_id = ? "
-    "AND created_at = ? "
-    "AND status = 'pending'";
-
-const QString GET_RECEIVED_INVITATION_DETAILS =
-    "SELECT from_user_id, created_at, status FROM user_%1_received_invitations "
-    "WHERE request_id = ?";
-
-const QString UPDATE_INVITATION_STATUS_REJECTED =
-    "UPDATE user_%1_sent_invitations "
-    "SET status = 'rejected' "
-    "WHERE to_user_id = ? "
-    "AND created_at = ? "
-    "AND status = 'pending'";
-
-const QString UPDATE_RECEIVED_INVITATION_STATUS_REJECTED =
-    "UPDATE user_%1_received_invitations "
-    "SET status = 'rejected' "
-    "WHERE request_id = ? AND status = 'pending'";
-
-const QString UPDATE_RECEIVED_INVITATION_STATUS_SIMPLE =
-    "UPDATE user_%1_received_invitations "
-    "SET status = ? "
-    "WHERE request_id = ?";
-
-const QString UPDATE_SENT_INVITATION_STATUS_SIMPLE =
-    "UPDATE user_%1_sent_invitations "
-    "SET status = ? "
-    "WHERE to_user_id = ? "
-    "AND created_at = ?";
-
-const QString GET_RECEIVED_INVITATION_FOR_ACCEPT =
-    "SELECT from_user_id, created_at, status "
-    "FROM user_%1_received_invitations "
-    "WHERE request_id = ?";
-
-const QString UPDATE_RECEIVED_INVITATION_ACCEPT =
-    "UPDATE user_%1_received_invitations "
-    "SET status = 'accepted' "
-    "WHERE request_id = ?";
-
-const QString UPDATE_SENT_INVITATION_ACCEPT =
-    "UPDATE user_%1_sent_invitations "
-    "SET status = 'accepted' "
-    "WHERE to_user_id = ? "
-    "AND created_at = ?";
-
-const QString GET_FRIEND_INVITATION_INFO =
-    "SELECT from_user_id, created_at, status FROM user_%1_received_invitations "
-    "WHERE request_id = ?";
-
-const QString UPDATE_RECEIVED_INVITATION_STATUS_ACCEPT =
-    "UPDATE user_%1_received_invitations "
-    "SET status = ? "
-    "WHERE request_id = ?";
-
-const QString UPDATE_SENT_INVITATION_STATUS_ACCEPT =
-    "UPDATE user_%1_sent_invitations "
-    "SET status = ? "
-    "WHERE to_user_id = ? "
-    "AND created_at = ?";
-
-const QString CREATE_CHAT_TABLE =
-    "CREATE TABLE IF NOT EXISTS %1 ("
-    "message_id INT AUTO_INCREMENT PRIMARY KEY, "
-    "sender_id INT NOT NULL, "
-    "message TEXT NOT NULL, "
-    "sent_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-    "read_at TIMESTAMP NULL DEFAULT NULL, "
-    "FOREIGN KEY (sender_id) REFERENCES users(id)"
-    ") ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COLLATE=utf8mb4_unicode_ci";
+// Zapytania puli połączeń
+namespace Pool {
+const QString VALIDATE = "SELECT 1";
 }
 
 } // namespace DatabaseQueries
@@ -0,0 +1,127 @@
+/**
+ * @file DatabaseWorkerPool.cpp
+ * @brief Pool of database threads executing queries off the network threads
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "DatabaseWorkerPool.h"
+#include "DatabaseManager.h"
+#include <QThread>
+#include <QDebug>
+
+DatabaseWorker::DatabaseWorker(int index, QObject *parent)
+    : QObject(parent)
+    , m_index(index)
+{
+}
+
+DatabaseWorker::~DatabaseWorker()
+{
+    shutdown();
+}
+
+void DatabaseWorker::initialize()
+{
+    m_dbManager = std::make_unique<DatabaseManager>();
+    ConnectionPool::getInstance().registerThread(this);
+
+    // Rozgrzewka - otwiera połączenie w wątku workera, dopóki pula nie osiągnie min_size
+    if (ConnectionPool::getInstance().metrics().total < DatabaseManager::PoolConfig::instance.minSize) {
+        PooledConnection connection = ConnectionPool::getInstance().acquire();
+        if (!connection.isValid()) {
+            qWarning() << "Database worker" << m_index << "failed to open connection";
+        }
+    }
+}
+
+DatabaseManager* DatabaseWorker::attach(const PooledConnection& connection)
+{
+    if (!m_dbManager || !connection.isValid()) {
+        qWarning() << "Database worker" << m_index << "has no connection available";
+        return nullptr;
+    }
+
+    m_dbManager->attachConnection(connection.database());
+    return m_dbManager.get();
+}
+
+void DatabaseWorker::detach()
+{
+    if (m_dbManager) {
+        m_dbManager->detachConnection();
+    }
+}
+
+void DatabaseWorker::shutdown()
+{
+    m_dbManager.reset();
+    // Połączenia workera zamykamy w jego własnym wątku
+    ConnectionPool::getInstance().closeThreadConnections();
+}
+
+DatabaseWorkerPool& DatabaseWorkerPool::getInstance()
+{
+    static DatabaseWorkerPool instance;
+    return instance;
+}
+
+bool DatabaseWorkerPool::start(int workerCount)
+{
+    if (isRunning()) {
+        return true;
+    }
+
+    for (int i = 0; i < qMax(1, workerCount); ++i) {
+        QThread* thread = new QThread();
+        thread->setObjectName(QString("DbWorker_%1").arg(i));
+
+        DatabaseWorker* worker = new DatabaseWorker(i);
+        worker->moveToThread(thread);
+        QObject::connect(thread, &QThread::started, worker, &DatabaseWorker::initialize);
+
+        m_threads.append(thread);
+        m_workers.append(worker);
+        thread->start();
+    }
+
+    qInfo() << "Database worker pool started with" << m_workers.size() << "threads";
+    return true;
+}
+
+void DatabaseWorkerPool::stop()
+{
+    for (int i = 0; i < m_workers.size(); ++i) {
+        DatabaseWorker* worker = m_workers[i];
+        QThread* thread = m_threads[i];
+
+        QMetaObject::invokeMethod(worker, &DatabaseWorker::shutdown, Qt::BlockingQueuedConnection);
+        thread->quit();
+        thread->wait();
+
+        delete worker;
+        delete thread;
+    }
+
+    m_workers.clear();
+    m_threads.clear();
+
+    // Wątki workerów już nie istnieją - zamykamy to, co mogło jeszcze zostać
+    // (np. połączenie zwrócone po shutdown)
+    ConnectionPool::getInstance().clear();
+}
+
+DatabaseWorker* DatabaseWorkerPool::workerFor(quintptr affinityKey) const
+{
+    if (m_workers.isEmpty()) {
+        return nullptr;
+    }
+
+    // Mieszamy klucz (zwykle adres sesji), żeby wyrównane adresy
+    // nie trafiały ciągle do tych samych workerów
+    quint64 hash = static_cast<quint64>(affinityKey);
+    hash ^= hash >> 33;
+    hash *= Q_UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    return m_workers[static_cast<int>(hash % static_cast<quint64>(m_workers.size()))];
+}
@@ -0,0 +1,112 @@
+/**
+ * @file DatabaseWorkerPool.h
+ * @brief Pool of database threads executing queries off the network threads
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef DATABASEWORKERPOOL_H
+#define DATABASEWORKERPOOL_H
+
+#include <QObject>
+#include <QVector>
+#include <QFuture>
+#include <QPromise>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include "ConnectionPool.h"
+
+class QThread;
+class DatabaseManager;
+
+// Wątek bazy danych; połączenie wypożycza z ConnectionPool na czas zadania
+class DatabaseWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DatabaseWorker(int index, QObject *parent = nullptr);
+    ~DatabaseWorker();
+
+    // Zwraca manager podpięty do wypożyczonego połączenia; wywoływać tylko w wątku workera
+    DatabaseManager* attach(const PooledConnection& connection);
+    void detach();
+
+public slots:
+    void initialize();
+    void shutdown();
+
+private:
+    int m_index;
+    std::unique_ptr<DatabaseManager> m_dbManager;
+};
+
+// Zadania trafiają do workera wybranego na podstawie klucza powinowactwa,
+// dzięki czemu zapytania jednej sesji wykonują się w kolejności zgłoszenia.
+// Wynik jest dostępny jako QFuture - QFuture::then(context, ...) dostarcza go
+// do wątku sesji i jest anulowany, jeśli sesja zostanie wcześniej usunięta.
+// Zadanie, które nie mogło się wykonać (brak workera lub połączenia z bazą),
+// kończy przyszłość jawnym anulowaniem - obsługa w onCanceled.
+class DatabaseWorkerPool
+{
+public:
+    static DatabaseWorkerPool& getInstance();
+
+    bool start(int workerCount);
+    void stop();
+    bool isRunning() const { return !m_workers.isEmpty(); }
+    int workerCount() const { return m_workers.size(); }
+
+    template<typename R>
+    QFuture<R> submit(quintptr affinityKey, std::function<R(DatabaseManager&)> job);
+
+private:
+    DatabaseWorkerPool() = default;
+    DatabaseWorkerPool(const DatabaseWorkerPool&) = delete;
+    DatabaseWorkerPool& operator=(const DatabaseWorkerPool&) = delete;
+
+    DatabaseWorker* workerFor(quintptr affinityKey) const;
+
+    QVector<QThread*> m_threads;
+    QVector<DatabaseWorker*> m_workers;
+};
+
+template<typename R>
+QFuture<R> DatabaseWorkerPool::submit(quintptr affinityKey, std::function<R(DatabaseManager&)> job)
+{
+    auto promise = std::make_shared<QPromise<R>>();
+    QFuture<R> future = promise->future();
+    promise->start();
+
+    auto fail = [](QPromise<R>& failed) {
+        failed.future().cancel();
+        failed.finish();
+    };
+
+    DatabaseWorker* worker = workerFor(affinityKey);
+    if (!worker) {
+        fail(*promise);
+        return future;
+    }
+
+    QMetaObject::invokeMethod(worker, [worker, promise, job, fail]() {
+        PooledConnection connection = ConnectionPool::getInstance().acquire();
+        DatabaseManager* manager = worker->attach(connection);
+        if (!manager) {
+            fail(*promise);
+            return;
+        }
+
+        if constexpr (std::is_void_v<R>) {
+            job(*manager);
+        } else {
+            promise->addResult(job(*manager));
+        }
+        worker->detach();
+        promise->finish();
+    }, Qt::QueuedConnection);
+
+    return future;
+}
+
+#endif // DATABASEWORKERPOOL_H
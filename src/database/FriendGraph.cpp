@@ -0,0 +1,265 @@
+/**
+ * @file FriendGraph.cpp
+ * @brief In-memory adjacency of the friendships table
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "FriendGraph.h"
+#include "DatabaseManager.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+bool sortedContains(const QVector<quint32>& values, quint32 value)
+{
+    return std::binary_search(values.cbegin(), values.cend(), value);
+}
+
+bool sortedInsert(QVector<quint32>& values, quint32 value)
+{
+    auto it = std::lower_bound(values.begin(), values.end(), value);
+    if (it != values.end() && *it == value) {
+        return false;
+    }
+    values.insert(it, value);
+    return true;
+}
+
+bool sortedRemove(QVector<quint32>& values, quint32 value)
+{
+    auto it = std::lower_bound(values.begin(), values.end(), value);
+    if (it == values.end() || *it != value) {
+        return false;
+    }
+    values.erase(it);
+    return true;
+}
+
+}
+
+FriendGraph& FriendGraph::getInstance()
+{
+    static FriendGraph instance;
+    return instance;
+}
+
+bool FriendGraph::load(DatabaseManager& db)
+{
+    QVector<Edge> edges;
+    QHash<quint32, QString> usernames;
+    if (!db.getAllFriendships(edges, usernames)) {
+        return false;
+    }
+
+    build(edges, usernames);
+    qInfo() << "Loaded" << edges.size() << "friendships into memory";
+    return true;
+}
+
+void FriendGraph::build(const QVector<Edge>& edges, const QHash<quint32, QString>& usernames)
+{
+    QVector<Edge> sorted = edges;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    QVector<quint32> users;
+    QVector<int> offsets;
+    QVector<quint32> friends;
+    friends.reserve(sorted.size());
+
+    for (const Edge& edge : sorted) {
+        if (users.isEmpty() || users.last() != edge.first) {
+            users.append(edge.first);
+            offsets.append(friends.size());
+        }
+        friends.append(edge.second);
+    }
+    offsets.append(friends.size());
+
+    QWriteLocker locker(&m_lock);
+    m_users = std::move(users);
+    m_offsets = std::move(offsets);
+    m_friends = std::move(friends);
+    m_added.clear();
+    m_removed.clear();
+    m_pending = 0;
+    m_usernames = usernames;
+    m_loaded = true;
+}
+
+bool FriendGraph::isLoaded() const
+{
+    QReadLocker locker(&m_lock);
+    return m_loaded;
+}
+
+QVector<quint32> FriendGraph::friendsOf(quint32 userId) const
+{
+    QReadLocker locker(&m_lock);
+    return mergedRow(userId);
+}
+
+bool FriendGraph::areFriends(quint32 userId, quint32 friendId) const
+{
+    QReadLocker locker(&m_lock);
+    if (sortedContains(m_added.value(userId), friendId)) {
+        return true;
+    }
+    return inBase(userId, friendId) && !sortedContains(m_removed.value(userId), friendId);
+}
+
+QString FriendGraph::username(quint32 userId) const
+{
+    QReadLocker locker(&m_lock);
+    return m_usernames.value(userId);
+}
+
+void FriendGraph::addFriend(quint32 userId, quint32 friendId, const QString& friendUsername)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_loaded) {
+        return;
+    }
+
+    if (!friendUsername.isEmpty()) {
+        m_usernames.insert(friendId, friendUsername);
+    }
+
+    auto removed = m_removed.find(userId);
+    if (removed != m_removed.end() && sortedRemove(*removed, friendId)) {
+        if (removed->isEmpty()) {
+            m_removed.erase(removed);
+        }
+        --m_pending;
+        return;
+    }
+
+    if (!inBase(userId, friendId) && sortedInsert(m_added[userId], friendId)) {
+        ++m_pending;
+    }
+
+    if (m_pending > COMPACT_THRESHOLD) {
+        compact();
+    }
+}
+
+void FriendGraph::removeFriend(quint32 userId, quint32 friendId)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_loaded) {
+        return;
+    }
+
+    auto added = m_added.find(userId);
+    if (added != m_added.end() && sortedRemove(*added, friendId)) {
+        if (added->isEmpty()) {
+            m_added.erase(added);
+        }
+        --m_pending;
+        return;
+    }
+
+    if (inBase(userId, friendId) && sortedInsert(m_removed[userId], friendId)) {
+        ++m_pending;
+    }
+
+    if (m_pending > COMPACT_THRESHOLD) {
+        compact();
+    }
+}
+
+int FriendGraph::edgeCount() const
+{
+    QReadLocker locker(&m_lock);
+    int count = m_friends.size();
+    for (const auto& row : m_added) {
+        count += row.size();
+    }
+    for (const auto& row : m_removed) {
+        count -= row.size();
+    }
+    return count;
+}
+
+int FriendGraph::pendingChanges() const
+{
+    QReadLocker locker(&m_lock);
+    return m_pending;
+}
+
+QVector<quint32> FriendGraph::baseRow(quint32 userId) const
+{
+    auto it = std::lower_bound(m_users.cbegin(), m_users.cend(), userId);
+    if (it == m_users.cend() || *it != userId) {
+        return {};
+    }
+    int row = static_cast<int>(it - m_users.cbegin());
+    return m_friends.mid(m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+}
+
+QVector<quint32> FriendGraph::mergedRow(quint32 userId) const
+{
+    QVector<quint32> row = baseRow(userId);
+
+    auto removed = m_removed.constFind(userId);
+    if (removed != m_removed.constEnd()) {
+        row.erase(std::remove_if(row.begin(), row.end(), [&removed](quint32 friendId) {
+                      return sortedContains(*removed, friendId);
+                  }), row.end());
+    }
+
+    auto added = m_added.constFind(userId);
+    if (added != m_added.constEnd()) {
+        QVector<quint32> merged;
+        merged.reserve(row.size() + added->size());
+        std::merge(row.cbegin(), row.cend(), added->cbegin(), added->cend(), std::back_inserter(merged));
+        return merged;
+    }
+    return row;
+}
+
+bool FriendGraph::inBase(quint32 userId, quint32 friendId) const
+{
+    auto it = std::lower_bound(m_users.cbegin(), m_users.cend(), userId);
+    if (it == m_users.cend() || *it != userId) {
+        return false;
+    }
+    int row = static_cast<int>(it - m_users.cbegin());
+    return std::binary_search(m_friends.cbegin() + m_offsets[row],
+                              m_friends.cbegin() + m_offsets[row + 1], friendId);
+}
+
+void FriendGraph::compact()
+{
+    QVector<quint32> users = m_users;
+    for (auto it = m_added.constBegin(); it != m_added.constEnd(); ++it) {
+        users.append(it.key());
+    }
+    std::sort(users.begin(), users.end());
+    users.erase(std::unique(users.begin(), users.end()), users.end());
+
+    QVector<quint32> compactUsers;
+    QVector<int> offsets;
+    QVector<quint32> friends;
+    friends.reserve(m_friends.size() + m_pending);
+
+    for (quint32 userId : users) {
+        QVector<quint32> row = mergedRow(userId);
+        if (row.isEmpty()) {
+            continue;
+        }
+        compactUsers.append(userId);
+        offsets.append(friends.size());
+        friends.append(row);
+    }
+    offsets.append(friends.size());
+
+    m_users = std::move(compactUsers);
+    m_offsets = std::move(offsets);
+    m_friends = std::move(friends);
+    m_added.clear();
+    m_removed.clear();
+    m_pending = 0;
+}
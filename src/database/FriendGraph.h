@@ -0,0 +1,76 @@
+/**
+ * @file FriendGraph.h
+ * @brief In-memory adjacency of the friendships table
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef FRIENDGRAPH_H
+#define FRIENDGRAPH_H
+
+#include <QHash>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+class DatabaseManager;
+
+// Kopia tabeli friendships w postaci CSR: posortowane id użytkowników,
+// przesunięcia wierszy i jedna ciągła tablica posortowanych id znajomych.
+// Zmiany po wczytaniu trafiają do małej nakładki (dodane/usunięte krawędzie)
+// scalanej z bazą przy odczycie; po przekroczeniu COMPACT_THRESHOLD nakładka
+// jest wbudowywana w nową tablicę CSR.
+class FriendGraph
+{
+public:
+    using Edge = QPair<quint32, quint32>;  // (user_id, friend_id)
+
+    static constexpr int COMPACT_THRESHOLD = 1024;
+
+    static FriendGraph& getInstance();
+
+    FriendGraph() = default;
+
+    // Do pierwszego wczytania odczyty znajomych idą do bazy
+    bool load(DatabaseManager& db);
+    void build(const QVector<Edge>& edges, const QHash<quint32, QString>& usernames);
+    bool isLoaded() const;
+
+    // Posortowane rosnąco id znajomych
+    QVector<quint32> friendsOf(quint32 userId) const;
+    bool areFriends(quint32 userId, quint32 friendId) const;
+    QString username(quint32 userId) const;
+
+    // Zmiany po zatwierdzeniu transakcji; bez wczytanego grafu są ignorowane
+    void addFriend(quint32 userId, quint32 friendId, const QString& friendUsername);
+    void removeFriend(quint32 userId, quint32 friendId);
+
+    int edgeCount() const;
+    int pendingChanges() const;
+
+private:
+    FriendGraph(const FriendGraph&) = delete;
+    FriendGraph& operator=(const FriendGraph&) = delete;
+
+    QVector<quint32> baseRow(quint32 userId) const;
+    QVector<quint32> mergedRow(quint32 userId) const;
+    bool inBase(quint32 userId, quint32 friendId) const;
+    void compact();
+
+    mutable QReadWriteLock m_lock;
+    bool m_loaded = false;
+
+    QVector<quint32> m_users;      // posortowane id właścicieli wierszy
+    QVector<int> m_offsets;        // m_offsets[i]..m_offsets[i + 1] w m_friends
+    QVector<quint32> m_friends;
+
+    // Nakładka; wektory posortowane rosnąco
+    QHash<quint32, QVector<quint32>> m_added;
+    QHash<quint32, QVector<quint32>> m_removed;
+    int m_pending = 0;
+
+    QHash<quint32, QString> m_usernames;
+};
+
+#endif // FRIENDGRAPH_H
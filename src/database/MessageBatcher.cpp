@@ -0,0 +1,226 @@
+/**
+ * @file MessageBatcher.cpp
+ * @brief Group commit of chat messages in shared transactions
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "MessageBatcher.h"
+#include "DatabaseWorkerPool.h"
+#include <QDebug>
+
+MessageBatcher& MessageBatcher::getInstance()
+{
+    static MessageBatcher instance;
+    return instance;
+}
+
+MessageBatcher::MessageBatcher()
+{
+    m_clock.start();
+    m_linger.setSingleShot(true);
+    connect(&m_linger, &QTimer::timeout, this, &MessageBatcher::flush);
+}
+
+void MessageBatcher::start()
+{
+    m_running.storeRelease(true);
+}
+
+void MessageBatcher::stop()
+{
+    if (!m_running.fetchAndStoreAcquire(false)) {
+        return;
+    }
+    m_linger.stop();
+
+    // Nowe wiadomości nie są już przyjmowane - dopisujemy to, co czeka
+    forever {
+        QFuture<bool> inFlight;
+        {
+            QMutexLocker locker(&m_mutex);
+            inFlight = m_lastFlush;
+        }
+        inFlight.waitForFinished();
+
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_pending.isEmpty()) {
+                break;
+            }
+        }
+        flush();
+    }
+}
+
+QFuture<qint64> MessageBatcher::enqueue(quint32 senderId, quint32 receiverId, const QString& message,
+                                        quint64 globalId)
+{
+    auto promise = std::make_shared<QPromise<qint64>>();
+    QFuture<qint64> future = promise->future();
+    promise->start();
+
+    if (!isRunning()) {
+        promise->addResult(0);
+        promise->finish();
+        return future;
+    }
+
+    bool first = false;
+    bool full = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        first = m_pending.isEmpty();
+        if (first) {
+            m_oldestEnqueued = m_clock.elapsed();
+        }
+        m_pending.append({{senderId, receiverId, message, QDateTime(), globalId}, promise});
+        full = m_pending.size() >= DatabaseManager::GroupCommitConfig::instance.maxBatchSize;
+    }
+
+    // Timer należy do wątku obiektu, sesje działają w innych
+    if (full) {
+        QMetaObject::invokeMethod(this, &MessageBatcher::flush, Qt::QueuedConnection);
+    } else if (first) {
+        QMetaObject::invokeMethod(this, &MessageBatcher::armLinger, Qt::QueuedConnection);
+    }
+    return future;
+}
+
+void MessageBatcher::armLinger()
+{
+    if (!m_linger.isActive()) {
+        m_linger.start(DatabaseManager::GroupCommitConfig::instance.lingerMs);
+    }
+}
+
+void MessageBatcher::flush()
+{
+    m_linger.stop();
+
+    auto batch = std::make_shared<QVector<Pending>>();
+    qint64 oldest = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_inFlight || m_pending.isEmpty()) {
+            return;  // zapis w toku - batchFinished wywoła flush ponownie
+        }
+        int size = qMin<int>(m_pending.size(), DatabaseManager::GroupCommitConfig::instance.maxBatchSize);
+        *batch = m_pending.mid(0, size);
+        m_pending.remove(0, size);
+        oldest = m_oldestEnqueued;
+        m_oldestEnqueued = m_clock.elapsed();
+        m_inFlight = true;
+    }
+
+    auto fail = [this, batch]() {
+        for (const Pending& pending : *batch) {
+            pending.promise->addResult(0);
+            pending.promise->finish();
+        }
+        batchFinished(batch->size(), batch->size(), false, 0);
+    };
+
+    DatabaseWorkerPool& pool = DatabaseWorkerPool::getInstance();
+    if (!pool.isRunning()) {
+        fail();
+        return;
+    }
+
+    // Jedna partia naraz, więc klucz nie ma znaczenia dla kolejności
+    QFuture<bool> future = pool.submit<bool>(reinterpret_cast<quintptr>(this),
+                                             [this, batch, oldest](DatabaseManager& db) {
+        QVector<OutgoingMessage> messages;
+        messages.reserve(batch->size());
+        for (const Pending& pending : *batch) {
+            messages.append(pending.message);
+        }
+
+        bool stored = db.storeMessages(messages);
+        bool split = !stored && messages.size() > 1;
+        int failed = 0;
+        if (split) {
+            // Jedna błędna wiadomość nie może odrzucić wiadomości innych
+            // nadawców - partię powtarzamy po jednej wiadomości
+            for (OutgoingMessage& message : messages) {
+                QVector<OutgoingMessage> single{message};
+                message.id = db.storeMessages(single) ? single.first().id : 0;
+                failed += message.id ? 0 : 1;
+            }
+        } else if (!stored) {
+            messages.first().id = 0;
+            failed = 1;
+        }
+
+        for (int i = 0; i < batch->size(); ++i) {
+            (*batch)[i].promise->addResult(messages[i].id);
+            (*batch)[i].promise->finish();
+        }
+        batchFinished(batch->size(), failed, split, m_clock.elapsed() - oldest);
+        return failed == 0;
+    });
+    // Brak połączenia z bazą anuluje zadanie przed jego wykonaniem; bez kontekstu,
+    // bo stop() czeka na tę przyszłość w wątku obiektu
+    future = future.onCanceled([fail]() {
+        fail();
+        return false;
+    });
+
+    QMutexLocker locker(&m_mutex);
+    m_lastFlush = future;
+}
+
+void MessageBatcher::batchFinished(int size, int failed, bool split, qint64 latencyMs)
+{
+    bool more = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_inFlight = false;
+
+        if (split) {
+            ++m_stats.splitBatches;
+        }
+        if (failed < size) {
+            ++m_stats.batches;
+            m_stats.messages += size - failed;
+            m_stats.maxBatchSize = qMax(m_stats.maxBatchSize, size);
+            m_stats.totalFlushLatencyMs += latencyMs;
+            m_stats.maxFlushLatencyMs = qMax(m_stats.maxFlushLatencyMs, latencyMs);
+            if (latencyMs >= DatabaseManager::GroupCommitConfig::instance.slowFlushMs) {
+                ++m_stats.slowFlushes;
+            }
+        }
+        if (failed > 0) {
+            ++m_stats.failedBatches;
+        }
+        more = !m_pending.isEmpty();
+    }
+
+    // Wiadomości z czasu zapisu czekały już dłużej niż linger
+    if (more) {
+        QMetaObject::invokeMethod(this, &MessageBatcher::flush, Qt::QueuedConnection);
+    }
+}
+
+MessageBatcher::Snapshot MessageBatcher::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    Snapshot result = m_stats;
+    result.pending = m_pending.size();
+    return result;
+}
+
+void MessageBatcher::log() const
+{
+    Snapshot current = snapshot();
+    qInfo() << "Group commit: batches" << current.batches
+            << "messages" << current.messages
+            << "avg batch" << (current.batches ? double(current.messages) / current.batches : 0.0)
+            << "max batch" << current.maxBatchSize
+            << "avg flush ms" << (current.batches ? double(current.totalFlushLatencyMs) / current.batches : 0.0)
+            << "max flush ms" << current.maxFlushLatencyMs
+            << "slow flushes" << current.slowFlushes
+            << "split" << current.splitBatches
+            << "failed" << current.failedBatches
+            << "pending" << current.pending;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file MessageBatcher.h
+ * @brief Group commit of chat messages in shared transactions
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef MESSAGEBATCHER_H
+#define MESSAGEBATCHER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QPromise>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QVector>
+#include <memory>
+#include "DatabaseManager.h"
+
+// Wiadomości wysyłane w krótkim odstępie trafiają do jednej transakcji
+// (DatabaseManager::storeMessages). Partia jest zapisywana, gdy osiągnie
+// max_batch_size albo gdy pierwsza wiadomość odczeka linger_ms. W danej
+// chwili zapisywana jest co najwyżej jedna partia - wiadomości, które
+// przyjdą w trakcie, czekają na następną, więc pod obciążeniem partie
+// same rosną, a kolejność wiadomości nadawcy jest zachowana.
+// Przyszłość zwrócona przez enqueue kończy się dopiero po zatwierdzeniu
+// partii; obiekt musi zostać utworzony w wątku z pętlą zdarzeń.
+class MessageBatcher : public QObject
+{
+    Q_OBJECT
+public:
+    struct Snapshot {
+        quint64 batches = 0;
+        quint64 messages = 0;
+        quint64 failedBatches = 0;
+        quint64 splitBatches = 0;  // odrzucone w całości i zapisane po jednej wiadomości
+        quint64 slowFlushes = 0;
+        int maxBatchSize = 0;
+        qint64 totalFlushLatencyMs = 0;  // od pierwszej wiadomości partii do zatwierdzenia
+        qint64 maxFlushLatencyMs = 0;
+        int pending = 0;
+    };
+
+    static MessageBatcher& getInstance();
+
+    // Przyjmuje wiadomości dopiero po start(); bez tego sesje zapisują je same
+    void start();
+    // Zapisuje zaległe wiadomości i czeka na zakończenie; pula musi jeszcze działać
+    void stop();
+    bool isRunning() const { return m_running.loadAcquire(); }
+
+    // Wynik: id zapisanej wiadomości albo 0 przy błędzie
+    QFuture<qint64> enqueue(quint32 senderId, quint32 receiverId, const QString& message,
+                            quint64 globalId = 0);
+
+    Snapshot snapshot() const;
+    void log() const;
+
+private slots:
+    void flush();
+
+private:
+    struct Pending {
+        OutgoingMessage message;
+        std::shared_ptr<QPromise<qint64>> promise;
+    };
+
+    MessageBatcher();
+    MessageBatcher(const MessageBatcher&) = delete;
+    MessageBatcher& operator=(const MessageBatcher&) = delete;
+
+    void armLinger();
+    void batchFinished(int size, int failed, bool split, qint64 latencyMs);
+
+    QAtomicInteger<bool> m_running = false;
+    QTimer m_linger;
+    QElapsedTimer m_clock;
+
+    mutable QMutex m_mutex;
+    QVector<Pending> m_pending;
+    qint64 m_oldestEnqueued = 0;  // m_clock dla pierwszej oczekującej wiadomości
+    bool m_inFlight = false;
+    QFuture<bool> m_lastFlush;
+    Snapshot m_stats;
+};
+
+#endif // MESSAGEBATCHER_H
@@ -0,0 +1,514 @@
+/**
+ * @file MessageJournal.cpp
+ * @brief Local append-only journal of accepted chat messages
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "MessageJournal.h"
+#include "DatabaseWorkerPool.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QtEndian>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <array>
+#include <utility>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int HEADER_SIZE = 8;
+constexpr quint32 MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+const std::array<quint32, 256>& crcTable()
+{
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> result{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            result[i] = c;
+        }
+        return result;
+    }();
+    return table;
+}
+
+bool decode(const QByteArray& payload, MessageJournal::Record& record)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    qint64 sentAt = 0;
+    stream >> record.sequence >> record.message.senderId >> record.message.receiverId
+           >> sentAt >> record.message.globalId >> record.message.message;
+    record.message.sentAt = QDateTime::fromMSecsSinceEpoch(sentAt);
+    return stream.status() == QDataStream::Ok;
+}
+
+}
+
+MessageJournal& MessageJournal::getInstance()
+{
+    static MessageJournal instance;
+    return instance;
+}
+
+bool MessageJournal::open(DatabaseManager& db)
+{
+    const DatabaseManager::JournalConfig& config = DatabaseManager::JournalConfig::instance;
+    m_directory = config.directory;
+    m_name = config.name;
+
+    if (!QDir().mkpath(m_directory)) {
+        qCritical() << "Cannot create message journal directory" << m_directory;
+        return false;
+    }
+
+    quint64 applied = 0;
+    if (!db.getJournalCheckpoint(m_name, applied)) {
+        return false;
+    }
+
+    QDir directory(m_directory);
+    const QStringList files = directory.entryList({"segment-*.log"}, QDir::Files, QDir::Name);
+
+    QVector<Record> unapplied;
+    quint64 last = applied;
+    for (const QString& file : files) {
+        QString path = directory.filePath(file);
+        qint64 validBytes = 0;
+        const QVector<Record> records = readSegment(path, validBytes);
+        if (validBytes < QFileInfo(path).size()) {
+            // Przerwany zapis - rekord bez fsync nie był potwierdzony klientowi
+            qWarning() << "Message journal segment" << path << "has a damaged tail, truncating at" << validBytes;
+            QFile::resize(path, validBytes);
+        }
+
+        for (const Record& record : records) {
+            last = qMax(last, record.sequence);
+            if (record.sequence > applied) {
+                unapplied.append(record);
+            }
+        }
+    }
+
+    if (!replay(db, unapplied, applied)) {
+        return false;
+    }
+
+    for (const QString& file : files) {
+        QFile::remove(directory.filePath(file));
+    }
+
+    // Numeracja ciągnie się dalej, nawet gdy wszystkie segmenty zostały usunięte
+    m_nextSequence = last + 1;
+    m_stats.applied = last;
+    return openSegment(m_nextSequence);
+}
+
+bool MessageJournal::replay(DatabaseManager& db, const QVector<Record>& records, quint64 applied)
+{
+    if (records.isEmpty()) {
+        return true;
+    }
+
+    qInfo() << "Replaying" << records.size() << "message journal records after" << applied;
+
+    const int batchSize = DatabaseManager::JournalConfig::instance.drainBatchSize;
+    for (int start = 0; start < records.size(); start += batchSize) {
+        QVector<Record> batch = records.mid(start, batchSize);
+        StoreResult result = storeRecords(db, m_name, quarantinePath(), batch);
+        m_stats.quarantined += result.quarantined;
+        if (result.processed < batch.size()) {
+            qCritical() << "Failed to replay message journal at record"
+                        << batch[result.processed].sequence;
+            return false;
+        }
+    }
+    return true;
+}
+
+MessageJournal::StoreResult MessageJournal::storeRecords(DatabaseManager& db, const QString& journal,
+                                                         const QString& quarantinePath,
+                                                         const QVector<Record>& records)
+{
+    StoreResult result;
+    if (records.isEmpty()) {
+        return result;
+    }
+
+    QVector<OutgoingMessage> messages;
+    messages.reserve(records.size());
+    for (const Record& record : records) {
+        messages.append(record.message);
+    }
+    if (db.storeMessages(messages, journal, records.last().sequence)) {
+        result.processed = records.size();
+        return result;
+    }
+
+    // Partia odrzucona w całości - szukamy rekordu, który ją blokuje
+    for (const Record& record : records) {
+        QVector<OutgoingMessage> single{record.message};
+        if (db.storeMessages(single, journal, record.sequence)) {
+            ++result.processed;
+            continue;
+        }
+
+        // Przy niedostępnej bazie rekord zostaje w dzienniku do ponowienia;
+        // do kwarantanny trafia tylko odrzucony przez działające połączenie
+        if (!db.isConnectionAlive()) {
+            break;
+        }
+        if (db.storeMessages(single, journal, record.sequence)) {
+            ++result.processed;
+            continue;
+        }
+
+        // Wpis w kwarantannie obowiązuje tylko razem z przesunięciem punktu
+        // kontrolnego - inaczej ponowienie dopisałoby ten sam rekord drugi raz
+        qint64 quarantineSize = QFileInfo(quarantinePath).size();
+        if (!quarantine(quarantinePath, record)) {
+            break;
+        }
+        if (!db.setJournalCheckpoint(journal, record.sequence)) {
+            QFile::resize(quarantinePath, quarantineSize);
+            break;
+        }
+        qCritical() << "Message journal record" << record.sequence << "from user"
+                    << record.message.senderId << "rejected by the database, moved to" << quarantinePath;
+        ++result.processed;
+        ++result.quarantined;
+    }
+    return result;
+}
+
+bool MessageJournal::quarantine(const QString& path, const Record& record)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCritical() << "Cannot open message journal quarantine" << path << file.errorString();
+        return false;
+    }
+
+    QByteArray data = encode(record);
+    return file.write(data) == data.size() && file.flush();
+}
+
+void MessageJournal::start()
+{
+    if (isRunning()) {
+        return;
+    }
+
+    m_retryTimer = new QTimer(this);
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, &QTimer::timeout, this, &MessageJournal::drain);
+
+    m_thread = new QThread();
+    m_thread->setObjectName("MessageJournal");
+    moveToThread(m_thread);
+    m_thread->start();
+
+    QMutexLocker locker(&m_mutex);
+    m_running.storeRelease(true);
+}
+
+void MessageJournal::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_running.fetchAndStoreAcquire(false)) {
+            return;
+        }
+    }
+
+    // Po tym zapisie append już nic nie doda do kolejki
+    QMetaObject::invokeMethod(this, [this]() {
+        writePending();
+        m_retryTimer->stop();
+        m_file.close();
+        moveToThread(QCoreApplication::instance()->thread());
+    }, Qt::BlockingQueuedConnection);
+
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+QFuture<bool> MessageJournal::append(quint32 senderId, quint32 receiverId, const QString& message,
+                                     quint64 globalId)
+{
+    auto promise = std::make_shared<QPromise<bool>>();
+    QFuture<bool> future = promise->future();
+    promise->start();
+
+    bool schedule = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (isRunning()) {
+            m_pending.append({{senderId, receiverId, message, QDateTime::currentDateTime(), globalId}, promise});
+            schedule = !std::exchange(m_writeScheduled, true);
+        } else {
+            promise->addResult(false);
+            promise->finish();
+            return future;
+        }
+    }
+
+    if (schedule) {
+        QMetaObject::invokeMethod(this, &MessageJournal::writePending, Qt::QueuedConnection);
+    }
+    return future;
+}
+
+void MessageJournal::writePending()
+{
+    QVector<Pending> batch;
+    {
+        QMutexLocker locker(&m_mutex);
+        batch.swap(m_pending);
+        m_writeScheduled = false;
+    }
+    if (batch.isEmpty()) {
+        return;
+    }
+
+    QByteArray buffer;
+    QVector<Record> records;
+    records.reserve(batch.size());
+    for (const Pending& pending : batch) {
+        Record record{m_nextSequence++, pending.message};
+        buffer += encode(record);
+        records.append(record);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 segmentSize = m_file.size();
+    bool written = m_file.write(buffer) == buffer.size() && sync();
+    qint64 syncMs = timer.elapsed();
+
+    for (const Pending& pending : batch) {
+        pending.promise->addResult(written);
+        pending.promise->finish();
+    }
+
+    if (!written) {
+        // Klient dostał błąd, więc rekordy z tej partii nie mogą zostać odtworzone -
+        // także te zapisane w całości przed nieudanym fsync. Segment wraca do
+        // rozmiaru sprzed zapisu, a kolejne rekordy idą do nowego segmentu.
+        qCritical() << "Failed to write message journal:" << m_file.errorString();
+        if (!m_file.resize(segmentSize)) {
+            qCritical() << "Failed to truncate message journal segment" << m_file.fileName()
+                        << m_file.errorString();
+        }
+        openSegment(m_nextSequence);
+        return;
+    }
+
+    m_segments.last().lastSequence = records.last().sequence;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stats.appended += records.size();
+        ++m_stats.syncs;
+        m_stats.totalSyncMs += syncMs;
+        m_stats.maxSyncMs = qMax(m_stats.maxSyncMs, syncMs);
+        m_stats.backlog = m_undrained.size() + records.size();
+    }
+
+    m_undrained += records;
+    if (m_file.size() >= DatabaseManager::JournalConfig::instance.segmentSize) {
+        openSegment(m_nextSequence);
+    }
+    drain();
+}
+
+void MessageJournal::drain()
+{
+    if (m_draining || m_undrained.isEmpty()) {
+        return;
+    }
+
+    DatabaseWorkerPool& pool = DatabaseWorkerPool::getInstance();
+    if (!pool.isRunning()) {
+        return;  // rekordy zostają w dzienniku do następnego startu
+    }
+
+    int count = qMin<int>(m_undrained.size(), DatabaseManager::JournalConfig::instance.drainBatchSize);
+    QVector<Record> records = m_undrained.mid(0, count);
+    m_draining = true;
+
+    QString name = m_name;
+    QString quarantine = quarantinePath();
+    pool.submit<StoreResult>(reinterpret_cast<quintptr>(this), [records, name, quarantine](DatabaseManager& db) {
+        return storeRecords(db, name, quarantine, records);
+    }).then(this, [this, count](StoreResult result) {
+        drainFinished(count, result);
+    }).onCanceled(this, [this, count]() {
+        drainFinished(count, StoreResult());
+    });
+}
+
+void MessageJournal::drainFinished(int count, const StoreResult& result)
+{
+    m_draining = false;
+
+    if (result.processed > 0) {
+        quint64 lastSequence = m_undrained[result.processed - 1].sequence;
+        m_undrained.remove(0, result.processed);
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stats.applied = lastSequence;
+            m_stats.backlog = m_undrained.size();
+            m_stats.quarantined += result.quarantined;
+        }
+        dropAppliedSegments(lastSequence);
+    }
+
+    if (result.processed < count) {
+        {
+            QMutexLocker locker(&m_mutex);
+            ++m_stats.drainFailures;
+        }
+        m_retryTimer->start(DatabaseManager::JournalConfig::instance.retryInterval);
+        return;
+    }
+    drain();
+}
+
+void MessageJournal::dropAppliedSegments(quint64 applied)
+{
+    // Bieżący segment zostaje, nawet gdy jest w całości zapisany w bazie
+    while (m_segments.size() > 1 && m_segments.first().lastSequence <= applied) {
+        QFile::remove(m_segments.first().path);
+        m_segments.removeFirst();
+    }
+}
+
+bool MessageJournal::openSegment(quint64 firstSequence)
+{
+    m_file.close();
+    m_file.setFileName(segmentPath(firstSequence));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCritical() << "Cannot open message journal segment" << m_file.fileName()
+                    << m_file.errorString();
+        return false;
+    }
+
+    m_segments.append({m_file.fileName(), firstSequence, 0});
+    return true;
+}
+
+bool MessageJournal::sync()
+{
+    if (!m_file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(m_file.handle()) == 0;
+#else
+    return ::fsync(m_file.handle()) == 0;
+#endif
+}
+
+QString MessageJournal::segmentPath(quint64 firstSequence) const
+{
+    return QDir(m_directory).filePath(QString("segment-%1.log").arg(firstSequence, 20, 10, QLatin1Char('0')));
+}
+
+QString MessageJournal::quarantinePath() const
+{
+    return QDir(m_directory).filePath("quarantine.log");
+}
+
+QByteArray MessageJournal::encode(const Record& record)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << record.sequence << record.message.senderId << record.message.receiverId
+           << record.message.sentAt.toMSecsSinceEpoch() << record.message.globalId
+           << record.message.message;
+
+    QByteArray header(HEADER_SIZE, Qt::Uninitialized);
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), header.data());
+    qToBigEndian<quint32>(crc32(payload), header.data() + 4);
+    return header + payload;
+}
+
+QVector<MessageJournal::Record> MessageJournal::readSegment(const QString& path, qint64& validBytes)
+{
+    QVector<Record> records;
+    validBytes = 0;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot read message journal segment" << path << file.errorString();
+        return records;
+    }
+
+    const QByteArray data = file.readAll();
+    qint64 pos = 0;
+    while (data.size() - pos >= HEADER_SIZE) {
+        quint32 length = qFromBigEndian<quint32>(data.constData() + pos);
+        quint32 checksum = qFromBigEndian<quint32>(data.constData() + pos + 4);
+        if (length > MAX_RECORD_SIZE || data.size() - pos - HEADER_SIZE < length) {
+            break;
+        }
+
+        QByteArray payload = data.mid(pos + HEADER_SIZE, length);
+        Record record;
+        if (crc32(payload) != checksum || !decode(payload, record)) {
+            break;
+        }
+
+        records.append(record);
+        pos += HEADER_SIZE + length;
+        validBytes = pos;
+    }
+    return records;
+}
+
+quint32 MessageJournal::crc32(const QByteArray& data)
+{
+    const std::array<quint32, 256>& table = crcTable();
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data) {
+        crc = table[(crc ^ static_cast<quint8>(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+MessageJournal::Snapshot MessageJournal::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+void MessageJournal::log() const
+{
+    Snapshot current = snapshot();
+    qInfo() << "Message journal: appended" << current.appended
+            << "syncs" << current.syncs
+            << "avg records per sync" << (current.syncs ? double(current.appended) / current.syncs : 0.0)
+            << "avg sync ms" << (current.syncs ? double(current.totalSyncMs) / current.syncs : 0.0)
+            << "max sync ms" << current.maxSyncMs
+            << "applied" << current.applied
+            << "backlog" << current.backlog
+            << "drain failures" << current.drainFailures
+            << "quarantined" << current.quarantined;
+}
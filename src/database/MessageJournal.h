@@ -0,0 +1,136 @@
+/**
+ * @file MessageJournal.h
+ * @brief Local append-only journal of accepted chat messages
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef MESSAGEJOURNAL_H
+#define MESSAGEJOURNAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QFuture>
+#include <QPromise>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+#include "DatabaseManager.h"
+
+class QThread;
+
+// Wiadomość jest potwierdzana po dopisaniu do dziennika i fsync, a do MySQL
+// trafia w tle (DatabaseManager::storeMessages z punktem kontrolnym w tej
+// samej transakcji). Dziennik to katalog segmentów segment-<pierwszy numer>.log;
+// rekord: u32 długość ładunku, u32 CRC32 ładunku, ładunek (QDataStream).
+// Rekordy czekające na zapis w chwili fsync trafiają do jednego fsync.
+// Przy starcie rekordy nowsze niż punkt kontrolny są odtwarzane do bazy,
+// uszkodzony koniec segmentu (przerwany zapis) jest obcinany.
+// Partia odrzucona przez bazę jest powtarzana po jednym rekordzie; rekord,
+// którego baza nie przyjmuje mimo działającego połączenia, trafia do
+// quarantine.log (ten sam format), żeby nie blokował kolejnych.
+class MessageJournal : public QObject
+{
+    Q_OBJECT
+public:
+    struct Record {
+        quint64 sequence = 0;
+        OutgoingMessage message;
+    };
+
+    struct Snapshot {
+        quint64 appended = 0;
+        quint64 syncs = 0;
+        qint64 totalSyncMs = 0;
+        qint64 maxSyncMs = 0;
+        quint64 applied = 0;        // ostatni numer zapisany w bazie
+        int backlog = 0;            // rekordy czekające na zapis do bazy
+        quint64 drainFailures = 0;
+        quint64 quarantined = 0;
+    };
+
+    static MessageJournal& getInstance();
+
+    // Odtwarza niezapisane rekordy na przekazanym połączeniu i zakłada nowy
+    // segment; wywoływane przed startem sesji
+    bool open(DatabaseManager& db);
+    // Uruchamia wątek dziennika; odtąd append przyjmuje wiadomości
+    void start();
+    // Zapisuje oczekujące rekordy na dysk; niezapisane w bazie zostają na następny start
+    void stop();
+    bool isRunning() const { return m_running.loadAcquire(); }
+
+    // Wynik true po fsync rekordu
+    QFuture<bool> append(quint32 senderId, quint32 receiverId, const QString& message,
+                         quint64 globalId = 0);
+
+    Snapshot snapshot() const;
+    void log() const;
+
+    // Format rekordu - wspólny dla zapisu i odczytu
+    static QByteArray encode(const Record& record);
+    // Poprawne rekordy segmentu; validBytes - długość ich poprawnego początku
+    static QVector<Record> readSegment(const QString& path, qint64& validBytes);
+    static quint32 crc32(const QByteArray& data);
+
+private slots:
+    void writePending();
+    void drain();
+
+private:
+    struct Pending {
+        OutgoingMessage message;
+        std::shared_ptr<QPromise<bool>> promise;
+    };
+
+    // Wynik zapisu rekordów: processed pierwszych jest w bazie albo w kwarantannie
+    struct StoreResult {
+        int processed = 0;
+        int quarantined = 0;
+    };
+
+    struct Segment {
+        QString path;
+        quint64 firstSequence = 0;
+        quint64 lastSequence = 0;  // 0 - segment pusty
+    };
+
+    MessageJournal() = default;
+    MessageJournal(const MessageJournal&) = delete;
+    MessageJournal& operator=(const MessageJournal&) = delete;
+
+    bool replay(DatabaseManager& db, const QVector<Record>& records, quint64 applied);
+    // Wykonywane w wątku bazy - nie odwołuje się do stanu obiektu
+    static StoreResult storeRecords(DatabaseManager& db, const QString& journal,
+                                    const QString& quarantinePath, const QVector<Record>& records);
+    static bool quarantine(const QString& path, const Record& record);
+    bool openSegment(quint64 firstSequence);
+    bool sync();
+    void dropAppliedSegments(quint64 applied);
+    void drainFinished(int count, const StoreResult& result);
+    QString segmentPath(quint64 firstSequence) const;
+    QString quarantinePath() const;
+
+    QAtomicInteger<bool> m_running = false;
+    QThread* m_thread = nullptr;
+    QString m_directory;
+    QString m_name;
+
+    // Kolejka append - jedyny stan współdzielony z wątkami sesji
+    mutable QMutex m_mutex;
+    QVector<Pending> m_pending;
+    bool m_writeScheduled = false;
+
+    // Poniżej tylko wątek dziennika (przed start() - wątek wywołujący open)
+    QFile m_file;
+    QVector<Segment> m_segments;  // ostatni jest bieżącym
+    quint64 m_nextSequence = 1;
+    QVector<Record> m_undrained;
+    bool m_draining = false;
+    QTimer* m_retryTimer = nullptr;
+
+    Snapshot m_stats;  // chroniony m_mutex
+};
+
+#endif // MESSAGEJOURNAL_H
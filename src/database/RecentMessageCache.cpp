@@ -0,0 +1,204 @@
+/**
+ * @file RecentMessageCache.cpp
+ * @brief Newest messages of active conversations kept in memory
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "RecentMessageCache.h"
+#include "ConversationHeads.h"
+#include <QDebug>
+
+RecentMessageCache& RecentMessageCache::getInstance()
+{
+    const DatabaseManager::RecentMessagesConfig& config = DatabaseManager::RecentMessagesConfig::instance;
+    static RecentMessageCache instance(config.perConversation, config.budgetBytes);
+    return instance;
+}
+
+RecentMessageCache::RecentMessageCache(int perConversation, qint64 budgetBytes)
+    : m_capacity(qMax(0, perConversation))
+    , m_budget(qMax<qint64>(0, budgetBytes))
+{
+    m_cache.setMaxCost(m_budget);
+}
+
+void RecentMessageCache::Conversation::push(const Message& message)
+{
+    if (count < ring.size()) {
+        ring[(start + count) % ring.size()] = message;
+        ++count;
+    } else {
+        ring[start] = message;
+        start = (start + 1) % ring.size();
+        complete = false;
+    }
+}
+
+QVector<ChatMessage> RecentMessageCache::Conversation::newest(int limit) const
+{
+    QVector<ChatMessage> messages;
+    int first = qMax(0, count - limit);
+    messages.reserve(count - first);
+
+    for (int i = first; i < count; ++i) {
+        const Message& message = at(i);
+
+        // Jak w zapytaniu: przeczytana, jeśli kursor drugiej strony ją obejmuje
+        qint64 readId = 0;
+        for (auto it = readCursors.constBegin(); it != readCursors.constEnd(); ++it) {
+            if (it.key() != message.senderId) {
+                readId = it.value();
+            }
+        }
+
+        ChatMessage chatMessage;
+        chatMessage.id = message.id;
+        chatMessage.globalId = message.globalId;
+        chatMessage.username = usernames.value(message.senderId);
+        chatMessage.message = message.text;
+        chatMessage.timestamp = message.sentAt;
+        chatMessage.isRead = message.id <= readId;
+        messages.append(chatMessage);
+    }
+    return messages;
+}
+
+qint64 RecentMessageCache::costOf(const Message& message)
+{
+    return sizeof(Message) + message.text.size() * sizeof(QChar);
+}
+
+qint64 RecentMessageCache::costOf(const Conversation& conversation)
+{
+    qint64 cost = sizeof(Conversation) + (conversation.ring.size() - conversation.count) * sizeof(Message);
+    for (int i = 0; i < conversation.count; ++i) {
+        cost += costOf(conversation.at(i));
+    }
+    return cost;
+}
+
+void RecentMessageCache::reinsert(qint64 conversationId, Conversation* conversation)
+{
+    if (!m_cache.insert(conversationId, conversation, costOf(*conversation))) {
+        ++m_stats.invalidations;  // wpis większy niż cały budżet - QCache go usunął
+    }
+}
+
+bool RecentMessageCache::latest(qint64 conversationId, int limit, QVector<ChatMessage>& messages)
+{
+    QMutexLocker locker(&m_mutex);
+    const Conversation* conversation = m_cache.object(conversationId);
+    if (!conversation || (conversation->count < limit && !conversation->complete)) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    ++m_stats.hits;
+    messages = conversation->newest(limit);
+    return true;
+}
+
+bool RecentMessageCache::hasBefore(qint64 conversationId, qint64 messageId, bool& result)
+{
+    QMutexLocker locker(&m_mutex);
+    const Conversation* conversation = m_cache.object(conversationId);
+    if (!conversation || conversation->count == 0) {
+        return false;
+    }
+
+    if (conversation->at(0).id < messageId) {
+        result = true;
+        return true;
+    }
+    if (conversation->complete) {
+        result = false;
+        return true;
+    }
+    return false;
+}
+
+QVector<ChatMessage> RecentMessageCache::load(qint64 conversationId, const QVector<Message>& newestFirst,
+                                              const QHash<quint32, QString>& usernames,
+                                              const QHash<quint32, qint64>& readCursors,
+                                              bool complete, int limit)
+{
+    auto conversation = new Conversation;
+    conversation->ring.resize(qMax(1, qMax(m_capacity, int(newestFirst.size()))));
+    for (auto it = newestFirst.crbegin(); it != newestFirst.crend(); ++it) {
+        conversation->push(*it);
+    }
+    conversation->complete = complete;
+    conversation->usernames = usernames;
+    conversation->readCursors = readCursors;
+
+    QVector<ChatMessage> messages = conversation->newest(limit);
+
+    QMutexLocker locker(&m_mutex);
+    // Wiadomość zatwierdzona po odczycie mogła już minąć append - taki stan
+    // byłby nieaktualny aż do następnej wiadomości, więc go nie zapamiętujemy
+    qint64 loadedHead = conversation->count > 0 ? conversation->at(conversation->count - 1).id : 0;
+    qint64 head = ConversationHeads::getInstance().head(conversationId);
+    if (!isEnabled() || (head != ConversationHeads::UNKNOWN && head > loadedHead)) {
+        delete conversation;
+        return messages;
+    }
+
+    reinsert(conversationId, conversation);
+    return messages;
+}
+
+void RecentMessageCache::append(qint64 conversationId, const Message& message)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_cache.contains(conversationId)) {
+        return;
+    }
+
+    Conversation* conversation = m_cache.take(conversationId);
+    qint64 last = conversation->count > 0 ? conversation->at(conversation->count - 1).id : 0;
+    if (message.id <= last) {
+        reinsert(conversationId, conversation);  // już wczytana z bazy
+        return;
+    }
+
+    // Luka (zapis z innego wątku jeszcze nie dotarł) albo nieznany nadawca -
+    // rozmowa zostanie wczytana od nowa przy następnym odczycie
+    if (message.id != last + 1 || !conversation->usernames.contains(message.senderId)) {
+        ++m_stats.invalidations;
+        delete conversation;
+        return;
+    }
+
+    conversation->push(message);
+    reinsert(conversationId, conversation);
+}
+
+void RecentMessageCache::advanceCursor(qint64 conversationId, quint32 userId, qint64 readId)
+{
+    QMutexLocker locker(&m_mutex);
+    Conversation* conversation = m_cache.object(conversationId);
+    if (conversation) {
+        qint64& cursor = conversation->readCursors[userId];
+        cursor = qMax(cursor, readId);
+    }
+}
+
+RecentMessageCache::Snapshot RecentMessageCache::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    Snapshot result = m_stats;
+    result.conversations = m_cache.count();
+    result.bytes = m_cache.totalCost();
+    return result;
+}
+
+void RecentMessageCache::log() const
+{
+    Snapshot current = snapshot();
+    qInfo() << "Recent messages: conversations" << current.conversations
+            << "bytes" << current.bytes
+            << "hits" << current.hits
+            << "misses" << current.misses
+            << "invalidations" << current.invalidations;
+}
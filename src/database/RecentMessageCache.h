@@ -0,0 +1,99 @@
+/**
+ * @file RecentMessageCache.h
+ * @brief Newest messages of active conversations kept in memory
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef RECENTMESSAGECACHE_H
+#define RECENTMESSAGECACHE_H
+
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include "DatabaseManager.h"
+
+// Ostatnie per_conversation wiadomości każdej aktywnej rozmowy w buforze
+// cyklicznym. Rozmowa trafia do pamięci przy pierwszym odczycie
+// (getLatestMessages), a kolejne wiadomości są dopisywane po zatwierdzeniu
+// zapisu. Wszystkie rozmowy dzielą budżet budget_bytes; po jego przekroczeniu
+// wypadają najdawniej czytane (QCache). Wpis zna też kursory odczytu obu
+// uczestników, więc is_read liczy się bez zapytania.
+// Tylko tryb Consolidated - tylko tam id wiadomości są kolejne w rozmowie.
+class RecentMessageCache
+{
+public:
+    struct Message {
+        qint64 id = 0;
+        quint32 senderId = 0;
+        QString text;
+        QDateTime sentAt;
+        quint64 globalId = 0;
+    };
+
+    struct Snapshot {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 invalidations = 0;
+        int conversations = 0;
+        qint64 bytes = 0;
+    };
+
+    static RecentMessageCache& getInstance();
+
+    RecentMessageCache(int perConversation, qint64 budgetBytes);
+
+    bool isEnabled() const { return m_capacity > 0 && m_budget > 0; }
+    int capacity() const { return m_capacity; }
+
+    // false, gdy rozmowy nie ma w pamięci albo bufor nie sięga limit wiadomości wstecz
+    bool latest(qint64 conversationId, int limit, QVector<ChatMessage>& messages);
+    // Czy przed messageId jest starsza wiadomość; false, gdy bufor tego nie rozstrzyga
+    bool hasBefore(qint64 conversationId, qint64 messageId, bool& result);
+
+    // newestFirst - wynik zapytania (najwyżej capacity() wierszy, malejąco);
+    // complete - w bazie nie ma starszych. Zwraca limit najnowszych wiadomości
+    // niezależnie od tego, czy rozmowa zmieściła się w pamięci.
+    QVector<ChatMessage> load(qint64 conversationId, const QVector<Message>& newestFirst,
+                              const QHash<quint32, QString>& usernames,
+                              const QHash<quint32, qint64>& readCursors, bool complete, int limit);
+
+    // Po zatwierdzeniu zapisu; rozmowy spoza pamięci są pomijane
+    void append(qint64 conversationId, const Message& message);
+    void advanceCursor(qint64 conversationId, quint32 userId, qint64 readId);
+
+    Snapshot snapshot() const;
+    void log() const;
+
+private:
+    // Bufor cykliczny: wiadomości rosnąco od m_start
+    struct Conversation {
+        QVector<Message> ring;
+        int start = 0;
+        int count = 0;
+        bool complete = false;  // bufor zawiera pierwszą wiadomość rozmowy
+        QHash<quint32, QString> usernames;
+        QHash<quint32, qint64> readCursors;
+
+        const Message& at(int index) const { return ring[(start + index) % ring.size()]; }
+        void push(const Message& message);
+        QVector<ChatMessage> newest(int limit) const;
+    };
+
+    static qint64 costOf(const Message& message);
+    static qint64 costOf(const Conversation& conversation);
+    // Zmiana kosztu w QCache wymaga ponownego wstawienia
+    void reinsert(qint64 conversationId, Conversation* conversation);
+
+    const int m_capacity;
+    const qint64 m_budget;
+
+    mutable QMutex m_mutex;
+    QCache<qint64, Conversation> m_cache;
+    Snapshot m_stats;
+};
+
+#endif // RECENTMESSAGECACHE_H
@@ -0,0 +1,372 @@
+/**
+ * @file SchemaMigrator.cpp
+ * @brief Online migrations of per-user and per-pair tables into shared tables
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "SchemaMigrator.h"
+#include "DatabaseQueries.h"
+#include "ConversationHeads.h"
+#include <QRegularExpression>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QDebug>
+
+namespace {
+
+const QRegularExpression& chatTablePattern()
+{
+    static const QRegularExpression pattern("^chat_(\\d+)_(\\d+)$");
+    return pattern;
+}
+
+}
+
+SchemaMigrator::SchemaMigrator(DatabaseManager& db)
+    : m_db(db)
+{
+}
+
+QString SchemaMigrator::stateName(State state)
+{
+    switch (state) {
+    case State::DualWrite: return "dual_write";
+    case State::Backfilled: return "backfilled";
+    case State::Consolidated: return "consolidated";
+    case State::Legacy: break;
+    }
+    return "legacy";
+}
+
+SchemaMigrator::State SchemaMigrator::stateFromName(const QString& name)
+{
+    if (name == "dual_write") {
+        return State::DualWrite;
+    }
+    if (name == "backfilled") {
+        return State::Backfilled;
+    }
+    if (name == "consolidated") {
+        return State::Consolidated;
+    }
+    return State::Legacy;
+}
+
+bool SchemaMigrator::prepare(DatabaseManager::MessageStorage target)
+{
+    using Storage = DatabaseManager::MessageStorage;
+
+    m_target = target;
+    if (!loadState()) {
+        return false;
+    }
+
+    if (m_state == State::Consolidated) {
+        if (target != Storage::Consolidated) {
+            // Po przełączeniu chat_X_Y nie dostają nowych wiadomości
+            qWarning() << "Messages are already consolidated, ignoring migration target";
+        }
+        DatabaseManager::setMessageStorage(Storage::Consolidated);
+        return true;
+    }
+
+    if (target == Storage::Legacy) {
+        if (m_state != State::Legacy && !saveState(State::Legacy)) {
+            return false;
+        }
+        DatabaseManager::setMessageStorage(Storage::Legacy);
+        return true;
+    }
+
+    if (m_state == State::Legacy && !saveState(State::DualWrite)) {
+        return false;
+    }
+    DatabaseManager::setMessageStorage(Storage::DualWrite);
+
+    if (m_state == State::Backfilled && target == Storage::Consolidated) {
+        return cutover();
+    }
+
+    qInfo() << "Message storage migration state:" << stateName(m_state);
+    return true;
+}
+
+bool SchemaMigrator::backfill(int batchSize)
+{
+    BackfillProgress progress;
+    if (!startBackfill(progress)) {
+        return false;
+    }
+
+    while (!progress.finished()) {
+        if (!backfillStep(progress, batchSize)) {
+            return false;
+        }
+    }
+    return finishBackfill(progress);
+}
+
+bool SchemaMigrator::startBackfill(BackfillProgress& progress)
+{
+    QSqlQuery query(m_db.getDatabase());
+    if (!query.exec(DatabaseQueries::Migrations::LIST_CHAT_TABLES)) {
+        qWarning() << "Failed to list chat tables:" << query.lastError().text();
+        return false;
+    }
+
+    progress = BackfillProgress();
+    while (query.next()) {
+        QString table = query.value(0).toString();
+        if (chatTablePattern().match(table).hasMatch()) {
+            progress.tables.append(table);
+        }
+    }
+    return true;
+}
+
+bool SchemaMigrator::backfillStep(BackfillProgress& progress, int batchSize)
+{
+    if (progress.finished()) {
+        return true;
+    }
+
+    const QString& table = progress.tables.at(progress.table);
+    QRegularExpressionMatch match = chatTablePattern().match(table);
+    QSqlQuery query(m_db.getDatabase());
+
+    if (progress.maxId < 0) {
+        progress.conversation = m_db.conversationId(match.captured(1).toUInt(),
+                                                    match.captured(2).toUInt(), true);
+        if (progress.conversation == 0) {
+            return false;
+        }
+
+        // Wiadomości nowsze niż maxId zapisał już zapis podwójny
+        if (!query.exec(DatabaseQueries::Migrations::CHAT_TABLE_MAX_ID.arg(table)) || !query.next()) {
+            qWarning() << "Failed to read last message id of" << table << ":" << query.lastError().text();
+            return false;
+        }
+        progress.maxId = query.value(0).toLongLong();
+        progress.from = 0;
+        return true;
+    }
+
+    if (progress.from < progress.maxId) {
+        query.prepare(DatabaseQueries::Migrations::BACKFILL_CHAT_TABLE.arg(table));
+        query.addBindValue(progress.conversation);
+        query.addBindValue(progress.from);
+        query.addBindValue(qMin(progress.from + batchSize, progress.maxId));
+
+        if (!query.exec()) {
+            qWarning() << "Failed to backfill" << table << ":" << query.lastError().text();
+            return false;
+        }
+        progress.copied += qMax(0, query.numRowsAffected());
+        progress.from += batchSize;
+        return true;
+    }
+
+    query.prepare(DatabaseQueries::Conversations::RAISE_MESSAGE_ID);
+    query.addBindValue(progress.maxId);
+    query.addBindValue(progress.conversation);
+    if (!query.exec()) {
+        qWarning() << "Failed to raise message id of conversation" << progress.conversation
+                   << ":" << query.lastError().text();
+        return false;
+    }
+    ConversationHeads::getInstance().raise(progress.conversation, progress.maxId);
+
+    // Kursory odczytu obu uczestników z read_at przeniesionych wiadomości
+    for (int i = 1; i <= 2; ++i) {
+        query.prepare(DatabaseQueries::Migrations::SEED_READ_CURSOR
+                          .arg(table).arg(match.captured(i).toUInt()));
+        query.addBindValue(progress.conversation);
+        if (!query.exec()) {
+            qWarning() << "Failed to seed read cursors of" << table << ":" << query.lastError().text();
+            return false;
+        }
+    }
+
+    ++progress.table;
+    progress.maxId = -1;
+    return true;
+}
+
+bool SchemaMigrator::finishBackfill(const BackfillProgress& progress)
+{
+    if (!saveState(State::Backfilled)) {
+        return false;
+    }
+
+    qInfo() << "Backfilled" << progress.copied << "messages from" << progress.tables.size() << "chat tables";
+    return true;
+}
+
+bool SchemaMigrator::cutover()
+{
+    if (m_state != State::Backfilled) {
+        qWarning() << "Cannot switch to consolidated messages from state" << stateName(m_state);
+        return false;
+    }
+
+    if (!saveState(State::Consolidated)) {
+        return false;
+    }
+
+    DatabaseManager::setMessageStorage(DatabaseManager::MessageStorage::Consolidated);
+    qInfo() << "Messages are now read from conversation_messages";
+    return true;
+}
+
+bool SchemaMigrator::migrateFriendships()
+{
+    return copyPerUserTables(DatabaseQueries::Migrations::FRIENDSHIPS,
+                             DatabaseQueries::Migrations::LIST_FRIEND_TABLES,
+                             "^user_(\\d+)_friends$",
+                             DatabaseQueries::Migrations::COPY_FRIEND_TABLE);
+}
+
+bool SchemaMigrator::migrateInvitations()
+{
+    return copyPerUserTables(DatabaseQueries::Migrations::FRIEND_INVITATIONS,
+                             DatabaseQueries::Migrations::LIST_SENT_INVITATION_TABLES,
+                             "^user_(\\d+)_sent_invitations$",
+                             DatabaseQueries::Migrations::COPY_SENT_INVITATIONS);
+}
+
+bool SchemaMigrator::migrateMessageGlobalIds()
+{
+    const QString& migration = DatabaseQueries::Migrations::MESSAGE_GLOBAL_IDS;
+    QString state;
+    if (!readState(migration, state)) {
+        return false;
+    }
+    if (state == "done") {
+        return true;
+    }
+
+    // ALTER TABLE zatwierdza się niejawnie - bez transakcji
+    QSqlQuery query(m_db.getDatabase());
+    if (!query.exec(DatabaseQueries::Migrations::HAS_GLOBAL_ID_COLUMN) || !query.next()) {
+        qWarning() << "Failed to inspect conversation_messages:" << query.lastError().text();
+        return false;
+    }
+
+    if (query.value(0).toInt() == 0) {
+        if (!query.exec(DatabaseQueries::Migrations::ADD_GLOBAL_ID_COLUMN)) {
+            qWarning() << "Failed to add global_id column:" << query.lastError().text();
+            return false;
+        }
+        qInfo() << "Migration" << migration << "added conversation_messages.global_id";
+    }
+
+    return writeState(migration, "done");
+}
+
+bool SchemaMigrator::copyPerUserTables(const QString& migration, const QString& listQuery,
+                                       const QString& pattern, const QString& copyQuery)
+{
+    QString state;
+    if (!readState(migration, state)) {
+        return false;
+    }
+    if (state == "done") {
+        return true;
+    }
+
+    QSqlDatabase& database = m_db.getDatabase();
+    QSqlQuery query(database);
+    if (!query.exec(listQuery)) {
+        qWarning() << "Failed to list tables for migration" << migration << ":" << query.lastError().text();
+        return false;
+    }
+
+    QStringList tables;
+    while (query.next()) {
+        tables.append(query.value(0).toString());
+    }
+
+    const QRegularExpression tableName(pattern);
+    int copied = 0;
+
+    if (!database.transaction()) {
+        qWarning() << "Failed to start transaction for migration" << migration;
+        return false;
+    }
+
+    for (const QString& table : tables) {
+        QRegularExpressionMatch match = tableName.match(table);
+        if (!match.hasMatch()) {
+            continue;
+        }
+
+        if (!query.exec(QString(copyQuery).arg(match.captured(1).toUInt()).arg(table))) {
+            qWarning() << "Failed to copy" << table << ":" << query.lastError().text();
+            database.rollback();
+            return false;
+        }
+        copied += qMax(0, query.numRowsAffected());
+    }
+
+    if (!writeState(migration, "done") || !database.commit()) {
+        qWarning() << "Failed to commit migration" << migration;
+        database.rollback();
+        return false;
+    }
+
+    qInfo() << "Migration" << migration << "copied" << copied << "rows from" << tables.size() << "tables";
+    return true;
+}
+
+bool SchemaMigrator::loadState()
+{
+    QString state;
+    if (!readState(DatabaseQueries::Migrations::CONSOLIDATED_MESSAGES, state)) {
+        return false;
+    }
+
+    m_state = stateFromName(state);
+    return true;
+}
+
+bool SchemaMigrator::saveState(State state)
+{
+    if (!writeState(DatabaseQueries::Migrations::CONSOLIDATED_MESSAGES, stateName(state))) {
+        return false;
+    }
+
+    m_state = state;
+    return true;
+}
+
+bool SchemaMigrator::readState(const QString& migration, QString& state)
+{
+    QSqlQuery query(m_db.getDatabase());
+    query.prepare(DatabaseQueries::Migrations::GET_STATE);
+    query.addBindValue(migration);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to read migration state:" << query.lastError().text();
+        return false;
+    }
+
+    // Brak wiersza - migracja jeszcze się nie zaczęła
+    state = query.next() ? query.value(0).toString() : QString();
+    return true;
+}
+
+bool SchemaMigrator::writeState(const QString& migration, const QString& state)
+{
+    QSqlQuery query(m_db.getDatabase());
+    query.prepare(DatabaseQueries::Migrations::SET_STATE);
+    query.addBindValue(migration);
+    query.addBindValue(state);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to save migration state:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file SchemaMigrator.h
+ * @brief Online migrations of per-user and per-pair tables into shared tables
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QString>
+#include <QStringList>
+#include "DatabaseManager.h"
+
+// Przeniesienie wiadomości z tabel chat_X_Y do conversation_messages bez
+// zatrzymywania serwera. Stan w schema_migrations przechodzi kolejno:
+//  legacy -> dual_write   nowe wiadomości trafiają do obu miejsc,
+//  dual_write -> backfilled   starsze wiadomości skopiowane paczkami,
+//  backfilled -> consolidated   odczyty i zapisy tylko z conversation_messages.
+// Do konsolidacji odczyty idą z chat_X_Y, więc powrót do legacy jest możliwy.
+class SchemaMigrator
+{
+public:
+    enum class State {
+        Legacy,
+        DualWrite,
+        Backfilled,
+        Consolidated
+    };
+
+    explicit SchemaMigrator(DatabaseManager& db);
+
+    // Wczytuje stan, przesuwa go w stronę docelowego trybu i ustawia
+    // DatabaseManager::messageStorage(); wywoływane przed przyjęciem sesji
+    bool prepare(DatabaseManager::MessageStorage target);
+    bool needsBackfill() const { return m_state == State::DualWrite && m_target != DatabaseManager::MessageStorage::Legacy; }
+
+    // Postęp kopiowania historii między kolejnymi krokami backfillStep
+    struct BackfillProgress {
+        QStringList tables;
+        int table = 0;        // indeks bieżącej tabeli
+        qint64 conversation = 0;
+        qint64 from = 0;
+        qint64 maxId = -1;    // -1 - bieżąca tabela jeszcze nierozpoczęta
+        qint64 copied = 0;
+
+        bool finished() const { return table >= tables.size(); }
+    };
+
+    // Kopiuje historię tabel chat_X_Y; każda paczka to osobna krótka transakcja
+    bool backfill(int batchSize);
+    // To samo w krokach - jedna paczka albo domknięcie jednej tabeli na wywołanie,
+    // żeby kopiowanie w tle nie zajmowało workera bazy na cały czas migracji
+    bool startBackfill(BackfillProgress& progress);
+    bool backfillStep(BackfillProgress& progress, int batchSize);
+    bool finishBackfill(const BackfillProgress& progress);
+    bool cutover();
+
+    // Jednorazowe przeniesienie tabel user_X_friends do friendships; wywoływane
+    // przed wczytaniem FriendGraph. Stare tabele zostają nietknięte.
+    bool migrateFriendships();
+    // Jak wyżej dla user_X_sent_invitations/user_X_received_invitations -> friend_invitations
+    bool migrateInvitations();
+    // Dodaje conversation_messages.global_id w bazach sprzed MessageIdGenerator
+    bool migrateMessageGlobalIds();
+
+    State state() const { return m_state; }
+
+    static QString stateName(State state);
+    static State stateFromName(const QString& name);
+
+private:
+    bool loadState();
+    bool saveState(State state);
+    bool readState(const QString& migration, QString& state);
+    bool writeState(const QString& migration, const QString& state);
+    // Kopiuje tabele pasujące do pattern (grupa 1 = id użytkownika) zapytaniem copyQuery
+    // w jednej transakcji razem z oznaczeniem migracji jako wykonanej
+    bool copyPerUserTables(const QString& migration, const QString& listQuery,
+                           const QString& pattern, const QString& copyQuery);
+
+    DatabaseManager& m_db;
+    State m_state = State::Legacy;
+    DatabaseManager::MessageStorage m_target = DatabaseManager::MessageStorage::Legacy;
+};
+
+#endif // SCHEMAMIGRATOR_H
@@ -0,0 +1,70 @@
+/**
+ * @file SyncVersions.cpp
+ * @brief Change numbers of friendships and presence used by incremental sync
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "SyncVersions.h"
+#include <QRandomGenerator>
+
+SyncVersions& SyncVersions::getInstance()
+{
+    static SyncVersions instance;
+    return instance;
+}
+
+SyncVersions::SyncVersions()
+    : m_epoch(QString::number(QRandomGenerator::global()->generate64(), 16))
+{
+}
+
+QString SyncVersions::version() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_epoch + ':' + QString::number(m_current);
+}
+
+quint64 SyncVersions::parse(const QString& version) const
+{
+    int colon = version.indexOf(':');
+    if (colon <= 0 || QStringView(version).left(colon) != m_epoch) {
+        return 0;
+    }
+
+    bool ok = false;
+    quint64 number = QStringView(version).mid(colon + 1).toULongLong(&ok);
+    QMutexLocker locker(&m_mutex);
+    // Numer z przyszłości nie może pochodzić z tego procesu
+    return ok && number <= m_current ? number : 0;
+}
+
+void SyncVersions::friendsChanged(quint32 userId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_friends.insert(userId, ++m_current);
+}
+
+void SyncVersions::presenceChanged(quint32 userId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_presence.insert(userId, ++m_current);
+}
+
+quint64 SyncVersions::friendsVersion(quint32 userId) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_friends.value(userId, 0);
+}
+
+QVector<quint32> SyncVersions::presenceChangedSince(const QVector<quint32>& userIds, quint64 since) const
+{
+    QVector<quint32> changed;
+    QMutexLocker locker(&m_mutex);
+    for (quint32 userId : userIds) {
+        if (m_presence.value(userId, 0) > since) {
+            changed.append(userId);
+        }
+    }
+    return changed;
+}
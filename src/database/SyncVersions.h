@@ -0,0 +1,50 @@
+/**
+ * @file SyncVersions.h
+ * @brief Change numbers of friendships and presence used by incremental sync
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef SYNCVERSIONS_H
+#define SYNCVERSIONS_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+// Jeden licznik zmian dla całego procesu: zmiana listy znajomych lub statusu
+// użytkownika zapisuje przy nim kolejny numer. Klient dostaje w odpowiedzi na
+// sync wersję "<epoka>:<numer>" i odsyła ją przy następnym sync - serwer zwraca
+// wtedy tylko to, co zmieniło się później. Epoka jest losowana przy starcie,
+// więc wersja z poprzedniego procesu wymusza pełną listę znajomych.
+class SyncVersions
+{
+public:
+    static SyncVersions& getInstance();
+
+    QString version() const;
+    // 0, gdy wersja pochodzi z innego procesu albo jest nieczytelna
+    quint64 parse(const QString& version) const;
+
+    void friendsChanged(quint32 userId);
+    void presenceChanged(quint32 userId);
+
+    quint64 friendsVersion(quint32 userId) const;
+    // Użytkownicy z listy, których status zmienił się po since
+    QVector<quint32> presenceChangedSince(const QVector<quint32>& userIds, quint64 since) const;
+
+private:
+    SyncVersions();
+    SyncVersions(const SyncVersions&) = delete;
+    SyncVersions& operator=(const SyncVersions&) = delete;
+
+    QString m_epoch;
+
+    mutable QMutex m_mutex;
+    quint64 m_current = 0;
+    QHash<quint32, quint64> m_friends;
+    QHash<quint32, quint64> m_presence;
+};
+
+#endif // SYNCVERSIONS_H
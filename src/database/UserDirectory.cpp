@@ -0,0 +1,153 @@
+/**
+ * @file UserDirectory.cpp
+ * @brief In-memory id/username directory of the users table
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "UserDirectory.h"
+#include "DatabaseManager.h"
+#include <QDateTime>
+#include <QDebug>
+
+UserDirectory& UserDirectory::getInstance()
+{
+    static UserDirectory instance;
+    return instance;
+}
+
+UserDirectory::UserDirectory(std::function<qint64()> clock)
+    : m_clock(std::move(clock))
+{
+    if (!m_clock) {
+        m_clock = []() { return QDateTime::currentMSecsSinceEpoch(); };
+    }
+}
+
+bool UserDirectory::load(DatabaseManager& db)
+{
+    QVector<QPair<quint32, QString>> users;
+    if (!db.getAllUsers(users)) {
+        return false;
+    }
+
+    build(users);
+    qInfo() << "Loaded" << users.size() << "users into memory";
+    return true;
+}
+
+void UserDirectory::build(const QVector<QPair<quint32, QString>>& users)
+{
+    QHash<quint32, QString> usernames;
+    QHash<QString, quint32> ids;
+    usernames.reserve(users.size());
+    ids.reserve(users.size());
+    for (const auto& user : users) {
+        usernames.insert(user.first, user.second);
+        ids.insert(key(user.second), user.first);
+    }
+
+    QWriteLocker locker(&m_lock);
+    m_usernames = std::move(usernames);
+    m_ids = std::move(ids);
+    m_missingIds.clear();
+    m_missingNames.clear();
+}
+
+UserDirectory::Lookup UserDirectory::username(quint32 userId, QString& username) const
+{
+    QReadLocker locker(&m_lock);
+    auto it = m_usernames.constFind(userId);
+    if (it != m_usernames.constEnd()) {
+        username = it.value();
+        m_hits.fetchAndAddRelaxed(1);
+        return Lookup::Found;
+    }
+
+    auto missing = m_missingIds.constFind(userId);
+    if (missing != m_missingIds.constEnd() && missing.value() > m_clock()) {
+        m_hits.fetchAndAddRelaxed(1);
+        return Lookup::Missing;
+    }
+    m_misses.fetchAndAddRelaxed(1);
+    return Lookup::Unknown;
+}
+
+UserDirectory::Lookup UserDirectory::userId(const QString& username, quint32& userId) const
+{
+    QString name = key(username);
+    QReadLocker locker(&m_lock);
+    auto it = m_ids.constFind(name);
+    if (it != m_ids.constEnd()) {
+        userId = it.value();
+        m_hits.fetchAndAddRelaxed(1);
+        return Lookup::Found;
+    }
+
+    auto missing = m_missingNames.constFind(name);
+    if (missing != m_missingNames.constEnd() && missing.value() > m_clock()) {
+        m_hits.fetchAndAddRelaxed(1);
+        return Lookup::Missing;
+    }
+    m_misses.fetchAndAddRelaxed(1);
+    return Lookup::Unknown;
+}
+
+void UserDirectory::add(quint32 userId, const QString& username)
+{
+    QString name = key(username);
+    QWriteLocker locker(&m_lock);
+    // Id z usuniętej i odtworzonej tabeli może dostać inną nazwę
+    auto previous = m_usernames.constFind(userId);
+    if (previous != m_usernames.constEnd() && key(previous.value()) != name) {
+        m_ids.remove(key(previous.value()));
+    }
+    m_usernames.insert(userId, username);
+    m_ids.insert(name, userId);
+    m_missingIds.remove(userId);
+    m_missingNames.remove(name);
+}
+
+template<typename K>
+void UserDirectory::remember(QHash<K, qint64>& missing, const K& entry)
+{
+    qint64 now = m_clock();
+    if (missing.size() >= NEGATIVE_CAPACITY) {
+        missing.removeIf([now](typename QHash<K, qint64>::iterator it) { return it.value() <= now; });
+        // Wszystkie aktualne - prościej zacząć od nowa niż śledzić kolejność
+        if (missing.size() >= NEGATIVE_CAPACITY) {
+            missing.clear();
+        }
+    }
+    missing.insert(entry, now + NEGATIVE_TTL_MS);
+}
+
+void UserDirectory::addMissing(quint32 userId)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_usernames.contains(userId)) {
+        remember(m_missingIds, userId);
+    }
+}
+
+void UserDirectory::addMissing(const QString& username)
+{
+    QString name = key(username);
+    QWriteLocker locker(&m_lock);
+    if (!m_ids.contains(name)) {
+        remember(m_missingNames, name);
+    }
+}
+
+int UserDirectory::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_usernames.size();
+}
+
+void UserDirectory::log() const
+{
+    qInfo() << "User directory: users" << size()
+            << "hits" << m_hits.loadRelaxed()
+            << "database lookups" << m_misses.loadRelaxed();
+}
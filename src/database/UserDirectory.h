@@ -0,0 +1,80 @@
+/**
+ * @file UserDirectory.h
+ * @brief In-memory id/username directory of the users table
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef USERDIRECTORY_H
+#define USERDIRECTORY_H
+
+#include <QAtomicInteger>
+#include <QHash>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+class DatabaseManager;
+
+// Kopia par (id, username) z tabeli users - nazwy użytkowników nie zmieniają
+// się, więc wpis raz wczytany jest zawsze aktualny. Wczytywana w całości przy
+// starcie i uzupełniana przez registerUser oraz odczyty z bazy. Brak wpisu
+// nie oznacza braku użytkownika (np. dodanego spoza serwera), dlatego
+// nieistniejące id i nazwy są zapamiętywane osobno na NEGATIVE_TTL_MS.
+class UserDirectory
+{
+public:
+    enum class Lookup {
+        Found,
+        Missing,  // potwierdzony niedawno brak w bazie
+        Unknown   // trzeba zapytać bazę
+    };
+
+    static constexpr qint64 NEGATIVE_TTL_MS = 30000;
+    static constexpr int NEGATIVE_CAPACITY = 4096;
+
+    static UserDirectory& getInstance();
+
+    // clock - czas w ms, domyślnie QDateTime::currentMSecsSinceEpoch
+    explicit UserDirectory(std::function<qint64()> clock = {});
+
+    bool load(DatabaseManager& db);
+    void build(const QVector<QPair<quint32, QString>>& users);
+
+    Lookup username(quint32 userId, QString& username) const;
+    Lookup userId(const QString& username, quint32& userId) const;
+
+    // Wynik zapytania do bazy; add usuwa też odpowiadające wpisy negatywne
+    void add(quint32 userId, const QString& username);
+    void addMissing(quint32 userId);
+    void addMissing(const QString& username);
+
+    int size() const;
+    void log() const;
+
+private:
+    UserDirectory(const UserDirectory&) = delete;
+    UserDirectory& operator=(const UserDirectory&) = delete;
+
+    // Kolacja tabeli users nie rozróżnia wielkości liter
+    static QString key(const QString& username) { return username.toLower(); }
+    template<typename K>
+    void remember(QHash<K, qint64>& missing, const K& entry);
+
+    std::function<qint64()> m_clock;
+
+    mutable QReadWriteLock m_lock;
+    QHash<quint32, QString> m_usernames;
+    QHash<QString, quint32> m_ids;  // klucz: key(username)
+
+    // Chwila wygaśnięcia wpisu negatywnego
+    QHash<quint32, qint64> m_missingIds;
+    QHash<QString, qint64> m_missingNames;
+
+    mutable QAtomicInteger<quint64> m_hits = 0;
+    mutable QAtomicInteger<quint64> m_misses = 0;
+};
+
+#endif // USERDIRECTORY_H
@@ -0,0 +1,191 @@
+/**
+ * @file UsernameIndex.cpp
+ * @brief In-memory substring and prefix index of usernames
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "UsernameIndex.h"
+#include <QDebug>
+#include <algorithm>
+
+UsernameIndex& UsernameIndex::getInstance()
+{
+    static UsernameIndex instance;
+    return instance;
+}
+
+bool UsernameIndex::load(DatabaseManager& db)
+{
+    QVector<QPair<quint32, QString>> users;
+    if (!db.getAllUsers(users)) {
+        return false;
+    }
+
+    build(users);
+    qInfo() << "Indexed" << users.size() << "usernames for search";
+    return true;
+}
+
+void UsernameIndex::build(const QVector<QPair<quint32, QString>>& users)
+{
+    QVector<Entry> entries;
+    entries.reserve(users.size());
+    for (const auto& user : users) {
+        entries.append({key(user.second), user.first, user.second});
+    }
+
+    QWriteLocker locker(&m_lock);
+    rebuild(std::move(entries));
+    m_loaded = true;
+}
+
+bool UsernameIndex::isLoaded() const
+{
+    QReadLocker locker(&m_lock);
+    return m_loaded;
+}
+
+quint64 UsernameIndex::trigram(const QString& key, int position)
+{
+    return (quint64(key[position].unicode()) << 32) |
+           (quint64(key[position + 1].unicode()) << 16) |
+           quint64(key[position + 2].unicode());
+}
+
+void UsernameIndex::rebuild(QVector<Entry> entries)
+{
+    std::sort(entries.begin(), entries.end());
+
+    QHash<quint64, QVector<int>> postings;
+    for (int i = 0; i < entries.size(); ++i) {
+        const QString& name = entries[i].key;
+        for (int j = 0; j + 3 <= name.size(); ++j) {
+            QVector<int>& list = postings[trigram(name, j)];
+            // Powtórzony trigram w tej samej nazwie
+            if (list.isEmpty() || list.last() != i) {
+                list.append(i);
+            }
+        }
+    }
+
+    m_entries = std::move(entries);
+    m_postings = std::move(postings);
+    m_added.clear();
+    ++m_revision;
+}
+
+void UsernameIndex::add(quint32 userId, const QString& username)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_loaded) {
+        return;
+    }
+
+    Entry entry{key(username), userId, username};
+    m_added.insert(std::upper_bound(m_added.begin(), m_added.end(), entry), entry);
+    ++m_revision;
+
+    if (m_added.size() >= COMPACT_THRESHOLD) {
+        QVector<Entry> entries = m_entries;
+        entries.append(m_added);
+        rebuild(std::move(entries));
+    }
+}
+
+bool UsernameIndex::matches(const QString& username, const QString& query, bool prefix)
+{
+    QString name = key(username);
+    return prefix ? name.startsWith(query) : name.contains(query);
+}
+
+QVector<UsernameIndex::Entry> UsernameIndex::baseMatches(const QString& query, bool prefix,
+                                                         int limit) const
+{
+    QVector<Entry> found;
+
+    if (prefix) {
+        auto it = std::lower_bound(m_entries.begin(), m_entries.end(), query,
+                                   [](const Entry& entry, const QString& value) {
+                                       return entry.key < value;
+                                   });
+        for (; it != m_entries.end() && found.size() < limit && it->key.startsWith(query); ++it) {
+            found.append(*it);
+        }
+        return found;
+    }
+
+    // Krótsze zapytania nie mają trigramu - dopasowań jest zwykle dużo,
+    // więc przegląd po kolei szybko zbiera limit
+    if (query.size() < 3) {
+        for (const Entry& entry : m_entries) {
+            if (found.size() >= limit) {
+                break;
+            }
+            if (entry.key.contains(query)) {
+                found.append(entry);
+            }
+        }
+        return found;
+    }
+
+    const QVector<int>* shortest = nullptr;
+    for (int j = 0; j + 3 <= query.size(); ++j) {
+        auto it = m_postings.constFind(trigram(query, j));
+        if (it == m_postings.constEnd()) {
+            return found;  // żadna nazwa nie ma tego trigramu
+        }
+        if (!shortest || it->size() < shortest->size()) {
+            shortest = &it.value();
+        }
+    }
+
+    for (int position : *shortest) {
+        if (found.size() >= limit) {
+            break;
+        }
+        const Entry& entry = m_entries[position];
+        if (entry.key.contains(query)) {
+            found.append(entry);
+        }
+    }
+    return found;
+}
+
+QVector<UserSearchResult> UsernameIndex::search(const QString& query, bool prefix, int limit,
+                                                bool* complete) const
+{
+    QString needle = key(query);
+    QReadLocker locker(&m_lock);
+
+    // Jeden nadmiarowy wynik mówi, czy lista jest pełna
+    QVector<Entry> found = baseMatches(needle, prefix, limit + 1);
+    for (const Entry& entry : m_added) {
+        if (prefix ? entry.key.startsWith(needle) : entry.key.contains(needle)) {
+            found.insert(std::upper_bound(found.begin(), found.end(), entry), entry);
+        }
+    }
+
+    if (complete) {
+        *complete = found.size() <= limit;
+    }
+
+    QVector<UserSearchResult> results;
+    results.reserve(qMin<int>(found.size(), limit));
+    for (int i = 0; i < found.size() && i < limit; ++i) {
+        results.append({found[i].id, found[i].username});
+    }
+    return results;
+}
+
+quint64 UsernameIndex::revision() const
+{
+    QReadLocker locker(&m_lock);
+    return m_revision;
+}
+
+int UsernameIndex::size() const
+{
+    QReadLocker locker(&m_lock);
+    return m_entries.size() + m_added.size();
+}
@@ -0,0 +1,82 @@
+/**
+ * @file UsernameIndex.h
+ * @brief In-memory substring and prefix index of usernames
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef USERNAMEINDEX_H
+#define USERNAMEINDEX_H
+
+#include <QHash>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+#include "DatabaseManager.h"
+
+// Wyszukiwarka search_users bez pełnego skanu tabeli users. Nazwy (małymi
+// literami) leżą w tablicy posortowanej alfabetycznie: zapytania o prefiks
+// to wyszukiwanie binarne, a dla podciągów każdy trigram ma listę pozycji
+// w tej tablicy. Kandydaci z najkrótszej listy są sprawdzani po kolei, więc
+// wyniki wychodzą już posortowane i skan kończy się po limit dopasowaniach.
+// Rejestracje trafiają do małej posortowanej nakładki przeglądanej liniowo;
+// po COMPACT_THRESHOLD wpisach indeks jest budowany od nowa.
+class UsernameIndex
+{
+public:
+    static constexpr int COMPACT_THRESHOLD = 1024;
+
+    static UsernameIndex& getInstance();
+
+    UsernameIndex() = default;
+
+    // Do pierwszego wczytania wyszukiwanie idzie do bazy
+    bool load(DatabaseManager& db);
+    void build(const QVector<QPair<quint32, QString>>& users);
+    bool isLoaded() const;
+
+    // Bez wczytanego indeksu ignorowane
+    void add(quint32 userId, const QString& username);
+
+    // Pierwsze limit nazw zawierających query (prefix - zaczynających się od
+    // query) w kolejności alfabetycznej; complete - nie ma dalszych dopasowań
+    QVector<UserSearchResult> search(const QString& query, bool prefix, int limit,
+                                     bool* complete = nullptr) const;
+    // Zmienia się przy każdej zmianie zawartości - unieważnia wyniki zapamiętane przez sesje
+    quint64 revision() const;
+    int size() const;
+
+    static QString key(const QString& username) { return username.toLower(); }
+    // query w postaci key()
+    static bool matches(const QString& username, const QString& query, bool prefix);
+
+private:
+    struct Entry {
+        QString key;
+        quint32 id = 0;
+        QString username;
+
+        bool operator<(const Entry& other) const
+        {
+            return key != other.key ? key < other.key : id < other.id;
+        }
+    };
+
+    UsernameIndex(const UsernameIndex&) = delete;
+    UsernameIndex& operator=(const UsernameIndex&) = delete;
+
+    static quint64 trigram(const QString& key, int position);
+    void rebuild(QVector<Entry> entries);
+    QVector<Entry> baseMatches(const QString& query, bool prefix, int limit) const;
+
+    mutable QReadWriteLock m_lock;
+    bool m_loaded = false;
+    quint64 m_revision = 0;
+
+    QVector<Entry> m_entries;                 // posortowane
+    QHash<quint64, QVector<int>> m_postings;  // trigram -> rosnące pozycje w m_entries
+    QVector<Entry> m_added;                   // nakładka, posortowana
+};
+
+#endif // USERNAMEINDEX_H
@@ -1,10 +1,26 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include "server/Server.h"
+#include "server/ServerConfig.h"
+#include "server/SessionMetrics.h"
+#include "server/PresenceRegistry.h"
+#include "server/SendDeduplicator.h"
+#include "server/DeliveryTracker.h"
 #include "database/DatabaseManager.h"
+#include "database/DatabaseWorkerPool.h"
+#include "database/ConnectionPool.h"
+#include "database/RecentMessageCache.h"
+#include "database/SchemaMigrator.h"
+#include "database/FriendGraph.h"
+#include "database/UserDirectory.h"
+#include "database/UsernameIndex.h"
+#include "database/MessageBatcher.h"
+#include "database/MessageJournal.h"
+#include <QTimer>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QCryptographicHash>
+#include <memory>
 
 QString hashPassword(const QString& password, const QString& salt) {
     QString combinedPassword = password + salt;
@@ -46,6 +62,22 @@ void fillTestData(DatabaseManager* db) {
             }
         }
 
+        if (!query.exec("DELETE FROM conversation_messages")) {
+            qDebug() << "Clean conversation messages error:" << query.lastError().text();
+        }
+        if (!query.exec("DELETE FROM conversations")) {
+            qDebug() << "Clean conversations error:" << query.lastError().text();
+        }
+        if (!query.exec("DELETE FROM read_cursors")) {
+            qDebug() << "Clean read cursors error:" << query.lastError().text();
+        }
+        if (!query.exec("DELETE FROM friendships")) {
+            qDebug() << "Clean friendships error:" << query.lastError().text();
+        }
+        if (!query.exec("DELETE FROM friend_invitations")) {
+            qDebug() << "Clean friend invitations error:" << query.lastError().text();
+        }
+
         // Usuwanie tabel zaproszeń
         query.exec("SELECT TABLE_NAME FROM information_schema.tables "
                    "WHERE table_schema = DATABASE() "
@@ -163,44 +195,6 @@ void fillTestData(DatabaseManager* db) {
             throw std::runtime_error("Failed to add test6: " + query.lastError().text().toStdString());
         }
 
-        // Tworzenie tabel zaproszeń dla wszystkich użytkowników
-        qDebug() << "Creating invitation tables...";
-        for(int i = 1; i <= 6; i++) {
-            QString sentTableQuery = QString(
-                                         "CREATE TABLE IF NOT EXISTS user_%1_sent_invitations ("
-                                         "request_id INT AUTO_INCREMENT PRIMARY KEY, "
-                                         "to_user_id INT NOT NULL, "
-                                         "to_username VARCHAR(32) NOT NULL, "
-                                         "status ENUM('pending', 'accepted', 'rejected', 'cancelled') DEFAULT 'pending', "
-                                         "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-                                         "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP, "
-                                         "FOREIGN KEY (to_user_id) REFERENCES users(id)"
-                                         ") ENGINE=InnoDB;").arg(i);
-
-            QString receivedTableQuery = QString(
-                                             "CREATE TABLE IF NOT EXISTS user_%1_received_invitations ("
-                                             "request_id INT AUTO_INCREMENT PRIMARY KEY, "
-                                             "from_user_id INT NOT NULL, "
-                                             "from_username VARCHAR(32) NOT NULL, "
-                                             "status ENUM('pending', 'accepted', 'rejected', 'cancelled') DEFAULT 'pending', "
-                                             "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-                                             "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP, "
-                                             "FOREIGN KEY (from_user_id) REFERENCES users(id)"
-                                             ") ENGINE=InnoDB;").arg(i);
-
-            if (!query.exec(sentTableQuery)) {
-                throw std::runtime_error("Failed to create sent invitations table for user " +
-                                         QString::number(i).toStdString());
-            }
-            qDebug() << "Created new invitations table:" << QString("user_%1_sent_invitations").arg(i);
-
-            if (!query.exec(receivedTableQuery)) {
-                throw std::runtime_error("Failed to create received invitations table for user " +
-                                         QString::number(i).toStdString());
-            }
-            qDebug() << "Created new invitations table:" << QString("user_%1_received_invitations").arg(i);
-        }
-
         // Dodawanie relacji znajomych dla wszystkich użytkowników testowych
         qDebug() << "Adding friends relationships...";
 
@@ -219,23 +213,6 @@ void fillTestData(DatabaseManager* db) {
             throw std::runtime_error("Failed to add friends for test3");
         }
 
-        // Tworzenie tabel friends dla użytkowników 4-6
-        for(int i = 4; i <= 6; i++) {
-            QString createFriendsTableQuery = QString(
-                                                  "CREATE TABLE IF NOT EXISTS user_%1_friends ("
-                                                  "friend_id INT NOT NULL, "
-                                                  "FOREIGN KEY (friend_id) REFERENCES users(id), "
-                                                  "PRIMARY KEY (friend_id)"
-                                                  ") ENGINE=InnoDB;").arg(i);
-
-            if (!query.exec(createFriendsTableQuery)) {
-                throw std::runtime_error("Failed to create friends table for user " +
-                                         QString::number(i).toStdString() +
-                                         ": " + query.lastError().text().toStdString());
-            }
-            qDebug() << "Created new friends table:" << QString("user_%1_friends").arg(i);
-        }
-
 
 
         // Dodawanie testowych wiadomości - 50 wiadomości między każdą parą użytkowników
@@ -295,6 +272,32 @@ void fillTestData(DatabaseManager* db) {
     }
 }
 
+// Uzupełnianie historii po jednym kroku na zadanie puli - między paczkami
+// worker obsługuje pozostałe zapytania (np. zbiorczy zapis statusów)
+void continueBackfill(std::shared_ptr<SchemaMigrator::BackfillProgress> progress) {
+    DatabaseWorkerPool::getInstance().submit<bool>(0, [progress](DatabaseManager& db) {
+        const DatabaseManager::MigrationConfig& config = DatabaseManager::MigrationConfig::instance;
+        SchemaMigrator backfillMigrator(db);
+        if (!backfillMigrator.backfillStep(*progress, config.backfillBatchSize)) {
+            return false;
+        }
+        if (!progress->finished()) {
+            return true;
+        }
+        return backfillMigrator.finishBackfill(*progress)
+               && (config.messageStorage != DatabaseManager::MessageStorage::Consolidated
+                   || backfillMigrator.cutover());
+    }).then(QCoreApplication::instance(), [progress](bool ok) {
+        if (!ok) {
+            qWarning() << "Message backfill failed, staying in dual write mode";
+        } else if (!progress->finished()) {
+            continueBackfill(progress);
+        }
+    }).onCanceled(QCoreApplication::instance(), []() {
+        qWarning() << "Message backfill interrupted, staying in dual write mode";
+    });
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication app(argc, argv);
@@ -304,6 +307,8 @@ int main(int argc, char *argv[])
 
     qInfo() << "Initializing JupiterServer v2.0...";
 
+    ServerConfig::load("config/server.conf");
+
     DatabaseManager dbManager;
     if (!dbManager.init()) {
         qCritical() << "Failed to initialize database";
@@ -311,20 +316,134 @@ int main(int argc, char *argv[])
     }
 
     qInfo() << "Database initialized successfully";
+
+    // Tryb przechowywania wiadomości musi być ustalony przed pierwszą sesją,
+    // a także przed danymi testowymi - po przełączeniu trafiają one od razu
+    // do conversation_messages, nie do chat_X_Y
+    SchemaMigrator migrator(dbManager);
+    if (!migrator.prepare(DatabaseManager::MigrationConfig::instance.messageStorage)) {
+        qCritical() << "Failed to prepare message storage migration";
+        return 1;
+    }
+
     fillTestData(&dbManager);
 
+    if (!migrator.migrateFriendships() || !FriendGraph::getInstance().load(dbManager)) {
+        qCritical() << "Failed to load friendships";
+        return 1;
+    }
+
+    if (!UserDirectory::getInstance().load(dbManager) || !UsernameIndex::getInstance().load(dbManager)) {
+        qCritical() << "Failed to load users";
+        return 1;
+    }
+
+    if (!migrator.migrateInvitations()) {
+        qCritical() << "Failed to migrate friend invitations";
+        return 1;
+    }
+
+    if (!migrator.migrateMessageGlobalIds()) {
+        qCritical() << "Failed to add message global ids";
+        return 1;
+    }
+
+    // Wiadomości potwierdzone przed awarią, a niezapisane jeszcze w bazie
+    if (DatabaseManager::JournalConfig::instance.enabled &&
+        !MessageJournal::getInstance().open(dbManager)) {
+        qCritical() << "Failed to recover message journal";
+        return 1;
+    }
+
+    // Statusy z poprzedniego uruchomienia są nieaktualne - nie ma jeszcze żadnej sesji
+    PresenceRegistry::getInstance().reconcile(dbManager);
+
+    DatabaseWorkerPool::getInstance().start(DatabaseManager::DatabaseConfig::instance.workerThreads);
+    // Pierwsze użycie w głównym wątku - timer partii działa w pętli aplikacji
+    MessageBatcher::getInstance().start();
+    if (DatabaseManager::JournalConfig::instance.enabled) {
+        MessageJournal::getInstance().start();
+    }
+
+    // Uzupełnianie historii trwa w tle, serwer w tym czasie zapisuje do obu miejsc
+    if (migrator.needsBackfill()) {
+        auto progress = std::make_shared<SchemaMigrator::BackfillProgress>();
+        DatabaseWorkerPool::getInstance().submit<bool>(0, [progress](DatabaseManager& db) {
+            SchemaMigrator backfillMigrator(db);
+            return backfillMigrator.startBackfill(*progress);
+        }).then(&app, [progress](bool ok) {
+            if (ok) {
+                continueBackfill(progress);
+            } else {
+                qWarning() << "Message backfill failed, staying in dual write mode";
+            }
+        }).onCanceled(&app, []() {
+            qWarning() << "Message backfill interrupted, staying in dual write mode";
+        });
+    }
+
+    // Okresowe zamykanie bezczynnych połączeń puli
+    QTimer poolReaper;
+    poolReaper.setInterval(qMax(1000, DatabaseManager::PoolConfig::instance.idleTimeout / 2));
+    QObject::connect(&poolReaper, &QTimer::timeout, []() {
+        ConnectionPool::getInstance().reapIdle();
+    });
+    poolReaper.start();
+
+    // Okresowy raport o wolnych klientach
+    QTimer sessionMetricsTimer;
+    sessionMetricsTimer.setInterval(60000);
+    QObject::connect(&sessionMetricsTimer, &QTimer::timeout, []() {
+        SessionMetrics::getInstance().log();
+        MessageBatcher::getInstance().log();
+        qInfo() << "Send dedup: duplicates" << SendDeduplicator::getInstance().duplicates()
+                << "keys" << SendDeduplicator::getInstance().size();
+        DeliveryTracker::getInstance().log();
+        RecentMessageCache::getInstance().log();
+        UserDirectory::getInstance().log();
+        if (MessageJournal::getInstance().isRunning()) {
+            MessageJournal::getInstance().log();
+        }
+    });
+    sessionMetricsTimer.start();
+
+    // Zbiorczy zapis zmian statusu do bazy
+    QTimer presenceFlushTimer;
+    presenceFlushTimer.setInterval(ServerConfig::instance.presenceFlushInterval);
+    QObject::connect(&presenceFlushTimer, &QTimer::timeout, []() {
+        if (PresenceRegistry::getInstance().pendingWrites() > 0) {
+            DatabaseWorkerPool::getInstance().submit<bool>(0, [](DatabaseManager& db) {
+                return PresenceRegistry::getInstance().flush(db);
+            });
+        }
+    });
+    presenceFlushTimer.start();
+
     Server server;
-    if (!server.start(1234)) {
+    if (!server.start(ServerConfig::instance.port)) {
         qCritical() << "Failed to start server";
+        MessageJournal::getInstance().stop();
+        MessageBatcher::getInstance().stop();
+        DatabaseWorkerPool::getInstance().stop();
         return 1;
     }
 
+    // Sesje muszą zostać zamknięte przed zatrzymaniem puli bazy danych
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &server, [&server, &dbManager]() {
+        server.stop();
+        MessageJournal::getInstance().stop();
+        MessageBatcher::getInstance().stop();
+        DatabaseWorkerPool::getInstance().stop();
+        // Statusy offline zamkniętych sesji
+        PresenceRegistry::getInstance().flush(dbManager);
+    });
+
     qInfo() << "Server started successfully";
-    qInfo() << "Listening on port 1234";
+    qInfo() << "Listening on port" << ServerConfig::instance.port;
     qInfo() << "Test users available:";
-    qInfo() << " - test1 (online)";
-    qInfo() << " - test2 (online)";
-    qInfo() << " - test3 (offline)";
+    qInfo() << " - test1";
+    qInfo() << " - test2";
+    qInfo() << " - test3";
     qInfo() << "Press Ctrl+C to quit";
 
     return app.exec();
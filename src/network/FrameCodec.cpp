@@ -0,0 +1,287 @@
+/**
+ * @file FrameCodec.cpp
+ * @brief Splitting the TCP stream into protocol frames
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "FrameCodec.h"
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QtEndian>
+#include <QHash>
+
+namespace {
+
+using namespace Protocol;
+
+// Kolejność wyznacza identyfikatory na łączu - nowe typy dopisujemy wyłącznie na końcu
+const QStringList WIRE_TYPES = {
+    MessageType::LOGIN,
+    MessageType::LOGIN_RESPONSE,
+    MessageType::REGISTER,
+    MessageType::REGISTER_RESPONSE,
+    MessageType::LOGOUT,
+    MessageType::LOGOUT_RESPONSE,
+    MessageType::GET_STATUS,
+    MessageType::STATUS_UPDATE,
+    MessageType::GET_FRIENDS_LIST,
+    MessageType::FRIENDS_LIST_RESPONSE,
+    MessageType::FRIENDS_STATUS_UPDATE,
+    MessageType::SEND_MESSAGE,
+    MessageType::MESSAGE_RESPONSE,
+    MessageType::MESSAGE_ACK,
+    MessageType::GET_MESSAGES,
+    MessageType::PENDING_MESSAGES,
+    MessageType::ERROR,
+    MessageType::PING,
+    MessageType::PONG,
+    MessageType::GET_CHAT_HISTORY,
+    MessageType::CHAT_HISTORY_RESPONSE,
+    MessageType::GET_MORE_HISTORY,
+    MessageType::MORE_HISTORY_RESPONSE,
+    MessageType::GET_LATEST_MESSAGES,
+    MessageType::LATEST_MESSAGES_RESPONSE,
+    MessageType::NEW_MESSAGES,
+    MessageType::MESSAGE_READ,
+    MessageType::UNREAD_FROM,
+    MessageType::MESSAGE_READ_RESPONSE,
+    MessageType::SEARCH_USERS,
+    MessageType::SEARCH_USERS_RESPONSE,
+    MessageType::REMOVE_FRIEND,
+    MessageType::REMOVE_FRIEND_RESPONSE,
+    MessageType::FRIEND_REMOVED,
+    MessageType::FRIEND_REQUEST_ACCEPTED_NOTIFICATION,
+    MessageType::ADD_FRIEND_REQUEST,
+    MessageType::ADD_FRIEND_RESPONSE,
+    MessageType::FRIEND_REQUEST_RECEIVED,
+    MessageType::FRIEND_REQUEST_ACCEPT,
+    MessageType::FRIEND_REQUEST_REJECT,
+    MessageType::FRIEND_REQUEST_ACCEPT_RESPONSE,
+    MessageType::FRIEND_REQUEST_REJECT_RESPONSE,
+    MessageType::GET_SENT_INVITATIONS,
+    MessageType::GET_RECEIVED_INVITATIONS,
+    MessageType::SENT_INVITATIONS_RESPONSE,
+    MessageType::RECEIVED_INVITATIONS_RESPONSE,
+    MessageType::CANCEL_FRIEND_REQUEST,
+    MessageType::CANCEL_FRIEND_REQUEST_RESPONSE,
+    MessageType::FRIEND_REQUEST_CANCELLED_NOTIFICATION,
+    MessageType::SEND_INVITATION,
+    MessageType::INVITATION_RESPONSE,
+    MessageType::INVITATION_ACCEPTED,
+    MessageType::INVITATION_REJECTED,
+    MessageType::INVITATION_CANCELLED,
+    MessageType::GET_INVITATIONS,
+    MessageType::INVITATIONS_LIST,
+    MessageType::INVITATION_ALREADY_EXISTS,
+    MessageType::INVITATION_STATUS_CHANGED,
+    MessageType::SET_FRAMING,
+    MessageType::SET_FRAMING_RESPONSE
+};
+
+const QHash<QString, quint16>& wireTypeIds()
+{
+    static const QHash<QString, quint16> ids = []() {
+        QHash<QString, quint16> result;
+        for (int i = 0; i < WIRE_TYPES.size(); ++i) {
+            result.insert(WIRE_TYPES[i], static_cast<quint16>(i + 1));
+        }
+        return result;
+    }();
+    return ids;
+}
+
+}
+
+FrameCodec::FrameCodec(int maxFrameSize)
+    : m_maxFrameSize(maxFrameSize)
+{
+}
+
+quint16 FrameCodec::typeId(const QString& type)
+{
+    return wireTypeIds().value(type, 0);
+}
+
+QString FrameCodec::typeName(quint16 typeId)
+{
+    if (typeId == 0 || typeId > WIRE_TYPES.size()) {
+        return QString();
+    }
+    return WIRE_TYPES[typeId - 1];
+}
+
+void FrameCodec::append(const QByteArray& data)
+{
+    m_buffer.append(data);
+}
+
+void FrameCodec::setMode(Mode mode)
+{
+    m_mode = mode;
+    m_scanPos = m_readPos;
+    m_frameStart = -1;
+    m_depth = 0;
+    m_inString = false;
+    m_escape = false;
+}
+
+FrameCodec::Result FrameCodec::next()
+{
+    return m_mode == Mode::Binary ? nextBinary() : nextJson();
+}
+
+FrameCodec::Result FrameCodec::nextJson()
+{
+    const int size = m_buffer.size();
+    const char* data = m_buffer.constData();
+
+    while (m_scanPos < size) {
+        const char c = data[m_scanPos++];
+
+        if (m_frameStart < 0) {
+            // Bajty przed początkiem obiektu (białe znaki, śmieci) są pomijane
+            if (c == '{') {
+                m_frameStart = m_scanPos - 1;
+                m_depth = 1;
+                m_inString = false;
+                m_escape = false;
+            } else {
+                m_readPos = m_scanPos;
+            }
+            continue;
+        }
+
+        if (m_inString) {
+            if (m_escape) {
+                m_escape = false;
+            } else if (c == '\\') {
+                m_escape = true;
+            } else if (c == '"') {
+                m_inString = false;
+            }
+        } else if (c == '"') {
+            m_inString = true;
+        } else if (c == '{') {
+            ++m_depth;
+        } else if (c == '}' && --m_depth == 0) {
+            QByteArray frame = m_buffer.mid(m_frameStart, m_scanPos - m_frameStart);
+            m_readPos = m_scanPos;
+            m_frameStart = -1;
+            compact();
+            return parseFrame(frame);
+        }
+
+        if (m_scanPos - m_frameStart > m_maxFrameSize) {
+            Result result;
+            result.status = Status::Error;
+            result.error = "Frame too large";
+            result.fatal = true;
+            return result;
+        }
+    }
+
+    compact();
+    return Result();
+}
+
+FrameCodec::Result FrameCodec::nextBinary()
+{
+    const int available = m_buffer.size() - m_readPos;
+    if (available < Protocol::Framing::HEADER_SIZE) {
+        return Result();
+    }
+
+    const uchar* header = reinterpret_cast<const uchar*>(m_buffer.constData() + m_readPos);
+    const quint32 length = qFromBigEndian<quint32>(header);
+    const quint16 type = qFromBigEndian<quint16>(header + 4);
+    const quint16 flags = qFromBigEndian<quint16>(header + 6);
+
+    if (length > static_cast<quint32>(m_maxFrameSize) || flags != 0) {
+        Result result;
+        result.status = Status::Error;
+        result.error = flags != 0 ? "Unsupported frame flags" : "Frame too large";
+        result.fatal = true;
+        return result;
+    }
+
+    if (available < Protocol::Framing::HEADER_SIZE + static_cast<int>(length)) {
+        return Result();
+    }
+
+    QByteArray payload = m_buffer.mid(m_readPos + Protocol::Framing::HEADER_SIZE, static_cast<int>(length));
+    m_readPos += Protocol::Framing::HEADER_SIZE + static_cast<int>(length);
+    compact();
+    return parseFrame(payload, type);
+}
+
+FrameCodec::Result FrameCodec::parseFrame(const QByteArray& payload, quint16 typeId) const
+{
+    Result result;
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(payload, &parseError);
+
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        result.status = Status::Error;
+        result.error = "Invalid JSON format";
+        return result;
+    }
+
+    result.status = Status::Frame;
+    result.message = doc.object();
+
+    // Typ z nagłówka uzupełnia ładunek, który go nie zawiera
+    if (typeId != 0 && !result.message.contains("type")) {
+        QString type = typeName(typeId);
+        if (type.isEmpty()) {
+            result.status = Status::Error;
+            result.error = "Unknown message type id";
+            result.message = QJsonObject();
+            return result;
+        }
+        result.message["type"] = type;
+    }
+    return result;
+}
+
+void FrameCodec::compact()
+{
+    // Usuwamy przetworzone bajty dopiero, gdy stanowią połowę bufora -
+    // koszt przesuwania danych rozkłada się na wiele ramek
+    if (m_readPos == 0 || (m_readPos < m_buffer.size() && m_readPos < m_buffer.size() / 2)) {
+        return;
+    }
+
+    m_buffer.remove(0, m_readPos);
+    m_scanPos -= m_readPos;
+    if (m_frameStart >= 0) {
+        m_frameStart -= m_readPos;
+    }
+    m_readPos = 0;
+}
+
+QByteArray FrameCodec::encode(const QJsonObject& message) const
+{
+    if (m_mode == Mode::Json) {
+        return QJsonDocument(message).toJson();
+    }
+    return encode(QJsonDocument(message).toJson(QJsonDocument::Compact),
+                  typeId(message["type"].toString()));
+}
+
+QByteArray FrameCodec::encode(const QByteArray& payload, quint16 typeId) const
+{
+    if (m_mode == Mode::Json) {
+        return payload;
+    }
+
+    QByteArray frame;
+    frame.reserve(Protocol::Framing::HEADER_SIZE + payload.size());
+    frame.resize(Protocol::Framing::HEADER_SIZE);
+    uchar* header = reinterpret_cast<uchar*>(frame.data());
+    qToBigEndian<quint32>(static_cast<quint32>(payload.size()), header);
+    qToBigEndian<quint16>(typeId, header + 4);
+    qToBigEndian<quint16>(0, header + 6);
+    frame.append(payload);
+    return frame;
+}
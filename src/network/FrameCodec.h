@@ -0,0 +1,80 @@
+/**
+ * @file FrameCodec.h
+ * @brief Splitting the TCP stream into protocol frames
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include "Protocol.h"
+
+// Dzieli strumień na ramki w jednym z dwóch trybów:
+//  - Json: kolejne obiekty JSON; granice wyznacza przyrostowy skaner nawiasów,
+//    który pomija nawiasy w łańcuchach i nie wraca do już przeskanowanych bajtów,
+//  - Binary: 8-bajtowy nagłówek (u32 długość ładunku BE, u16 id typu, u16 flagi)
+//    i ładunek JSON - granica ramki jest znana od razu po odczytaniu nagłówka.
+// Każda ramka jest parsowana dokładnie raz.
+class FrameCodec
+{
+public:
+    enum class Mode {
+        Json,
+        Binary
+    };
+
+    enum class Status {
+        Frame,       // message zawiera kolejną wiadomość
+        Incomplete,  // potrzeba więcej danych
+        Error        // ramka odrzucona; przy fatal strumienia nie da się kontynuować
+    };
+
+    struct Result {
+        Status status = Status::Incomplete;
+        QJsonObject message;
+        QString error;
+        bool fatal = false;
+    };
+
+    explicit FrameCodec(int maxFrameSize = Protocol::Framing::DEFAULT_MAX_FRAME_SIZE);
+
+    void append(const QByteArray& data);
+    Result next();
+
+    QByteArray encode(const QJsonObject& message) const;
+    // Ramkuje gotowy ładunek JSON (np. odpowiedź zbudowaną w innej sesji)
+    QByteArray encode(const QByteArray& payload, quint16 typeId = 0) const;
+
+    Mode mode() const { return m_mode; }
+    // Zmiana trybu obowiązuje od następnej ramki w buforze
+    void setMode(Mode mode);
+    int maxFrameSize() const { return m_maxFrameSize; }
+    void setMaxFrameSize(int maxFrameSize) { m_maxFrameSize = maxFrameSize; }
+    int bufferedBytes() const { return m_buffer.size() - m_readPos; }
+
+    // Stałe identyfikatory typów wiadomości dla nagłówka binarnego; 0 = typ w ładunku
+    static quint16 typeId(const QString& type);
+    static QString typeName(quint16 typeId);
+
+private:
+    Result nextJson();
+    Result nextBinary();
+    Result parseFrame(const QByteArray& payload, quint16 typeId = 0) const;
+    void compact();
+
+    Mode m_mode = Mode::Json;
+    int m_maxFrameSize;
+    QByteArray m_buffer;
+    int m_readPos = 0;      // początek nieprzetworzonych danych
+    int m_scanPos = 0;      // tryb Json: miejsce wznowienia skanowania
+    int m_frameStart = -1;  // tryb Json: początek bieżącego obiektu
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escape = false;
+};
+
+#endif // FRAMECODEC_H
@@ -20,12 +20,23 @@ QJsonObject createLoginRequest(const QString& username, const QString& password)
     };
 }
 
-QJsonObject createNewMessage(const QString& content, int from, qint64 timestamp) {
+QJsonObject createResumeRequest(const QString& token) {
+    return QJsonObject{
+        {"type", MessageType::RESUME},
+        {"token", token},
+        {"protocol_version", PROTOCOL_VERSION}
+    };
+}
+
+QJsonObject createNewMessage(const QString& content, int from, qint64 timestamp, quint64 messageId) {
     QJsonObject message;
     message["type"] = MessageType::NEW_MESSAGES;
     message["content"] = content;
     message["from"] = from;
     message["timestamp"] = timestamp;
+    if (messageId != 0) {
+        message["message_id"] = QString::number(messageId);
+    }
     return message;
 }
 
@@ -54,13 +65,17 @@ QJsonObject createLogoutRequest() {
     };
 }
 
-QJsonObject createMessage(int receiverId, const QString& content) {
-    return QJsonObject{
+QJsonObject createMessage(int receiverId, const QString& content, const QString& clientMessageId) {
+    QJsonObject message{
         {"type", MessageType::SEND_MESSAGE},
         {"receiver_id", receiverId},
         {"content", content},
         {"timestamp", QDateTime::currentMSecsSinceEpoch()}
     };
+    if (!clientMessageId.isEmpty()) {
+        message[Deduplication::KEY] = clientMessageId;
+    }
+    return message;
 }
 
 // Ping/Pong operations
@@ -94,6 +109,21 @@ QJsonObject createMessageAck(const QString& messageId) {
     };
 }
 
+QJsonObject createMessageAck(quint64 messageId, const QString& clientMessageId) {
+    QJsonObject message = createMessageAck(QString::number(messageId));
+    if (!clientMessageId.isEmpty()) {
+        message[Deduplication::KEY] = clientMessageId;
+    }
+    return message;
+}
+
+QJsonObject createDeliveryAck(quint64 sequence) {
+    return QJsonObject{
+        {"type", MessageType::MESSAGE_ACK},
+        {"seq", static_cast<qint64>(sequence)}
+    };
+}
+
 // Status operations
 QJsonObject createStatusUpdate(const QString& status) {
     return QJsonObject{
@@ -119,6 +149,15 @@ QJsonObject createFriendsStatusUpdate(const QJsonArray& friends) {
     };
 }
 
+QJsonObject createFriendStatusChanged(quint32 friendId, const QString& status) {
+    return QJsonObject{
+        {"type", MessageType::FRIEND_STATUS_CHANGED},
+        {"friend_id", static_cast<int>(friendId)},
+        {"status", status},
+        {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+    };
+}
+
 QJsonObject createMessageReadResponse() {
     return QJsonObject{
         {"type", MessageType::MESSAGE_READ_RESPONSE},
@@ -338,5 +377,23 @@ QJsonObject createFriendRequestCancelledNotification(int requestId, int fromUser
     };
 }
 
+QJsonObject createSetFramingRequest(const QString& mode) {
+    return QJsonObject{
+        {"type", MessageType::SET_FRAMING},
+        {"mode", mode},
+        {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+    };
+}
+
+QJsonObject createSetFramingResponse(bool success, const QString& mode, int maxFrameSize) {
+    return QJsonObject{
+        {"type", MessageType::SET_FRAMING_RESPONSE},
+        {"status", success ? "success" : "error"},
+        {"mode", mode},
+        {"max_frame_size", maxFrameSize},
+        {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+    };
+}
+
 } // namespace MessageStructure
 } // namespace Protocol
@@ -30,8 +30,10 @@ constexpr int STATUS_UPDATE = 15000; // 15 sekund
 
 // Typy wiadomości
 namespace MessageType {
-const QString LOGIN = "login";
+const QString LOGIN = "login";                      // "bootstrap": true - znajomi i nieprzeczytane w login_response
 const QString LOGIN_RESPONSE = "login_response";
+const QString RESUME = "resume";                    // Wznowienie sesji tokenem z login_response
+const QString RESUME_RESPONSE = "resume_response";
 const QString REGISTER = "register";
 const QString REGISTER_RESPONSE = "register_response";
 const QString LOGOUT = "logout";
@@ -41,6 +43,7 @@ const QString STATUS_UPDATE = "status_response";
 const QString GET_FRIENDS_LIST = "get_friends_list";
 const QString FRIENDS_LIST_RESPONSE = "friends_list_response";
 const QString FRIENDS_STATUS_UPDATE = "friends_status_update";
+const QString FRIEND_STATUS_CHANGED = "friend_status_changed";
 const QString SEND_MESSAGE = "send_message";
 const QString MESSAGE_RESPONSE = "message_response";
 const QString MESSAGE_ACK = "message_ack";
@@ -56,6 +59,8 @@ const QString MORE_HISTORY_RESPONSE = "more_history_response";
 const QString GET_LATEST_MESSAGES = "get_latest_messages";
 const QString LATEST_MESSAGES_RESPONSE = "latest_messages_response";
 const QString NEW_MESSAGES = "new_messages";
+const QString SYNC = "sync";                        // Zmiany od ostatniego połączenia
+const QString SYNC_RESPONSE = "sync_response";
 const QString MESSAGE_READ = "message_read";
 const QString UNREAD_FROM = "unread_from";
 const QString MESSAGE_READ_RESPONSE = "message_read_response";
@@ -92,6 +97,18 @@ const QString GET_INVITATIONS = "get_invitations";
 const QString INVITATIONS_LIST = "invitations_list";
 const QString INVITATION_ALREADY_EXISTS = "invitation_already_exists";
 const QString INVITATION_STATUS_CHANGED = "invitation_status_changed";
+
+// Negocjacja ramkowania
+const QString SET_FRAMING = "set_framing";
+const QString SET_FRAMING_RESPONSE = "set_framing_response";
+}
+
+// Tryby ramkowania strumienia TCP
+namespace Framing {
+const QString JSON = "json";      // kolejne obiekty JSON bez separatora (domyślny)
+const QString BINARY = "binary";  // nagłówek: u32 długość (BE), u16 id typu, u16 flagi
+constexpr int HEADER_SIZE = 8;
+constexpr int DEFAULT_MAX_FRAME_SIZE = 1024 * 1024;
 }
 
 // Status użytkownika
@@ -116,7 +133,9 @@ const QStringList INITIAL = {
     MessageType::PING,
     MessageType::PONG,
     MessageType::LOGIN,
-    MessageType::REGISTER
+    MessageType::RESUME,
+    MessageType::REGISTER,
+    MessageType::SET_FRAMING
 };
 
 const QStringList AUTHENTICATING = {
@@ -137,6 +156,7 @@ const QStringList AUTHENTICATED = {
     MessageType::MESSAGE_ACK,
     MessageType::GET_CHAT_HISTORY,
     MessageType::GET_MORE_HISTORY,
+    MessageType::SYNC,
     MessageType::NEW_MESSAGES,
     MessageType::REMOVE_FRIEND,
     MessageType::REMOVE_FRIEND_RESPONSE,
@@ -163,7 +183,8 @@ const QStringList AUTHENTICATED = {
     MessageType::GET_INVITATIONS,
     MessageType::INVITATIONS_LIST,
     MessageType::INVITATION_ALREADY_EXISTS,
-    MessageType::INVITATION_STATUS_CHANGED
+    MessageType::INVITATION_STATUS_CHANGED,
+    MessageType::SET_FRAMING
 };
 
 const QStringList DISCONNECTING = {
@@ -179,10 +200,15 @@ namespace MessageStructure {
 QJsonObject createLoginRequest(const QString& username, const QString& password);
 QJsonObject createRegisterRequest(const QString& username, const QString& password, const QString& email);
 QJsonObject createLogoutRequest();
+QJsonObject createResumeRequest(const QString& token);
 
 // Wiadomości i statusy
-QJsonObject createMessage(int receiverId, const QString& content);
+QJsonObject createMessage(int receiverId, const QString& content, const QString& clientMessageId = QString());
 QJsonObject createMessageAck(const QString& messageId);
+// Identyfikator wiadomości jako tekst - 64 bity nie mieszczą się w liczbie JSON
+QJsonObject createMessageAck(quint64 messageId, const QString& clientMessageId = QString());
+// Od klienta: potwierdza wszystkie wiadomości new_messages do numeru "seq" włącznie
+QJsonObject createDeliveryAck(quint64 sequence);
 QJsonObject createStatusUpdate(const QString& status);
 QJsonObject createMessageRead(int friendId);
 QJsonObject createMessageReadResponse();
@@ -197,12 +223,13 @@ QJsonObject createError(const QString& message);
 // Lista znajomych
 QJsonObject createGetFriendsList();
 QJsonObject createFriendsStatusUpdate(const QJsonArray& friends);
+QJsonObject createFriendStatusChanged(quint32 friendId, const QString& status);
 QJsonObject createRemoveFriendRequest(int friendId);
 QJsonObject createRemoveFriendResponse(bool success);
 QJsonObject createFriendRemovedNotification(int friendId);
 
 // Wiadomości czatu
-QJsonObject createNewMessage(const QString& content, int from, qint64 timestamp);
+QJsonObject createNewMessage(const QString& content, int from, qint64 timestamp, quint64 messageId = 0);
 
 // Wyszukiwanie użytkowników
 QJsonObject createSearchUsersRequest(const QString& query);
@@ -230,11 +257,38 @@ QJsonObject createInvitationResponse(bool success, const QString& message = "");
 QJsonObject createInvitationsList(const QJsonArray& invitations, bool sent = true);
 QJsonObject createInvitationAlreadyExistsResponse(int userId, const QString& username);
 QJsonObject createInvitationStatusChangedNotification(int requestId, int userId, const QString& status);
+
+// Ramkowanie
+QJsonObject createSetFramingRequest(const QString& mode);
+QJsonObject createSetFramingResponse(bool success, const QString& mode, int maxFrameSize);
 }
 
 // Historia czatu
 namespace ChatHistory {
 const int MESSAGE_BATCH_SIZE = 20;  // ilość wiadomości w jednej paczce
+const int MAX_PAGE_SIZE = 100;      // górna granica "limit" w trybie kursorowym
+}
+
+// Ograniczenia jednej odpowiedzi sync; rozmowy, które się nie zmieściły,
+// mają has_more i klient ponawia sync od next_after_id
+namespace Sync {
+const int MAX_CONVERSATIONS = 100;  // rozmowy brane z jednego żądania
+const int MAX_MESSAGES = 500;       // wiadomości łącznie we wszystkich rozmowach
+}
+
+// search_users: opcjonalne "prefix": true zawęża wyniki do nazw zaczynających się od query
+namespace UserSearch {
+const int MAX_RESULTS = 20;
+// Kandydaci zapamiętywani przez sesję; kolejne znaki zapytania filtrują ich
+// bez ponownego przeszukiwania indeksu, o ile lista była pełna
+const int MAX_CANDIDATES = 200;
+}
+
+// Opcjonalny klucz idempotencji send_message; ponowienie z tym samym kluczem
+// dostaje pierwotne potwierdzenie zamiast drugiego zapisu
+namespace Deduplication {
+const QString KEY = "client_message_id";
+constexpr int MAX_KEY_LENGTH = 64;
 }
 
 // Walidacja wiadomości
@@ -274,6 +328,7 @@ constexpr int MIN_USERNAME_LENGTH = 3;
 constexpr int MAX_USERNAME_LENGTH = 32;
 constexpr int MIN_PASSWORD_LENGTH = 8;
 constexpr int MAX_PASSWORD_LENGTH = 64;
+constexpr int MAX_MESSAGE_BYTES = 65535;  // kolumna TEXT, treść w UTF-8
 }
 
 } // namespace Protocol
@@ -3,8 +3,15 @@
 #define ACTIVESESSIONS_H
 
 #include <QMap>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+#include <functional>
 #include "ClientSession.h"
 
+// Rejestr zalogowanych sesji współdzielony przez wszystkie wątki workerów.
+// Sesje innych użytkowników mogą żyć w innym wątku, dlatego nie wolno
+// wywoływać ich metod bezpośrednio - służą do tego post() i deliver().
 class ActiveSessions {
 public:
     static ActiveSessions& getInstance() {
@@ -13,20 +20,66 @@ public:
     }
 
     void addSession(quint32 userId, ClientSession* session) {
+        QMutexLocker locker(&mutex);
         sessions[userId] = session;
     }
 
     void removeSession(quint32 userId) {
+        QMutexLocker locker(&mutex);
         sessions.remove(userId);
     }
 
-    ClientSession* getSession(quint32 userId) {
-        return sessions.value(userId, nullptr);
+    // Zwraca false, gdy użytkownik jest już zarejestrowany z inną sesją
+    bool removeSession(quint32 userId, ClientSession* session) {
+        QMutexLocker locker(&mutex);
+        if (sessions.value(userId) == session) {
+            sessions.remove(userId);
+            return true;
+        }
+        return false;
+    }
+
+    bool isOnline(quint32 userId) {
+        QMutexLocker locker(&mutex);
+        return !sessions.value(userId).isNull();
+    }
+
+    // Uruchamia zadanie w wątku sesji użytkownika. W tym samym wątku wywołanie
+    // jest synchroniczne, w innym - kolejkowane do pętli zdarzeń sesji.
+    bool post(quint32 userId, const std::function<void(ClientSession*)>& task) {
+        QMutexLocker locker(&mutex);
+        QPointer<ClientSession> session = sessions.value(userId);
+        if (!session) {
+            return false;
+        }
+
+        if (session->thread() == QThread::currentThread()) {
+            locker.unlock();
+            task(session);
+            return true;
+        }
+
+        // Blokada jest trzymana do momentu zakolejkowania zdarzenia, więc sesja
+        // nie może zostać zniszczona w trakcie (destruktor wywołuje removeSession)
+        QMetaObject::invokeMethod(session, [session, task]() {
+            if (session) {
+                task(session);
+            }
+        }, Qt::QueuedConnection);
+        return true;
+    }
+
+    bool deliver(quint32 userId, const QByteArray& response,
+                 OutputClass outputClass = OutputClass::Message, const QString& key = QString()) {
+        return post(userId, [response, outputClass, key](ClientSession* session) {
+            session->deliver(response, outputClass, key);
+        });
     }
 
 private:
     ActiveSessions() {} // prywatny konstruktor dla Singleton
-    QMap<quint32, ClientSession*> sessions;
+    QMutex mutex;
+    QMap<quint32, QPointer<ClientSession>> sessions;
 };
 
 #endif
@@ -7,16 +7,81 @@
 
 #include "ClientSession.h"
 #include "database/DatabaseManager.h"
+#include "database/DatabaseWorkerPool.h"
+#include "database/MessageBatcher.h"
+#include "database/MessageJournal.h"
 #include "network/Protocol.h"
 #include "ActiveSessions.h"
+#include "ServerConfig.h"
+#include "SessionMetrics.h"
+#include "NotificationService.h"
+#include "PresenceRegistry.h"
+#include "MessageIdGenerator.h"
+#include "SendDeduplicator.h"
+#include "DeliveryTracker.h"
+#include "ResumeTokens.h"
+#include "database/SyncVersions.h"
+#include "database/FriendGraph.h"
+#include "database/UsernameIndex.h"
 #include <QDebug>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QUuid>
 #include <QDateTime>
+#include <QSet>
 #include <QThread>
 
+namespace {
+
+// Wyniki zadań bazodanowych zwracających więcej niż jedną wartość
+struct HistoryResult {
+    QVector<ChatMessage> messages;
+    bool hasMore = false;
+};
+
+struct FriendRequestResult {
+    bool success = false;
+    QString targetUsername;
+};
+
+// Wszystko, czego potrzebuje logowanie - jedno zadanie w wątku bazy
+struct LoginResult {
+    quint32 userId = 0;
+    QVector<QPair<quint32, QString>> friends;
+    QVector<QPair<quint32, int>> unread;
+};
+
+struct SyncConversation {
+    quint32 friendId = 0;
+    qint64 afterId = 0;
+    QVector<ChatMessage> messages;
+    bool hasMore = false;
+    bool cursorsChanged = false;
+    qint64 readId = 0;
+    qint64 partnerReadId = 0;
+};
+
+struct SyncResult {
+    QVector<SyncConversation> conversations;
+    QVector<QPair<quint32, int>> unread;  // rozmowy spoza żądania
+    bool fullFriends = false;
+    QJsonArray friends;
+    QVector<quint32> presenceChanged;
+};
+
+struct CancelRequestResult {
+    bool success = false;
+    quint32 targetUserId = 0;
+};
+
+struct AcceptRequestResult {
+    bool success = false;
+    quint32 inviterId = 0;
+    QString username;
+};
+
+}
+
 ClientSession::ClientSession(QTcpSocket* socket, DatabaseManager* dbManager, QObject *parent)
     : QObject(parent)
     , socket(socket)
@@ -24,65 +89,49 @@ ClientSession::ClientSession(QTcpSocket* socket, DatabaseManager* dbManager, QOb
     , userId(0)
     , isAuthenticated(false)
     , state(Protocol::SessionState::INITIAL)
-    , lastPingTime(QDateTime::currentMSecsSinceEpoch())
+    , wheel(TimingWheel::local())
+    , lastActivity(QDateTime::currentMSecsSinceEpoch())
     , missedPings(0)
     , lastSentMessageId(0)
+    , corkDepth(0)
+    , flushScheduled(false)
+    , throttled(false)
+    , socketFrames(0)
 {
     qDebug() << "ClientSession constructor called";
 
-    sessionConnectionName = QString("Session_%1").arg(
-        reinterpret_cast<quintptr>(this),
-        0, 16);
-
-    qDebug() << "Creating new database connection:" << sessionConnectionName;
-
-    if (!dbManager->cloneConnection(sessionConnectionName)) {
-        qWarning() << "Failed to create database connection for session:"
-                   << sessionConnectionName;
-    } else {
-        qDebug() << "Successfully created database connection for session:"
-                 << sessionConnectionName;
-    }
+    codec.setMaxFrameSize(ServerConfig::instance.maxFrameSize);
 
     connect(socket, &QTcpSocket::readyRead,
             this, &ClientSession::handleReadyRead);
     connect(socket, &QTcpSocket::errorOccurred,
             this, &ClientSession::handleError);
+    connect(socket, &QTcpSocket::bytesWritten,
+            this, &ClientSession::handleBytesWritten);
 
-    statusUpdateTimer.setInterval(Protocol::Timeouts::STATUS_UPDATE);
-    connect(&statusUpdateTimer, &QTimer::timeout,
-            this, &ClientSession::sendFriendsStatusUpdate);
-
-    pingTimer.setInterval(Protocol::Timeouts::PING);
-    connect(&pingTimer, &QTimer::timeout,
-            this, &ClientSession::checkConnectionStatus);
-    pingTimer.start();
+    scheduleLivenessCheck(Protocol::Timeouts::PING);
 
     qDebug() << "New client session created";
 }
 
 ClientSession::~ClientSession()
 {
-    if (userId > 0) {
-        ActiveSessions::getInstance().removeSession(userId);
+    // Rozłączenie bez wylogowania - znajomi dostają status offline, chyba że
+    // użytkownik zdążył już zalogować się w nowej sesji
+    if (userId > 0 && ActiveSessions::getInstance().removeSession(userId, this) && isAuthenticated) {
+        NotificationService::getInstance().publishStatus(userId, Protocol::UserStatus::OFFLINE, dbManager);
+        // Niepotwierdzone wiadomości czekają na ponowne połączenie
+        DeliveryTracker::getInstance().detach(userId);
     }
 
-    qDebug() << "ClientSession destructor called";
-
-    if (QSqlDatabase::contains(sessionConnectionName)) {
-        qDebug() << "Closing database connection:" << sessionConnectionName;
-        {
-            QSqlDatabase db = QSqlDatabase::database(sessionConnectionName);
-            if (db.isOpen()) {
-                db.close();
-            }
-        }
-        QSqlDatabase::removeDatabase(sessionConnectionName);
+    if (throttled) {
+        SessionMetrics::getInstance().sessionReleased(reinterpret_cast<quintptr>(this));
     }
 
-    statusUpdateTimer.stop();
-    messagesCheckTimer.stop();
-    pingTimer.stop();
+    qDebug() << "ClientSession destructor called";
+
+    cancelTimer(livenessTimer);
+    cancelTimer(graceTimer);
 
     if (socket) {
         socket->disconnectFromHost();
@@ -93,6 +142,50 @@ ClientSession::~ClientSession()
     qDebug() << "Client session destroyed";
 }
 
+template<typename R>
+void ClientSession::runQuery(std::function<R(DatabaseManager&)> query,
+                             std::function<void(R)> handler,
+                             std::function<void()> onFailure)
+{
+    DatabaseWorkerPool& pool = DatabaseWorkerPool::getInstance();
+    if (pool.isRunning()) {
+        QFuture<R> future = pool.submit<R>(reinterpret_cast<quintptr>(this), std::move(query));
+        future.then(this, [handler](R result) {
+            if (handler) {
+                handler(result);
+            }
+        }).onCanceled(this, [this, onFailure]() {
+            queryFailed(onFailure);
+        });
+        return;
+    }
+
+    // Tryb synchroniczny (np. testy) - zapytanie na połączeniu przekazanego managera
+    if (!dbManager) {
+        qWarning() << "No database available for session";
+        queryFailed(onFailure);
+        return;
+    }
+
+    R result = query(*dbManager);
+    if (handler) {
+        handler(result);
+    }
+}
+
+void ClientSession::queryFailed(const std::function<void()>& onFailure)
+{
+    qWarning() << "Database request failed for user" << userId;
+    if (onFailure) {
+        onFailure();
+    }
+    // Logowanie przerwane - klient może spróbować ponownie
+    if (state == Protocol::SessionState::AUTHENTICATING) {
+        state = Protocol::SessionState::INITIAL;
+    }
+    sendResponse(Protocol::MessageStructure::createError("Database unavailable"));
+}
+
 void ClientSession::handleReadyRead()
 {
     qDebug() << "SERVER: handleReadyRead called, bytes available:"
@@ -104,11 +197,13 @@ void ClientSession::handleReadyRead()
     }
 
     QByteArray newData = socket->readAll();
+    lastActivity = QDateTime::currentMSecsSinceEpoch();
+    missedPings = 0;
     qDebug() << "SERVER: Read" << newData.size() << "bytes:"
              << QString::fromUtf8(newData);
 
-    buffer.append(newData);
-    qDebug() << "SERVER: Buffer size after append:" << buffer.size();
+    codec.append(newData);
+    qDebug() << "SERVER: Buffer size after append:" << codec.bufferedBytes();
 
     processBuffer();
 }
@@ -131,27 +226,10 @@ void ClientSession::handleError(QAbstractSocket::SocketError socketError)
     default:
         qDebug() << "Unknown socket error occurred";
     }
-
-    if (isAuthenticated && userId > 0) {
-        dbManager->updateUserStatus(userId, "offline");
-    }
 }
 
-void ClientSession::processMessage(const QByteArray& message)
+void ClientSession::processMessage(const QJsonObject& json)
 {
-    qDebug() << "SERVER: Received message of size:" << message.size();
-
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(message, &parseError);
-
-    if (parseError.error != QJsonParseError::NoError) {
-        qWarning() << "SERVER: Failed to parse message:" << parseError.errorString();
-        qWarning() << "SERVER: Raw message:" << message;
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Invalid JSON format")).toJson());
-        return;
-    }
-
-    QJsonObject json = doc.object();
     QString type = json["type"].toString();
 
     qDebug() << "SERVER: Received message type:" << type;
@@ -162,19 +240,20 @@ void ClientSession::processMessage(const QByteArray& message)
         return;
     }
     else if (type == Protocol::MessageType::PONG) {
-        lastPingTime = QDateTime::currentMSecsSinceEpoch();
-        missedPings = 0;
-        return;
+        return;  // lastActivity zostało odświeżone przy odczycie
     }
 
     if (!isAuthenticated && !Protocol::AllowedMessages::INITIAL.contains(type)) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Not authenticated")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Not authenticated"));
         return;
     }
 
     if (type == Protocol::MessageType::LOGIN) {
         handleLogin(json);
     }
+    else if (type == Protocol::MessageType::RESUME) {
+        handleResume(json);
+    }
     else if (type == Protocol::MessageType::REGISTER) {
         handleRegister(json);
     }
@@ -202,12 +281,18 @@ void ClientSession::processMessage(const QByteArray& message)
     else if (type == Protocol::MessageType::GET_MORE_HISTORY) {
         handleGetMoreHistory(json);
     }
+    else if (type == Protocol::MessageType::SYNC) {
+        handleSync(json);
+    }
     else if (type == Protocol::MessageType::SEND_MESSAGE) {
         handleSendMessage(json);
     }
     else if (type == Protocol::MessageType::MESSAGE_READ) {
         handleMessageRead(json);
     }
+    else if (type == Protocol::MessageType::MESSAGE_ACK) {
+        handleMessageAck(json);
+    }
     else if (type == Protocol::MessageType::ADD_FRIEND_REQUEST) {
         handleAddFriendRequest(json);
     }
@@ -229,9 +314,12 @@ void ClientSession::processMessage(const QByteArray& message)
     else if (type == Protocol::MessageType::LOGOUT) {
         handleLogout();
     }
+    else if (type == Protocol::MessageType::SET_FRAMING) {
+        handleSetFraming(json);
+    }
     else {
         qWarning() << "Unknown message type:" << type;
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Unknown message type")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Unknown message type"));
     }
 }
 
@@ -242,52 +330,153 @@ void ClientSession::handleLogin(const QJsonObject& json)
 
     qDebug() << "SERVER: Processing login request for user:" << username;
 
+    // Jak przy wznowieniu - drugie logowanie na tym samym połączeniu zostawiłoby
+    // poprzedniego użytkownika w ActiveSessions; stan sesji zostaje bez zmian
+    if (isAuthenticated || state == Protocol::SessionState::AUTHENTICATING) {
+        sendResponse(Protocol::MessageStructure::createError("Session already authenticated"));
+        return;
+    }
+
     if (username.isEmpty() || password.isEmpty()) {
         state = Protocol::SessionState::INITIAL;
         QJsonObject errorResponse = Protocol::MessageStructure::createError("Invalid credentials");
-        sendResponse(QJsonDocument(errorResponse).toJson());
+        sendResponse(errorResponse);
         return;
     }
 
-    QSqlDatabase sessionDb = QSqlDatabase::database(sessionConnectionName);
-    if (!sessionDb.isOpen()) {
-        qWarning() << "Session database connection is not open! Attempting to reopen...";
-        if (!dbManager->cloneConnection(sessionConnectionName)) {
-            QJsonObject errorResponse = Protocol::MessageStructure::createError("Database connection error");
-            sendResponse(QJsonDocument(errorResponse).toJson());
-            return;
+    state = Protocol::SessionState::AUTHENTICATING;
+    bool bootstrap = json["bootstrap"].toBool();
+
+    // Hasło, znajomi i liczniki nieprzeczytanych w jednym zadaniu; lista
+    // znajomych jest czytana raz i służy też do liczników
+    runQuery<LoginResult>([username, password](DatabaseManager& db) {
+        LoginResult result;
+        if (!db.verifyCredentials(username, password, result.userId)) {
+            result.userId = 0;
+            return result;
         }
-    }
+        result.friends = db.getFriendsList(result.userId);
+        result.unread = db.getUnreadCounts(result.userId, result.friends);
+        return result;
+    }, [this, username, bootstrap](LoginResult result) {
+        if (result.userId > 0) {
+            // Wszystkie ramki logowania wychodzą jednym zapisem
+            OutputCork cork(this);
+            DeliveryTracker::Resume delivery = beginSession(result.userId);
+            qint64 tokenExpiresAt = 0;
+            QString token = ResumeTokens::getInstance().issue(userId, delivery.epoch, &tokenExpiresAt);
+
+            // Najpierw wyślij odpowiedź o udanym logowaniu
+            QJsonObject response{
+                {"type", Protocol::MessageType::LOGIN_RESPONSE},
+                {"status", "success"},
+                {"userId", static_cast<int>(userId)},
+                {"delivery_epoch", delivery.epoch},
+                {"delivery_acked", static_cast<qint64>(delivery.acked)},
+                {"resume_token", token},
+                {"resume_expires_at", tokenExpiresAt},
+                {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+            };
+
+            // Klient z "bootstrap" dostaje znajomych i nieprzeczytane w tej samej ramce
+            QJsonArray friendsArray = friendsToJson(result.friends);
+            QJsonArray unreadArray = unreadToJson(result.unread);
+            if (bootstrap) {
+                response["friends"] = friendsArray;
+                response["unread"] = unreadArray;
+            }
+
+            qDebug() << "SERVER: Sending login success response for user:" << username;
+            sendResponse(response);
+
+            if (!bootstrap) {
+                sendResponse(QJsonObject{
+                    {"type", Protocol::MessageType::UNREAD_FROM},
+                    {"users", unreadArray}
+                });
+                sendResponse(QJsonObject{
+                    {"type", Protocol::MessageType::FRIENDS_LIST_RESPONSE},
+                    {"friends", friendsArray},
+                    {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+                });
+            }
+
+            // Wiadomości niepotwierdzone w poprzedniej sesji, z tymi samymi numerami
+            for (const QByteArray& payload : delivery.pending) {
+                deliver(payload, OutputClass::Message);
+            }
+
+            NotificationService::getInstance().publishStatus(userId, Protocol::UserStatus::ONLINE, dbManager);
 
-    if (dbManager->authenticateUser(username, password, userId)) {
-        setUserId(userId);
-        state = Protocol::SessionState::AUTHENTICATED;
-        isAuthenticated = true;
+            qDebug() << "SERVER: User" << username << "logged in successfully";
+        } else {
+            state = Protocol::SessionState::INITIAL;
+            QJsonObject errorResponse = Protocol::MessageStructure::createError("Authentication failed");
+            sendResponse(errorResponse);
+            qDebug() << "SERVER: Failed login attempt for user:" << username;
+        }
+    });
+}
 
-        // Najpierw wyślij odpowiedź o udanym logowaniu
+void ClientSession::handleResume(const QJsonObject& json)
+{
+    auto reject = [this](const QString& message) {
         QJsonObject response{
-            {"type", Protocol::MessageType::LOGIN_RESPONSE},
-            {"status", "success"},
-            {"userId", static_cast<int>(userId)},
+            {"type", Protocol::MessageType::RESUME_RESPONSE},
+            {"status", "error"},
+            {"message", message},
             {"timestamp", QDateTime::currentMSecsSinceEpoch()}
         };
+        sendResponse(response);
+    };
+
+    // Połączenie ma już tożsamość (albo logowanie w toku) - wznowienie jako inny
+    // użytkownik zostawiłoby poprzedniego w ActiveSessions z tym połączeniem
+    if (isAuthenticated || state == Protocol::SessionState::AUTHENTICATING) {
+        reject("Session already authenticated");
+        return;
+    }
+
+    // Token jest sprawdzany w pamięci - bez hasła i bez zapytania do bazy
+    ResumeTokens::Claims claims;
+    if (!ResumeTokens::getInstance().validate(json["token"].toString(), claims)) {
+        reject("Invalid or expired resume token");
+        return;
+    }
+
+    OutputCork cork(this);
+    DeliveryTracker::Resume delivery = beginSession(claims.userId);
+    qint64 tokenExpiresAt = 0;
+    QString token = ResumeTokens::getInstance().issue(userId, delivery.epoch, &tokenExpiresAt);
+
+    // Inna epoka - okno doręczeń wygasło, klient nie wie, co przegapił
+    bool windowLost = delivery.epoch != claims.deliveryEpoch;
 
-        qDebug() << "SERVER: Sending login success response for user:" << username;
-        sendResponse(QJsonDocument(response).toJson());
+    QJsonObject response{
+        {"type", Protocol::MessageType::RESUME_RESPONSE},
+        {"status", "success"},
+        {"userId", static_cast<int>(userId)},
+        {"delivery_epoch", delivery.epoch},
+        {"delivery_acked", static_cast<qint64>(delivery.acked)},
+        {"window_lost", windowLost},
+        {"resume_token", token},
+        {"resume_expires_at", tokenExpiresAt},
+        {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+    };
+    sendResponse(response);
+
+    for (const QByteArray& payload : delivery.pending) {
+        deliver(payload, OutputClass::Message);
+    }
 
-        // Następnie aktualizuj status i wykonaj pozostałe operacje
-        dbManager->updateUserStatus(userId, "online");
-        statusUpdateTimer.start();
+    NotificationService::getInstance().publishStatus(userId, Protocol::UserStatus::ONLINE, dbManager);
+    // Pełny bootstrap tylko wtedy, gdy okno nie zachowało brakujących wiadomości
+    if (windowLost) {
         sendUnreadFromUsers();
         handleFriendsListRequest();
-
-        qDebug() << "SERVER: User" << username << "logged in successfully";
-    } else {
-        state = Protocol::SessionState::INITIAL;
-        QJsonObject errorResponse = Protocol::MessageStructure::createError("Authentication failed");
-        sendResponse(QJsonDocument(errorResponse).toJson());
-        qDebug() << "SERVER: Failed login attempt for user:" << username;
     }
+
+    qDebug() << "SERVER: User" << userId << "resumed session" << (windowLost ? "(window lost)" : "");
 }
 
 void ClientSession::handleRegister(const QJsonObject& json)
@@ -297,47 +486,54 @@ void ClientSession::handleRegister(const QJsonObject& json)
     QString email = json["email"].toString();
 
     if (username.isEmpty() || password.isEmpty() || email.isEmpty()) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Invalid registration data")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Invalid registration data"));
         return;
     }
 
     if (password.length() < Protocol::Validation::MIN_PASSWORD_LENGTH) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError(
-                                       QString("Password must be at least %1 characters long").arg(Protocol::Validation::MIN_PASSWORD_LENGTH))).toJson());
+        sendResponse(Protocol::MessageStructure::createError(
+            QString("Password must be at least %1 characters long").arg(Protocol::Validation::MIN_PASSWORD_LENGTH)));
         return;
     }
 
 
-    if (dbManager->registerUser(username, password, email)) {
-        QJsonObject response{
-            {"type", Protocol::MessageType::REGISTER_RESPONSE},
-            {"status", "success"},
-            {"message", "Registration successful"},
-            {"timestamp", QDateTime::currentMSecsSinceEpoch()}
-        };
-        sendResponse(QJsonDocument(response).toJson());
-        qDebug() << "New user registered:" << username;
-    } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Registration failed")).toJson());
-        qDebug() << "Failed registration attempt for username:" << username;
-    }
+    runQuery<bool>([username, password, email](DatabaseManager& db) {
+        return db.registerUser(username, password, email);
+    }, [this, username](bool registered) {
+        if (registered) {
+            QJsonObject response{
+                {"type", Protocol::MessageType::REGISTER_RESPONSE},
+                {"status", "success"},
+                {"message", "Registration successful"},
+                {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+            };
+            sendResponse(response);
+            qDebug() << "New user registered:" << username;
+        } else {
+            sendResponse(Protocol::MessageStructure::createError("Registration failed"));
+            qDebug() << "Failed registration attempt for username:" << username;
+        }
+    });
 }
 
 void ClientSession::handleLogout()
 {
     if (isAuthenticated && userId > 0) {
-        dbManager->updateUserStatus(userId, "offline");
+        // Nowsza sesja tego użytkownika zachowuje status, okno doręczeń i token
+        if (ActiveSessions::getInstance().removeSession(userId, this)) {
+            NotificationService::getInstance().publishStatus(userId, Protocol::UserStatus::OFFLINE, dbManager);
+            DeliveryTracker::getInstance().release(userId);
+            ResumeTokens::getInstance().revoke(userId);
+        }
         isAuthenticated = false;
         userId = 0;
 
-        statusUpdateTimer.stop();
-
         QJsonObject response{
             {"type", "logout_response"},
             {"status", "success"},
             {"timestamp", QDateTime::currentMSecsSinceEpoch()}
         };
-        sendResponse(QJsonDocument(response).toJson());
+        sendResponse(response);
 
         qDebug() << "User logged out successfully";
     }
@@ -348,10 +544,6 @@ void ClientSession::handlePing(const QJsonObject& message)
     qDebug() << "SERVER: Received PING from client at"
              << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss.zzz");
 
-    // Aktualizuj czas ostatniego pinga
-    lastPingTime = QDateTime::currentMSecsSinceEpoch();
-    missedPings = 0;
-
     // Utwórz i wyślij odpowiedź PONG
     QJsonObject pongResponse{
         {"type", Protocol::MessageType::PONG},
@@ -361,117 +553,220 @@ void ClientSession::handlePing(const QJsonObject& message)
     qDebug() << "SERVER: Sending PONG response at"
              << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss.zzz");
 
-    sendResponse(QJsonDocument(pongResponse).toJson());
+    sendResponse(pongResponse);
 }
 
 void ClientSession::handleSendMessage(const QJsonObject& json)
 {
     int receiverId = json["receiver_id"].toInt();
     QString content = json["content"].toString();
-    QString messageId = QUuid::createUuid().toString();
+    QString clientKey = json[Protocol::Deduplication::KEY].toString();
 
     if (content.isEmpty()) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Empty message content")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Empty message content"));
         return;
     }
+    // Za długa treść nie zmieści się w bazie - odrzucamy ją, zanim trafi do
+    // partii lub dziennika razem z wiadomościami innych użytkowników
+    if (content.toUtf8().size() > Protocol::Validation::MAX_MESSAGE_BYTES) {
+        sendResponse(Protocol::MessageStructure::createError("Message too long"));
+        return;
+    }
+    if (clientKey.size() > Protocol::Deduplication::MAX_KEY_LENGTH) {
+        sendResponse(Protocol::MessageStructure::createError("Client message id too long"));
+        return;
+    }
+
+    // Id jest znane przed zapisem - trafia do bazy, potwierdzenia i wiadomości do odbiorcy
+    quint64 messageId = MessageIdGenerator::getInstance().next();
+    quint32 senderId = userId;
+
+    if (!clientKey.isEmpty()) {
+        SendDeduplicator::Claim claim = SendDeduplicator::getInstance().claim(senderId, clientKey, messageId);
+        if (claim.duplicate) {
+            // Ponowienie - pierwotne potwierdzenie, bez zapisu i ponownego doręczenia
+            quint64 originalId = claim.messageId;
+            claim.stored.then(this, [this, originalId, clientKey](bool stored) {
+                if (stored) {
+                    sendResponse(Protocol::MessageStructure::createMessageAck(originalId, clientKey));
+                } else {
+                    sendResponse(Protocol::MessageStructure::createError("Failed to store message"));
+                }
+            }).onCanceled(this, [this]() {
+                // Wpis wypadł z okna przed rozstrzygnięciem - wynik nieznany
+                sendResponse(Protocol::MessageStructure::createError("Failed to store message"));
+            });
+            qDebug() << "Duplicate send" << clientKey << "from user" << senderId << "- message" << originalId;
+            return;
+        }
+    }
+
+    // Rozstrzyga klucz także wtedy, gdy sesja zdążyła się zamknąć
+    auto settle = [senderId, clientKey](bool stored) {
+        if (!clientKey.isEmpty()) {
+            SendDeduplicator::getInstance().complete(senderId, clientKey, stored);
+        }
+        return stored;
+    };
 
     // Próba zapisania wiadomości
-    if (dbManager->storeMessage(userId, receiverId, content)) {
-        // Wyślij potwierdzenie do nadawcy
-        QJsonObject response = Protocol::MessageStructure::createMessageAck(messageId);
-        sendResponse(QJsonDocument(response).toJson());
-
-        // Wyślij wiadomość do odbiorcy jeśli jest online
-        ClientSession* receiverSession = ActiveSessions::getInstance().getSession(receiverId);
-        if (receiverSession) {
-            // Użyj protokołu do utworzenia wiadomości - używamy createNewMessage zamiast createNewMessageResponse
+    auto handler = [this, senderId, receiverId, content, messageId, clientKey](bool stored) {
+        if (stored) {
+            // Wyślij potwierdzenie do nadawcy
+            QJsonObject response = Protocol::MessageStructure::createMessageAck(messageId, clientKey);
+            sendResponse(response);
+
+            // Wyślij wiadomość do odbiorcy jeśli jest online (sesja może żyć w innym wątku)
             QJsonObject newMessage = Protocol::MessageStructure::createNewMessage(
                 content,
-                static_cast<int>(userId),
-                QDateTime::currentMSecsSinceEpoch()
+                static_cast<int>(senderId),
+                QDateTime::currentMSecsSinceEpoch(),
+                messageId
                 );
-            receiverSession->sendResponse(QJsonDocument(newMessage).toJson());
+            DeliveryTracker::getInstance().deliver(receiverId, newMessage);
+
+            qDebug() << "Message" << messageId << "stored and sent successfully";
+        } else {
+            sendResponse(Protocol::MessageStructure::createError("Failed to store message"));
+            qWarning() << "Failed to store message" << messageId;
         }
+    };
 
-        qDebug() << "Message" << messageId << "stored and sent successfully";
-    } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Failed to store message")).toJson());
-        qWarning() << "Failed to store message" << messageId;
+    // Z dziennikiem potwierdzamy po fsync - do bazy wiadomość trafi w tle
+    MessageJournal& journal = MessageJournal::getInstance();
+    if (journal.isRunning()) {
+        journal.append(senderId, receiverId, content, messageId).then(settle).then(this, handler);
+        return;
+    }
+
+    // Potwierdzenie dopiero po zatwierdzeniu partii, w której zapisano wiadomość
+    MessageBatcher& batcher = MessageBatcher::getInstance();
+    if (batcher.isRunning()) {
+        batcher.enqueue(senderId, receiverId, content, messageId).then([settle](qint64 storedId) {
+            return settle(storedId > 0);
+        }).then(this, handler);
+        return;
     }
+
+    runQuery<bool>([senderId, receiverId, content, messageId, settle](DatabaseManager& db) {
+        return settle(db.storeMessage(senderId, receiverId, content, messageId));
+    }, handler, [settle]() {
+        settle(false);
+    });
 }
 
 void ClientSession::checkConnectionStatus()
 {
+    livenessTimer = 0;
     if (!socket || !socket->isValid() || socket->state() != QAbstractSocket::ConnectedState) {
         return;
     }
 
+    // Pingujemy tylko klienta, który milczy - ruch przychodzący wystarcza
+    // jako dowód, że połączenie żyje
     qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+    qint64 idle = currentTime - lastActivity;
+    if (idle < Protocol::Timeouts::PING) {
+        scheduleLivenessCheck(Protocol::Timeouts::PING - idle);
+        return;
+    }
+
+    if (missedPings >= MAX_MISSED_PINGS) {
+        qWarning() << "Connection timeout - no data for" << idle << "ms, closing session";
+        flushOutput();
+        socket->disconnectFromHost();
+        return;
+    }
+
+    if (missedPings > 0) {
+        qWarning() << "Missed PONG from client - count:" << missedPings;
+    }
 
     QJsonObject pingMessage = Protocol::MessageStructure::createPing();
     pingMessage["timestamp"] = currentTime;
 
-    qDebug() << "SERVER: Sending PING at"
-             << QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss.zzz")
-             << "with timestamp:" << currentTime;
+    qDebug() << "SERVER: Sending PING after" << idle << "ms of inactivity";
 
-    sendResponse(QJsonDocument(pingMessage).toJson());
+    sendResponse(pingMessage);
+    ++missedPings;
+    scheduleLivenessCheck(Protocol::Timeouts::PING);
+}
 
-    if (currentTime - lastPingTime > Protocol::Timeouts::CONNECTION) {
-        missedPings++;
-        qWarning() << "Missed PONG from client - count:" << missedPings;
+void ClientSession::scheduleLivenessCheck(qint64 delayMs)
+{
+    if (wheel) {
+        livenessTimer = wheel->schedule(delayMs, [this]() { checkConnectionStatus(); });
+    }
+}
 
-        if (missedPings >= MAX_MISSED_PINGS) {
-            qWarning() << "Connection timeout - closing session";
-            socket->disconnectFromHost();
-        }
+void ClientSession::cancelTimer(TimingWheel::TimerId& timer)
+{
+    if (timer != 0 && wheel) {
+        wheel->cancel(timer);
     }
+    timer = 0;
 }
 
 void ClientSession::handleFriendsListRequest()
 {
-    QJsonObject response = prepareFriendsListResponse();
-    sendResponse(QJsonDocument(response).toJson());
+    requestFriendsList([this](const QJsonArray& friendsArray) {
+        QJsonObject response;
+        response["type"] = Protocol::MessageType::FRIENDS_LIST_RESPONSE;
+        response["friends"] = friendsArray;
+        response["timestamp"] = QDateTime::currentMSecsSinceEpoch();
+
+        qDebug() << "Prepared friends list response:" << QJsonDocument(response).toJson();
+        sendResponse(response);
+    });
 }
 
 void ClientSession::handleStatusRequest()
 {
     QJsonObject response = prepareStatusResponse();
-    sendResponse(QJsonDocument(response).toJson());
+    sendResponse(response);
 }
 
-QJsonObject ClientSession::prepareFriendsListResponse()
+void ClientSession::requestFriendsList(const std::function<void(const QJsonArray&)>& handler)
 {
-    QJsonObject response;
-    response["type"] = Protocol::MessageType::FRIENDS_LIST_RESPONSE;
+    quint32 uid = userId;
+    runQuery<QJsonArray>([uid](DatabaseManager& db) {
+        return buildFriendsArray(db, uid);
+    }, [handler](QJsonArray friendsArray) {
+        handler(friendsArray);
+    });
+}
+
+QJsonArray ClientSession::buildFriendsArray(DatabaseManager& db, quint32 userId)
+{
+    return friendsToJson(db.getFriendsList(userId));
+}
 
+QJsonArray ClientSession::friendsToJson(const QVector<QPair<quint32, QString>>& friendsList)
+{
     QJsonArray friendsArray;
-    auto friendsList = dbManager->getFriendsList(userId);
+    const PresenceRegistry& presence = PresenceRegistry::getInstance();
 
     for (const auto& friend_ : friendsList) {
         QJsonObject friendObj;
-        int friendId = static_cast<int>(friend_.first);
-        friendObj["id"] = friendId;
+        friendObj["id"] = static_cast<int>(friend_.first);
         friendObj["username"] = friend_.second;
-
-        QString status;
-        if (dbManager->getUserStatus(friendId, status)) {
-            friendObj["status"] = status;
-        } else {
-            qWarning() << "Failed to get status for user ID:" << friendId;
-            friendObj["status"] = Protocol::UserStatus::OFFLINE;
-        }
-
-        qDebug() << "Friend" << friend_.second << "status:" << friendObj["status"].toString();
+        friendObj["status"] = presence.status(friend_.first);
         friendsArray.append(friendObj);
     }
 
-    response["friends"] = friendsArray;
-    response["timestamp"] = QDateTime::currentMSecsSinceEpoch();
-
-    qDebug() << "Prepared friends list response:" << QJsonDocument(response).toJson();
+    return friendsArray;
+}
 
-    return response;
+QJsonArray ClientSession::unreadToJson(const QVector<QPair<quint32, int>>& unreadCounts)
+{
+    QJsonArray usersArray;
+    for (const auto& unread : unreadCounts) {
+        QJsonObject userObj;
+        userObj["id"] = QString::number(unread.first);
+        userObj["count"] = unread.second;
+        usersArray.append(userObj);
+    }
+    return usersArray;
 }
 
 QJsonObject ClientSession::prepareStatusResponse()
@@ -479,13 +774,18 @@ QJsonObject ClientSession::prepareStatusResponse()
     return Protocol::MessageStructure::createStatusUpdate("online");
 }
 
-QJsonObject ClientSession::prepareMessagesResponse()
+QJsonObject ClientSession::prepareMessagesResponse(const QVector<ChatMessage>& messages)
 {
     QJsonObject response;
     QJsonArray messagesArray;
 
     for (const auto& msg : messages) {
         QJsonObject msgObj;
+        msgObj["id"] = msg.id;
+        // Ten sam klucz i format co w new_messages i message_ack
+        if (msg.globalId != 0) {
+            msgObj["message_id"] = QString::number(msg.globalId);
+        }
         msgObj["sender"] = msg.username;
         msgObj["content"] = msg.message;
         msgObj["timestamp"] = msg.timestamp.toString(Qt::ISODate);
@@ -498,88 +798,202 @@ QJsonObject ClientSession::prepareMessagesResponse()
     return response;
 }
 
-void ClientSession::sendResponse(const QByteArray& response)
+void ClientSession::deliver(const QByteArray& response, OutputClass outputClass, const QString& key)
 {
+    sendResponse(response, outputClass, key);
+}
+
+void ClientSession::sendResponse(const QJsonObject& response, OutputClass outputClass, const QString& key)
+{
+    writeFrame(codec.encode(response), outputClass, key);
+}
+
+void ClientSession::sendResponse(const QByteArray& response, OutputClass outputClass, const QString& key)
+{
+    writeFrame(codec.encode(response), outputClass, key);
+}
+
+void ClientSession::writeFrame(const QByteArray& frame, OutputClass outputClass, const QString& key)
+{
+    OutputPolicy policy = ServerConfig::instance.backpressure.policyFor(outputClass);
+
+    if (policy == OutputPolicy::Coalesce && !key.isEmpty() && outputQueue.replace(key, frame)) {
+        // Klient i tak zobaczy tylko najnowszy stan
+        SessionMetrics::getInstance().frameCoalesced();
+    } else if (policy == OutputPolicy::Drop && throttled) {
+        SessionMetrics::getInstance().frameDropped();
+        return;
+    } else {
+        outputQueue.push(frame, outputClass, key);
+    }
+
+    updateBackpressure();
+    if (corkDepth == 0) {
+        scheduleFlush();
+    }
+}
+
+void ClientSession::cork()
+{
+    ++corkDepth;
+}
+
+void ClientSession::uncork()
+{
+    if (corkDepth > 0 && --corkDepth == 0 && !outputQueue.isEmpty()) {
+        scheduleFlush();
+    }
+}
+
+void ClientSession::scheduleFlush()
+{
+    // Jeden zapis na iterację pętli zdarzeń - odpowiedzi powstałe do tego
+    // czasu (także z innych zdarzeń) trafiają do tego samego wywołania write()
+    if (!flushScheduled) {
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this, &ClientSession::flushOutput, Qt::QueuedConnection);
+    }
+}
+
+void ClientSession::flushOutput()
+{
+    flushScheduled = false;
+    if (corkDepth > 0 || outputQueue.isEmpty()) {
+        return;
+    }
+
     if (!socket || !socket->isValid()) {
         qWarning() << "Attempting to send response through invalid socket";
+        outputQueue.clear();
+        return;
+    }
+
+    if (throttled) {
+        // Wznowimy po opróżnieniu bufora socketu (handleBytesWritten)
         return;
     }
 
-    qint64 written = socket->write(response);
+    // QTcpSocket nie udostępnia writev - sklejamy ramki w jeden bufor,
+    // co daje jedno wywołanie systemowe zamiast osobnego na każdą ramkę
+    qDebug() << "SERVER: Flushing" << outputQueue.count() << "frames," << outputQueue.bytes() << "bytes";
+
+    int frames = outputQueue.count();
+    QByteArray batch = outputQueue.takeAll();
+
+    qint64 written = socket->write(batch);
     if (written <= 0) {
         qWarning() << "Failed to write to socket";
         return;
     }
 
+    socketFrames += frames;
     socket->flush();
+    updateBackpressure();
 }
 
-void ClientSession::sendFriendsStatusUpdate()
+void ClientSession::updateBackpressure()
 {
-    if (isAuthenticated) {
-        auto friendsList = prepareFriendsListResponse()["friends"].toArray();
-        QJsonObject response = Protocol::MessageStructure::createFriendsStatusUpdate(friendsList);
-        sendResponse(QJsonDocument(response).toJson());
+    const ServerConfig::Backpressure& config = ServerConfig::instance.backpressure;
+    qint64 socketBytes = socket ? socket->bytesToWrite() : 0;
+
+    if (!throttled) {
+        // Dławimy dopiero, gdy klient nie odebrał tego, co już dostał,
+        // a kolejne dane wciąż napływają - sama seria odpowiedzi w kolejce
+        // (np. po cork()) nie jest objawem wolnego klienta
+        bool overBytes = socketBytes > config.lowWatermarkBytes
+                         && socketBytes + outputQueue.bytes() > config.highWatermarkBytes;
+        bool overMessages = socketFrames > config.lowWatermarkMessages
+                            && socketFrames + outputQueue.count() > config.highWatermarkMessages;
+        if (overBytes || overMessages) {
+            throttled = true;
+            graceTimer = wheel ? wheel->schedule(config.gracePeriod, [this]() {
+                graceTimer = 0;
+                handleSlowConsumer();
+            }) : 0;
+            SessionMetrics::getInstance().sessionThrottled(reinterpret_cast<quintptr>(this), userId);
+            qWarning() << "Throttling slow client" << userId << "- pending" << socketBytes
+                       << "bytes in socket," << outputQueue.bytes() << "bytes queued";
+        }
+    } else if (socketBytes <= config.lowWatermarkBytes && socketFrames <= config.lowWatermarkMessages) {
+        throttled = false;
+        cancelTimer(graceTimer);
+        SessionMetrics::getInstance().sessionReleased(reinterpret_cast<quintptr>(this));
+        qDebug() << "Client" << userId << "caught up, releasing" << outputQueue.count() << "queued frames";
+        if (!outputQueue.isEmpty() && corkDepth == 0) {
+            scheduleFlush();
+        }
     }
 }
 
-void ClientSession::processBuffer()
+void ClientSession::handleBytesWritten(qint64 bytes)
 {
-    qDebug() << "SERVER: Processing buffer of size:" << buffer.size()
-    << "Content:" << QString::fromUtf8(buffer);
+    Q_UNUSED(bytes);
+    // QTcpSocket raportuje tylko bajty - licznik ramek zerujemy, gdy bufor jest pusty
+    if (socket && socket->bytesToWrite() == 0) {
+        socketFrames = 0;
+    }
+    updateBackpressure();
+}
+
+void ClientSession::handleSlowConsumer()
+{
+    if (!throttled || !socket) {
+        return;
+    }
 
-    bool foundJson;
-    do {
-        foundJson = false;
-        int startPos = buffer.indexOf('{');
+    qWarning() << "Disconnecting slow client" << userId << "- output above watermark for"
+               << ServerConfig::instance.backpressure.gracePeriod << "ms";
+    SessionMetrics::getInstance().slowConsumerDisconnected();
+    outputQueue.clear();
+    socket->abort();
+}
 
-        if (startPos >= 0) {
-            qDebug() << "SERVER: Found JSON start at position:" << startPos;
+void ClientSession::processBuffer()
+{
+    // Odpowiedzi na wszystkie żądania z jednego odczytu wychodzą razem
+    OutputCork cork(this);
 
-            int endPos = -1;
-            int braceCount = 1;
+    forever {
+        FrameCodec::Result frame = codec.next();
 
-            for (int i = startPos + 1; i < buffer.size(); ++i) {
-                if (buffer[i] == '{') {
-                    braceCount++;
-                    qDebug() << "SERVER: Found nested { at" << i << "brace count:" << braceCount;
-                }
-                else if (buffer[i] == '}') {
-                    braceCount--;
-                    qDebug() << "SERVER: Found } at" << i << "brace count:" << braceCount;
-                    if (braceCount == 0) {
-                        endPos = i;
-                        break;
-                    }
+        if (frame.status == FrameCodec::Status::Incomplete) {
+            qDebug() << "SERVER: Waiting for more data, buffered:" << codec.bufferedBytes();
+            return;
+        }
+
+        if (frame.status == FrameCodec::Status::Error) {
+            qWarning() << "SERVER: Rejected frame:" << frame.error;
+            if (frame.fatal) {
+                // Nie da się odnaleźć granicy następnej ramki - zamykamy połączenie
+                sendResponse(Protocol::MessageStructure::createError(frame.error));
+                corkDepth = 0;
+                flushOutput();
+                if (socket) {
+                    socket->disconnectFromHost();
                 }
+                return;
             }
+            continue;
+        }
 
-            if (endPos > startPos) {
-                QByteArray jsonData = buffer.mid(startPos, endPos - startPos + 1);
-                qDebug() << "SERVER: Extracted JSON:" << QString::fromUtf8(jsonData);
-
-                // Sprawdź, czy to prawidłowy JSON przed przetworzeniem
-                QJsonParseError parseError;
-                QJsonDocument doc = QJsonDocument::fromJson(jsonData, &parseError);
-                if (parseError.error == QJsonParseError::NoError) {
-                    qDebug() << "SERVER: Valid JSON detected, processing message";
-                    processMessage(jsonData);
-                } else {
-                    qWarning() << "SERVER: Invalid JSON:" << parseError.errorString();
-                }
+        processMessage(frame.message);
+    }
+}
 
-                buffer.remove(0, endPos + 1);
-                foundJson = true;
+void ClientSession::handleSetFraming(const QJsonObject& json)
+{
+    QString mode = json["mode"].toString();
+    if (mode != Protocol::Framing::JSON && mode != Protocol::Framing::BINARY) {
+        sendResponse(Protocol::MessageStructure::createSetFramingResponse(
+            false, codec.mode() == FrameCodec::Mode::Binary ? Protocol::Framing::BINARY : Protocol::Framing::JSON,
+            codec.maxFrameSize()));
+        return;
+    }
 
-                qDebug() << "SERVER: Remaining buffer size after processing:"
-                         << buffer.size();
-            } else {
-                qWarning() << "SERVER: No matching } found for { at position" << startPos;
-            }
-        } else {
-            qDebug() << "SERVER: No JSON start marker found in buffer";
-        }
-    } while (foundJson);
+    // Potwierdzenie idzie jeszcze w dotychczasowym trybie, kolejne ramki już w nowym
+    sendResponse(Protocol::MessageStructure::createSetFramingResponse(true, mode, codec.maxFrameSize()));
+    codec.setMode(mode == Protocol::Framing::BINARY ? FrameCodec::Mode::Binary : FrameCodec::Mode::Json);
+    qDebug() << "SERVER: Framing switched to" << mode;
 }
 
 void ClientSession::setUserId(quint32 id) {
@@ -587,6 +1001,13 @@ void ClientSession::setUserId(quint32 id) {
     ActiveSessions::getInstance().addSession(userId, this);
 }
 
+DeliveryTracker::Resume ClientSession::beginSession(quint32 id) {
+    setUserId(id);
+    state = Protocol::SessionState::AUTHENTICATED;
+    isAuthenticated = true;
+    return DeliveryTracker::getInstance().resume(userId);
+}
+
 void ClientSession::sendUnreadFromUsers()
 {
     if (!isAuthenticated || !userId) {
@@ -594,37 +1015,33 @@ void ClientSession::sendUnreadFromUsers()
         return;
     }
 
-    QVector<quint32> unreadUsers = dbManager->getUnreadMessagesUsers(userId);
-    qDebug() << "Found" << unreadUsers.size() << "users with unread messages for user" << userId;
+    quint32 uid = userId;
+    runQuery<QVector<QPair<quint32, int>>>([uid](DatabaseManager& db) {
+        return db.getUnreadCounts(uid);
+    }, [this, uid](QVector<QPair<quint32, int>> unreadUsers) {
+        qDebug() << "Found" << unreadUsers.size() << "users with unread messages for user" << uid;
 
-    QJsonArray usersArray;
-    for (quint32 fromId : unreadUsers) {
-        QJsonObject userObj;
-        userObj["id"] = QString::number(fromId);
-        usersArray.append(userObj);
-        qDebug() << "Added user" << fromId << "to unread messages list";
-    }
+        QJsonObject response;
+        response["type"] = Protocol::MessageType::UNREAD_FROM;
+        response["users"] = unreadToJson(unreadUsers);
 
-    QJsonObject response;
-    response["type"] = Protocol::MessageType::UNREAD_FROM;
-    response["users"] = usersArray;
-
-    qDebug() << "Sending unread_from response:" << QJsonDocument(response).toJson();
-    sendResponse(QJsonDocument(response).toJson());
+        qDebug() << "Sending unread_from response:" << QJsonDocument(response).toJson();
+        sendResponse(response);
+    });
 }
 
 void ClientSession::handleStatusUpdate(const QJsonObject& json) {
     QString newStatus = json["status"].toString();
     if (!newStatus.isEmpty() && userId > 0) {
-        if (dbManager->updateUserStatus(userId, newStatus)) {
-            sendFriendsStatusUpdate();
+        if (NotificationService::getInstance().publishStatus(userId, newStatus, dbManager)) {
+            sendResponse(Protocol::MessageStructure::createStatusUpdate(newStatus.toLower()));
             qDebug() << "User" << userId << "status updated to:" << newStatus;
         } else {
-            sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Failed to update status")).toJson());
+            sendResponse(Protocol::MessageStructure::createError("Failed to update status"));
             qWarning() << "Failed to update status for user" << userId;
         }
     } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Invalid status update data")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Invalid status update data"));
         qWarning() << "Invalid status update request received";
     }
 }
@@ -633,11 +1050,18 @@ void ClientSession::handleSearchUsers(const QJsonObject& json) {
     QString searchQuery = json["query"].toString();
     qDebug() << "Processing search users request with query:" << searchQuery;
 
-    if (!searchQuery.isEmpty()) {
-        auto results = dbManager->searchUsers(searchQuery, userId);
+    if (searchQuery.isEmpty()) {
+        qWarning() << "Received empty search query";
+        sendResponse(Protocol::MessageStructure::createError("Empty search query"));
+        return;
+    }
 
+    auto respond = [this](const QVector<UserSearchResult>& results) {
         QJsonArray usersArray;
         for (const auto& result : results) {
+            if (result.id == userId || usersArray.size() >= Protocol::UserSearch::MAX_RESULTS) {
+                continue;
+            }
             QJsonObject userObj;
             userObj["id"] = QString::number(result.id);
             userObj["username"] = result.username;
@@ -651,43 +1075,78 @@ void ClientSession::handleSearchUsers(const QJsonObject& json) {
         };
 
         qDebug() << "Sending search response with" << usersArray.size() << "results";
-        sendResponse(QJsonDocument(response).toJson());
+        sendResponse(response);
+    };
+
+    UsernameIndex& index = UsernameIndex::getInstance();
+    if (!index.isLoaded()) {
+        quint32 uid = userId;
+        runQuery<QVector<UserSearchResult>>([searchQuery, uid](DatabaseManager& db) {
+            return db.searchUsers(searchQuery, uid);
+        }, respond);
+        return;
+    }
+
+    QString query = UsernameIndex::key(searchQuery);
+    bool prefix = json["prefix"].toBool();
+    // Odczyt przed wyszukiwaniem - rejestracja w trakcie unieważni wynik
+    quint64 revision = index.revision();
+
+    // Dopisanie znaku zawęża wynik: nazwy pasujące do nowego zapytania
+    // pasują też do poprzedniego, więc pełna lista kandydatów wystarcza
+    bool narrows = prefix ? query.startsWith(lastSearch.query) : query.contains(lastSearch.query);
+    if (lastSearch.complete && !lastSearch.query.isEmpty() && lastSearch.prefix == prefix &&
+        lastSearch.revision == revision && narrows) {
+        QVector<UserSearchResult> candidates;
+        for (const UserSearchResult& candidate : lastSearch.candidates) {
+            if (UsernameIndex::matches(candidate.username, query, prefix)) {
+                candidates.append(candidate);
+            }
+        }
+        lastSearch.candidates = std::move(candidates);
     } else {
-        qWarning() << "Received empty search query";
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Empty search query")).toJson());
+        lastSearch.candidates = index.search(query, prefix, Protocol::UserSearch::MAX_CANDIDATES,
+                                             &lastSearch.complete);
+        lastSearch.prefix = prefix;
+        lastSearch.revision = revision;
     }
+    lastSearch.query = query;
+
+    respond(lastSearch.candidates);
 }
 
 void ClientSession::handleRemoveFriend(const QJsonObject& json) {
     quint32 friendId = json["friend_id"].toInt();
 
     if (friendId > 0 && userId > 0) {
-        if (dbManager->removeFriend(userId, friendId)) {
-            ClientSession* friendSession = ActiveSessions::getInstance().getSession(friendId);
-
-            handleFriendsListRequest();  // Dla inicjatora
-
-            if (friendSession) {
-                friendSession->handleFriendsListRequest(); // Dla usuniętego znajomego
-            }
-
-            QJsonObject response = Protocol::MessageStructure::createRemoveFriendResponse(true);
-            sendResponse(QJsonDocument(response).toJson());
-
-            if (friendSession) {
-                QJsonObject friendRemovedNotification = Protocol::MessageStructure::createFriendRemovedNotification(userId);
-                friendSession->sendResponse(QJsonDocument(friendRemovedNotification).toJson());
+        quint32 uid = userId;
+        runQuery<bool>([uid, friendId](DatabaseManager& db) {
+            return db.removeFriend(uid, friendId);
+        }, [this, uid, friendId](bool removed) {
+            if (removed) {
+                handleFriendsListRequest();  // Dla inicjatora
+
+                QJsonObject response = Protocol::MessageStructure::createRemoveFriendResponse(true);
+                sendResponse(response);
+
+                // Dla usuniętego znajomego - w wątku jego sesji
+                QByteArray friendRemovedNotification = QJsonDocument(
+                    Protocol::MessageStructure::createFriendRemovedNotification(uid)).toJson();
+                ActiveSessions::getInstance().post(friendId, [friendRemovedNotification](ClientSession* friendSession) {
+                    friendSession->handleFriendsListRequest();
+                    friendSession->deliver(friendRemovedNotification, OutputClass::Notification);
+                });
+
+                qDebug() << "Successfully removed friend" << friendId << "for user" << uid;
+            } else {
+                QJsonObject response = Protocol::MessageStructure::createRemoveFriendResponse(false);
+                sendResponse(response);
+                qWarning() << "Failed to remove friend" << friendId << "for user" << uid;
             }
-
-            qDebug() << "Successfully removed friend" << friendId << "for user" << userId;
-        } else {
-            QJsonObject response = Protocol::MessageStructure::createRemoveFriendResponse(false);
-            sendResponse(QJsonDocument(response).toJson());
-            qWarning() << "Failed to remove friend" << friendId << "for user" << userId;
-        }
+        });
     } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError(
-                                       "Invalid friend removal request")).toJson());
+        sendResponse(Protocol::MessageStructure::createError(
+            "Invalid friend removal request"));
         qWarning() << "Invalid friend removal request received";
     }
 }
@@ -696,229 +1155,450 @@ void ClientSession::handleGetLatestMessages(const QJsonObject& json) {
     quint32 friendId = json["friend_id"].toInt();
     int limit = json["limit"].toInt(Protocol::ChatHistory::MESSAGE_BATCH_SIZE);
 
-    messages = dbManager->getLatestMessages(userId, friendId, limit);
-    bool hasMore = dbManager->hasMoreHistory(userId, friendId, 0);
-
-    QJsonObject response = prepareMessagesResponse();
-    response["type"] = Protocol::MessageType::LATEST_MESSAGES_RESPONSE;
-    response["has_more"] = hasMore;
-    response["offset"] = messages.size();
-    sendResponse(QJsonDocument(response).toJson());
+    quint32 uid = userId;
+    runQuery<HistoryResult>([uid, friendId, limit](DatabaseManager& db) {
+        HistoryResult result;
+        result.messages = db.getLatestMessages(uid, friendId, limit);
+        // Wiadomości są rosnąco - wystarczy sprawdzić, czy istnieje starsza od pierwszej
+        result.hasMore = !result.messages.isEmpty()
+                         && db.hasMessagesBefore(uid, friendId, result.messages.first().id);
+        return result;
+    }, [this](HistoryResult result) {
+        QJsonObject response = prepareMessagesResponse(result.messages);
+        response["type"] = Protocol::MessageType::LATEST_MESSAGES_RESPONSE;
+        response["has_more"] = result.hasMore;
+        response["offset"] = result.messages.size();
+        if (!result.messages.isEmpty()) {
+            response["next_before_id"] = result.messages.first().id;
+        }
+        sendResponse(response);
+    });
 }
 
 void ClientSession::handleGetChatHistory(const QJsonObject& json) {
-    quint32 friendId = json["friend_id"].toInt();
-    int offset = json["offset"].toInt(0);
-
-    messages = dbManager->getChatHistory(userId, friendId, offset);
-    bool hasMore = dbManager->hasMoreHistory(userId, friendId, offset);
-
-    QJsonObject response = prepareMessagesResponse();
-    response["has_more"] = hasMore;
-    response["offset"] = offset;
-    sendResponse(QJsonDocument(response).toJson());
+    sendHistoryPage(json, Protocol::MessageType::CHAT_HISTORY_RESPONSE);
 }
 
 void ClientSession::handleGetMoreHistory(const QJsonObject& json) {
+    sendHistoryPage(json, Protocol::MessageType::MORE_HISTORY_RESPONSE);
+}
+
+void ClientSession::sendHistoryPage(const QJsonObject& json, const QString& responseType)
+{
     quint32 friendId = json["friend_id"].toInt();
+    quint32 uid = userId;
+
+    // Tryb kursorowy: before_id (starsze, 0 = od najnowszej) albo after_id (nowsze)
+    bool before = json.contains("before_id");
+    bool after = !before && json.contains("after_id");
+    if (before || after) {
+        qint64 cursorId = before ? json["before_id"].toInteger() : json["after_id"].toInteger();
+        int limit = qBound(1, json["limit"].toInt(Protocol::ChatHistory::MESSAGE_BATCH_SIZE),
+                           Protocol::ChatHistory::MAX_PAGE_SIZE);
+
+        runQuery<HistoryResult>([uid, friendId, before, cursorId, limit](DatabaseManager& db) {
+            HistoryResult result;
+            result.messages = before
+                ? db.getChatHistoryBefore(uid, friendId, cursorId, limit, result.hasMore)
+                : db.getChatHistoryAfter(uid, friendId, cursorId, limit, result.hasMore);
+            return result;
+        }, [this, responseType, before, cursorId](HistoryResult result) {
+            QJsonObject response = prepareMessagesResponse(result.messages);
+            response["type"] = responseType;
+            response["has_more"] = result.hasMore;
+            response[before ? "before_id" : "after_id"] = cursorId;
+            if (!result.messages.isEmpty()) {
+                response[before ? "next_before_id" : "next_after_id"] = result.messages.last().id;
+            }
+            sendResponse(response);
+        });
+        return;
+    }
+
+    // Tryb offset dla starszych klientów
     int offset = json["offset"].toInt(0);
+    runQuery<HistoryResult>([uid, friendId, offset](DatabaseManager& db) {
+        HistoryResult result;
+        result.messages = db.getChatHistory(uid, friendId, offset,
+                                            Protocol::ChatHistory::MESSAGE_BATCH_SIZE + 1);
+        result.hasMore = result.messages.size() > Protocol::ChatHistory::MESSAGE_BATCH_SIZE;
+        if (result.hasMore) {
+            result.messages.removeLast();
+        }
+        return result;
+    }, [this, responseType, offset](HistoryResult result) {
+        QJsonObject response = prepareMessagesResponse(result.messages);
+        response["type"] = responseType;
+        response["has_more"] = result.hasMore;
+        response["offset"] = offset;
+        sendResponse(response);
+    });
+}
+
+void ClientSession::handleSync(const QJsonObject& json)
+{
+    quint32 uid = userId;
+    int limit = qBound(1, json["limit"].toInt(Protocol::ChatHistory::MESSAGE_BATCH_SIZE),
+                       Protocol::ChatHistory::MAX_PAGE_SIZE);
+
+    // Stan znany klientowi; brak kursora (-1) oznacza, że trzeba go wysłać
+    QVector<SyncConversation> requested;
+    QVector<QPair<qint64, qint64>> knownCursors;
+    const QJsonArray conversations = json["conversations"].toArray();
+    for (const QJsonValue& value : conversations) {
+        if (requested.size() >= Protocol::Sync::MAX_CONVERSATIONS) {
+            break;
+        }
+        QJsonObject entry = value.toObject();
+        SyncConversation conversation;
+        conversation.friendId = entry["friend_id"].toInt();
+        conversation.afterId = qMax<qint64>(0, entry["last_id"].toInteger());
+        if (conversation.friendId == 0) {
+            continue;
+        }
+        requested.append(conversation);
+        knownCursors.append({entry["read_id"].toInteger(-1), entry["partner_read_id"].toInteger(-1)});
+    }
+
+    // Wersja pobrana przed odczytem - zmiany w trakcie przyjdą jeszcze raz w następnym sync
+    SyncVersions& versions = SyncVersions::getInstance();
+    QString version = versions.version();
+    quint64 since = versions.parse(json["version"].toString());
+    bool fullFriends = since == 0 || versions.friendsVersion(uid) > since;
+
+    runQuery<SyncResult>([uid, limit, requested, knownCursors, since, fullFriends](DatabaseManager& db) {
+        SyncResult result;
+        result.conversations = requested;
+
+        int budget = Protocol::Sync::MAX_MESSAGES;
+        QSet<quint32> covered;
+        for (int i = 0; i < result.conversations.size(); ++i) {
+            SyncConversation& conversation = result.conversations[i];
+            covered.insert(conversation.friendId);
+
+            // Po wyczerpaniu limitu rozmowa czeka na kolejny sync
+            if (budget <= 0) {
+                conversation.hasMore = true;
+                continue;
+            }
+            conversation.messages = db.getChatHistoryAfter(uid, conversation.friendId, conversation.afterId,
+                                                           qMin(limit, budget), conversation.hasMore);
+            budget -= conversation.messages.size();
+
+            if (db.getReadCursors(uid, conversation.friendId, conversation.readId, conversation.partnerReadId)) {
+                conversation.cursorsChanged = conversation.readId != knownCursors[i].first
+                                              || conversation.partnerReadId != knownCursors[i].second;
+            }
+        }
+
+        for (const auto& unread : db.getUnreadCounts(uid)) {
+            if (!covered.contains(unread.first)) {
+                result.unread.append(unread);
+            }
+        }
+
+        result.fullFriends = fullFriends;
+        if (fullFriends) {
+            result.friends = buildFriendsArray(db, uid);
+        } else {
+            const FriendGraph& graph = FriendGraph::getInstance();
+            QVector<quint32> friendIds;
+            if (graph.isLoaded()) {
+                friendIds = graph.friendsOf(uid);
+            } else {
+                for (const auto& friend_ : db.getFriendsList(uid)) {
+                    friendIds.append(friend_.first);
+                }
+            }
+            result.presenceChanged = SyncVersions::getInstance().presenceChangedSince(friendIds, since);
+        }
+        return result;
+    }, [this, version](SyncResult result) {
+        QJsonArray conversationsArray;
+        bool complete = true;
+        for (const SyncConversation& conversation : result.conversations) {
+            QJsonObject entry = prepareMessagesResponse(conversation.messages);
+            entry.remove("type");
+            entry["friend_id"] = static_cast<int>(conversation.friendId);
+            entry["has_more"] = conversation.hasMore;
+            entry["next_after_id"] = conversation.messages.isEmpty()
+                ? conversation.afterId : conversation.messages.last().id;
+            if (conversation.cursorsChanged) {
+                entry["read_id"] = conversation.readId;
+                entry["partner_read_id"] = conversation.partnerReadId;
+            }
+            complete = complete && !conversation.hasMore;
+
+            // Rozmowy bez zmian nie są odsyłane
+            if (!conversation.messages.isEmpty() || conversation.hasMore || conversation.cursorsChanged) {
+                conversationsArray.append(entry);
+            }
+        }
 
-    messages = dbManager->getChatHistory(userId, friendId, offset);
-    bool hasMore = dbManager->hasMoreHistory(userId, friendId, offset);
+        QJsonObject response{
+            {"type", Protocol::MessageType::SYNC_RESPONSE},
+            {"conversations", conversationsArray},
+            {"unread", unreadToJson(result.unread)},
+            {"complete", complete},
+            {"version", version},
+            {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+        };
 
-    QJsonObject response = prepareMessagesResponse();
-    response["type"] = Protocol::MessageType::MORE_HISTORY_RESPONSE;
-    response["has_more"] = hasMore;
-    response["offset"] = offset;
-    sendResponse(QJsonDocument(response).toJson());
+        if (result.fullFriends) {
+            response["friends"] = result.friends;
+        } else {
+            const PresenceRegistry& presence = PresenceRegistry::getInstance();
+            QJsonArray presenceArray;
+            for (quint32 friendId : result.presenceChanged) {
+                presenceArray.append(QJsonObject{{"id", static_cast<int>(friendId)},
+                                                 {"status", presence.status(friendId)}});
+            }
+            response["presence"] = presenceArray;
+        }
+
+        sendResponse(response);
+    });
 }
 
 void ClientSession::handleMessageRead(const QJsonObject& json) {
     quint32 friendId = json["friendId"].toInt();
     if (friendId > 0 && userId > 0) {
-        if (dbManager->markChatAsRead(userId, friendId)) {
-            sendResponse(QJsonDocument(Protocol::MessageStructure::createMessageReadResponse()).toJson());
-            qDebug() << "Messages from user" << friendId << "marked as read for user" << userId;
-        } else {
-            sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Failed to mark messages as read")).toJson());
-            qWarning() << "Failed to mark messages as read from user" << friendId << "for user" << userId;
-        }
+        quint32 uid = userId;
+        runQuery<bool>([uid, friendId](DatabaseManager& db) {
+            return db.markChatAsRead(uid, friendId);
+        }, [this, uid, friendId](bool marked) {
+            if (marked) {
+                sendResponse(Protocol::MessageStructure::createMessageReadResponse());
+                qDebug() << "Messages from user" << friendId << "marked as read for user" << uid;
+            } else {
+                sendResponse(Protocol::MessageStructure::createError("Failed to mark messages as read"));
+                qWarning() << "Failed to mark messages as read from user" << friendId << "for user" << uid;
+            }
+        });
     } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Invalid message read request")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Invalid message read request"));
         qWarning() << "Invalid message read request received";
     }
 }
 
+void ClientSession::handleMessageAck(const QJsonObject& json) {
+    // Potwierdzenie zbiorcze - bez odpowiedzi, żeby nie dokładać ruchu klientowi
+    qint64 sequence = json["seq"].toInteger();
+    if (sequence <= 0) {
+        sendResponse(Protocol::MessageStructure::createError("Invalid message ack"));
+        return;
+    }
+    DeliveryTracker::getInstance().acknowledge(userId, static_cast<quint64>(sequence));
+}
+
 void ClientSession::handleAddFriendRequest(const QJsonObject& json) {
     int targetUserId = json["user_id"].toInt();
 
     if (targetUserId <= 0 || userId <= 0) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Invalid user ID")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Invalid user ID"));
         return;
     }
 
     if (targetUserId == userId) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError("Cannot send friend request to yourself")).toJson());
+        sendResponse(Protocol::MessageStructure::createError("Cannot send friend request to yourself"));
         return;
     }
 
-    if (dbManager->sendFriendRequest(userId, targetUserId)) {
-        QJsonObject response = Protocol::MessageStructure::createAddFriendResponse(true, "Friend request sent successfully");
-        sendResponse(QJsonDocument(response).toJson());
-        qDebug() << "Friend request sent successfully from user" << userId << "to user" << targetUserId;
-    } else {
-        QString targetUsername = dbManager->getUserUsername(targetUserId);
-
-        QJsonObject response{
-            {"type", Protocol::MessageType::INVITATION_ALREADY_EXISTS},
-            {"user_id", targetUserId},
-            {"username", targetUsername},
-            {"status", "error"},
-            {"error_code", "INVITATION_ALREADY_EXISTS"},
-            {"message", "Invitation already sent to this user"},
-            {"timestamp", QDateTime::currentMSecsSinceEpoch()}
-        };
-
-        sendResponse(QJsonDocument(response).toJson());
-        qDebug() << "Error sending friend request: Friend request already sent";
-    }
+    quint32 uid = userId;
+    runQuery<FriendRequestResult>([uid, targetUserId](DatabaseManager& db) {
+        FriendRequestResult result;
+        result.success = db.sendFriendRequest(uid, targetUserId);
+        if (!result.success) {
+            result.targetUsername = db.getUserUsername(targetUserId);
+        }
+        return result;
+    }, [this, uid, targetUserId](FriendRequestResult result) {
+        if (result.success) {
+            QJsonObject response = Protocol::MessageStructure::createAddFriendResponse(true, "Friend request sent successfully");
+            sendResponse(response);
+            qDebug() << "Friend request sent successfully from user" << uid << "to user" << targetUserId;
+        } else {
+            QJsonObject response{
+                {"type", Protocol::MessageType::INVITATION_ALREADY_EXISTS},
+                {"user_id", targetUserId},
+                {"username", result.targetUsername},
+                {"status", "error"},
+                {"error_code", "INVITATION_ALREADY_EXISTS"},
+                {"message", "Invitation already sent to this user"},
+                {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+            };
+
+            sendResponse(response);
+            qDebug() << "Error sending friend request: Friend request already sent";
+        }
+    });
 }
 
 void ClientSession::handleGetReceivedInvitations() {
-    auto invitations = dbManager->getReceivedInvitations(userId);
-    QJsonArray invitationsArray;
-
-    for (const auto& invitation : invitations) {
-        QJsonObject invObj;
-        invObj["request_id"] = invitation.requestId;
-        invObj["user_id"] = QString::number(invitation.userId);
-        invObj["username"] = invitation.username;
-        invObj["status"] = invitation.status;
-        invObj["timestamp"] = invitation.timestamp.toMSecsSinceEpoch();
-        invitationsArray.append(invObj);
-    }
+    quint32 uid = userId;
+    runQuery<QVector<FriendInvitation>>([uid](DatabaseManager& db) {
+        return db.getReceivedInvitations(uid);
+    }, [this](QVector<FriendInvitation> invitations) {
+        QJsonArray invitationsArray;
+
+        for (const auto& invitation : invitations) {
+            QJsonObject invObj;
+            invObj["request_id"] = invitation.requestId;
+            invObj["user_id"] = QString::number(invitation.userId);
+            invObj["username"] = invitation.username;
+            invObj["status"] = invitation.status;
+            invObj["timestamp"] = invitation.timestamp.toMSecsSinceEpoch();
+            invitationsArray.append(invObj);
+        }
 
-    QJsonObject response{
-        {"type", Protocol::MessageType::RECEIVED_INVITATIONS_RESPONSE},
-        {"invitations", invitationsArray},
-        {"timestamp", QDateTime::currentMSecsSinceEpoch()}
-    };
+        QJsonObject response{
+            {"type", Protocol::MessageType::RECEIVED_INVITATIONS_RESPONSE},
+            {"invitations", invitationsArray},
+            {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+        };
 
-    qDebug() << "Sending received invitations response with" << invitationsArray.size() << "invitations";
-    sendResponse(QJsonDocument(response).toJson());
+        qDebug() << "Sending received invitations response with" << invitationsArray.size() << "invitations";
+        sendResponse(response);
+    });
 }
 
 void ClientSession::handleGetSentInvitations() {
-    auto invitations = dbManager->getSentInvitations(userId);
-    QJsonArray invitationsArray;
-
-    for (const auto& invitation : invitations) {
-        QJsonObject invObj;
-        invObj["request_id"] = invitation.requestId;
-        invObj["user_id"] = QString::number(invitation.userId);
-        invObj["username"] = invitation.username;
-        invObj["status"] = invitation.status;
-        invObj["timestamp"] = invitation.timestamp.toMSecsSinceEpoch();
-        invitationsArray.append(invObj);
-    }
+    quint32 uid = userId;
+    runQuery<QVector<FriendInvitation>>([uid](DatabaseManager& db) {
+        return db.getSentInvitations(uid);
+    }, [this](QVector<FriendInvitation> invitations) {
+        QJsonArray invitationsArray;
+
+        for (const auto& invitation : invitations) {
+            QJsonObject invObj;
+            invObj["request_id"] = invitation.requestId;
+            invObj["user_id"] = QString::number(invitation.userId);
+            invObj["username"] = invitation.username;
+            invObj["status"] = invitation.status;
+            invObj["timestamp"] = invitation.timestamp.toMSecsSinceEpoch();
+            invitationsArray.append(invObj);
+        }
 
-    QJsonObject response{
-        {"type", Protocol::MessageType::SENT_INVITATIONS_RESPONSE},
-        {"invitations", invitationsArray},
-        {"timestamp", QDateTime::currentMSecsSinceEpoch()}
-    };
+        QJsonObject response{
+            {"type", Protocol::MessageType::SENT_INVITATIONS_RESPONSE},
+            {"invitations", invitationsArray},
+            {"timestamp", QDateTime::currentMSecsSinceEpoch()}
+        };
 
-    qDebug() << "Sending sent invitations response with" << invitationsArray.size() << "invitations";
-    sendResponse(QJsonDocument(response).toJson());
+        qDebug() << "Sending sent invitations response with" << invitationsArray.size() << "invitations";
+        sendResponse(response);
+    });
 }
 
 void ClientSession::handleCancelFriendRequest(const QJsonObject& json) {
     int requestId = json["request_id"].toInt();
 
     if (requestId <= 0 || userId <= 0) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError(
-                                       "Invalid request ID")).toJson());
+        sendResponse(Protocol::MessageStructure::createError(
+            "Invalid request ID"));
         qWarning() << "Invalid cancel friend request received - requestId:" << requestId;
         return;
     }
 
-    quint32 targetUserId = dbManager->getFriendRequestTargetUserId(userId, requestId);
+    quint32 uid = userId;
+    runQuery<CancelRequestResult>([uid, requestId](DatabaseManager& db) {
+        CancelRequestResult result;
+        result.targetUserId = db.getFriendRequestTargetUserId(uid, requestId);
+        result.success = db.cancelFriendInvitation(uid, requestId);
+        return result;
+    }, [this, uid, requestId](CancelRequestResult result) {
+        if (result.success) {
+            QJsonObject response = Protocol::MessageStructure::createCancelFriendRequestResponse(
+                true, "Friend request cancelled successfully");
+            sendResponse(response);
 
-    if (dbManager->cancelFriendInvitation(userId, requestId)) {
-        QJsonObject response = Protocol::MessageStructure::createCancelFriendRequestResponse(
-            true, "Friend request cancelled successfully");
-        sendResponse(QJsonDocument(response).toJson());
-
-        if (targetUserId > 0) {
-            ClientSession* targetSession = ActiveSessions::getInstance().getSession(targetUserId);
-            if (targetSession) {
+            if (result.targetUserId > 0) {
                 QJsonObject notification = Protocol::MessageStructure::createFriendRequestCancelledNotification(
-                    requestId, userId);
-                targetSession->sendResponse(QJsonDocument(notification).toJson());
+                    requestId, uid);
+                ActiveSessions::getInstance().deliver(result.targetUserId, QJsonDocument(notification).toJson(),
+                                                      OutputClass::Notification);
             }
-        }
 
-        qDebug() << "Successfully cancelled friend request" << requestId
-                 << "from user" << userId << "to user" << targetUserId;
-    } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createCancelFriendRequestResponse(
-                                       false, "Failed to cancel friend request")).toJson());
-        qWarning() << "Failed to cancel friend request" << requestId << "for user" << userId;
-    }
+            qDebug() << "Successfully cancelled friend request" << requestId
+                     << "from user" << uid << "to user" << result.targetUserId;
+        } else {
+            sendResponse(Protocol::MessageStructure::createCancelFriendRequestResponse(
+                false, "Failed to cancel friend request"));
+            qWarning() << "Failed to cancel friend request" << requestId << "for user" << uid;
+        }
+    });
 }
 
 void ClientSession::handleFriendRequestAccept(const QJsonObject& json) {
     int requestId = json["request_id"].toInt();
 
     if (requestId <= 0 || userId <= 0) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError(
-                                       "Invalid request ID")).toJson());
+        sendResponse(Protocol::MessageStructure::createError(
+            "Invalid request ID"));
         return;
     }
 
-    if (dbManager->acceptFriendInvitation(userId, requestId)) {
-        QJsonObject response = Protocol::MessageStructure::createFriendRequestAcceptResponse(
-            true, "Friend request accepted successfully");
-        sendResponse(QJsonDocument(response).toJson());
+    quint32 uid = userId;
+    runQuery<AcceptRequestResult>([uid, requestId](DatabaseManager& db) {
+        AcceptRequestResult result;
 
-        auto invitations = dbManager->getReceivedInvitations(userId);
-        for (const auto& inv : invitations) {
+        // Nadawcę ustalamy przed akceptacją - potem zaproszenie nie jest już oczekujące
+        for (const auto& inv : db.getReceivedInvitations(uid)) {
             if (inv.requestId == requestId) {
-                ClientSession* otherUserSession = ActiveSessions::getInstance().getSession(inv.userId);
-                if (otherUserSession) {
-                    QJsonObject notification = Protocol::MessageStructure::createFriendRequestAcceptedNotification(
-                        userId,
-                        dbManager->getUserUsername(userId)
-                        );
-                    otherUserSession->sendResponse(QJsonDocument(notification).toJson());
-                    otherUserSession->handleFriendsListRequest();
-                }
+                result.inviterId = inv.userId;
                 break;
             }
         }
 
-        handleFriendsListRequest();
-    } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError(
-                                       "Failed to accept friend request")).toJson());
-    }
+        result.success = db.acceptFriendInvitation(uid, requestId);
+        if (result.success && result.inviterId > 0) {
+            result.username = db.getUserUsername(uid);
+        }
+        return result;
+    }, [this, uid](AcceptRequestResult result) {
+        if (result.success) {
+            QJsonObject response = Protocol::MessageStructure::createFriendRequestAcceptResponse(
+                true, "Friend request accepted successfully");
+            sendResponse(response);
+
+            if (result.inviterId > 0) {
+                QByteArray notification = QJsonDocument(
+                    Protocol::MessageStructure::createFriendRequestAcceptedNotification(
+                        uid, result.username)).toJson();
+                ActiveSessions::getInstance().post(result.inviterId, [notification](ClientSession* otherUserSession) {
+                    otherUserSession->deliver(notification, OutputClass::Notification);
+                    otherUserSession->handleFriendsListRequest();
+                });
+            }
+
+            handleFriendsListRequest();
+        } else {
+            sendResponse(Protocol::MessageStructure::createError(
+                "Failed to accept friend request"));
+        }
+    });
 }
 
 void ClientSession::handleFriendRequestReject(const QJsonObject& json) {
     int requestId = json["request_id"].toInt();
 
     if (requestId <= 0 || userId <= 0) {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError(
-                                       "Invalid request ID")).toJson());
+        sendResponse(Protocol::MessageStructure::createError(
+            "Invalid request ID"));
         return;
     }
 
-    if (dbManager->rejectFriendInvitation(userId, requestId)) {
-        QJsonObject response = Protocol::MessageStructure::createFriendRequestRejectResponse(
-            true, "Friend request rejected successfully");
-        sendResponse(QJsonDocument(response).toJson());
-    } else {
-        sendResponse(QJsonDocument(Protocol::MessageStructure::createError(
-                                       "Failed to reject friend request")).toJson());
-    }
+    quint32 uid = userId;
+    runQuery<bool>([uid, requestId](DatabaseManager& db) {
+        return db.rejectFriendInvitation(uid, requestId);
+    }, [this](bool rejected) {
+        if (rejected) {
+            QJsonObject response = Protocol::MessageStructure::createFriendRequestRejectResponse(
+                true, "Friend request rejected successfully");
+            sendResponse(response);
+        } else {
+            sendResponse(Protocol::MessageStructure::createError(
+                "Failed to reject friend request"));
+        }
+    });
 }
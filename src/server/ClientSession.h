@@ -10,10 +10,16 @@
 
 #include <QObject>
 #include <QTcpSocket>
-#include <QTimer>
 #include <QJsonObject>
 #include <QHash>
+#include <QPointer>
+#include <QJsonArray>
+#include <functional>
 #include "database/DatabaseManager.h"
+#include "network/FrameCodec.h"
+#include "OutputQueue.h"
+#include "TimingWheel.h"
+#include "DeliveryTracker.h"
 
 class DatabaseManager;
 
@@ -24,18 +30,37 @@ public:
     explicit ClientSession(QTcpSocket* socket, DatabaseManager* dbManager, QObject *parent = nullptr);
     ~ClientSession();
 
+    // Wysyła gotową odpowiedź do klienta tej sesji. Musi być wywołana w wątku
+    // sesji - z innych wątków należy korzystać z ActiveSessions::deliver().
+    void deliver(const QByteArray& response, OutputClass outputClass = OutputClass::Message,
+                 const QString& key = QString());
+
+    // Wstrzymuje wysyłanie do wywołania uncork(); odpowiedzi wygenerowane
+    // w tym czasie zostaną wysłane jednym zapisem. Wywołania mogą się zagnieżdżać.
+    void cork();
+    void uncork();
+
 private slots:
     void handleReadyRead();
     void handleError(QAbstractSocket::SocketError socketError);
-    void sendFriendsStatusUpdate();
     void checkConnectionStatus();
+    void flushOutput();
+    void handleBytesWritten(qint64 bytes);
+    void handleSlowConsumer();
 
 private:
-    void processMessage(const QByteArray& message);
-    void sendResponse(const QByteArray& response);
+    void processMessage(const QJsonObject& json);
+    void sendResponse(const QJsonObject& response,
+                      OutputClass outputClass = OutputClass::Response, const QString& key = QString());
+    void sendResponse(const QByteArray& response,
+                      OutputClass outputClass = OutputClass::Response, const QString& key = QString());
+    void writeFrame(const QByteArray& frame, OutputClass outputClass, const QString& key);
+    void scheduleFlush();
+    void updateBackpressure();
 
     // Handler methods
     void handleLogin(const QJsonObject& json);
+    void handleResume(const QJsonObject& json);
     void handleRegister(const QJsonObject& json);
     void handleLogout();
     void handleStatusRequest();
@@ -52,6 +77,8 @@ private:
     void handleGetLatestMessages(const QJsonObject& json);
     void handleGetChatHistory(const QJsonObject& json);
     void handleGetMoreHistory(const QJsonObject& json);
+    void sendHistoryPage(const QJsonObject& json, const QString& responseType);
+    void handleSync(const QJsonObject& json);
     void handleMessageRead(const QJsonObject& json);
     void handleAddFriendRequest(const QJsonObject& json);
     void handleGetReceivedInvitations();
@@ -59,13 +86,35 @@ private:
     void handleCancelFriendRequest(const QJsonObject& json);
     void handleFriendRequestAccept(const QJsonObject& json);
     void handleFriendRequestReject(const QJsonObject& json);
+    void handleSetFraming(const QJsonObject& json);
 
     void setUserId(quint32 id);
+    // Wspólne dla logowania i wznowienia: rejestruje sesję i otwiera okno doręczeń
+    DeliveryTracker::Resume beginSession(quint32 id);
+
+    // Terminy sesji obsługuje wspólne koło czasowe wątku
+    void scheduleLivenessCheck(qint64 delayMs);
+    void cancelTimer(TimingWheel::TimerId& timer);
+
+    // Wykonuje zapytanie w puli wątków bazy danych, a handler - w wątku sesji.
+    // Zapytanie nie może odwoływać się do sesji, tylko do przechwyconych wartości.
+    // Bez uruchomionej puli (np. w testach) oba kroki wykonują się synchronicznie
+    // na połączeniu przekazanego DatabaseManagera. Gdy zapytanie się nie wykona
+    // (baza niedostępna), zamiast handlera wywoływane jest onFailure, a klient
+    // dostaje błąd.
+    template<typename R>
+    void runQuery(std::function<R(DatabaseManager&)> query,
+                  std::function<void(R)> handler = {},
+                  std::function<void()> onFailure = {});
+    void queryFailed(const std::function<void()>& onFailure);
 
     // Helper methods
-    QJsonObject prepareFriendsListResponse();
+    void requestFriendsList(const std::function<void(const QJsonArray&)>& handler);
+    static QJsonArray buildFriendsArray(DatabaseManager& db, quint32 userId);
+    static QJsonArray friendsToJson(const QVector<QPair<quint32, QString>>& friendsList);
+    static QJsonArray unreadToJson(const QVector<QPair<quint32, int>>& unreadCounts);
     QJsonObject prepareStatusResponse();
-    QJsonObject prepareMessagesResponse();
+    QJsonObject prepareMessagesResponse(const QVector<ChatMessage>& messages);
 
     static constexpr int MAX_MISSED_PINGS = 3;
 
@@ -74,17 +123,44 @@ private:
     DatabaseManager* dbManager;
     quint32 userId;
     QString state;  // Obecny stan sesji
-    QString sessionConnectionName;
     bool isAuthenticated;
-    QTimer statusUpdateTimer;
-    QTimer messagesCheckTimer;
-    QTimer pingTimer;
-    qint64 lastPingTime;
+    QPointer<TimingWheel> wheel;
+    TimingWheel::TimerId livenessTimer = 0;
+    TimingWheel::TimerId graceTimer = 0;
+    qint64 lastActivity;  // ostatnie dane od klienta - każde potwierdzają, że połączenie żyje
     qint64 lastSentMessageId = 0;
-    int missedPings;
-    QHash<QString, QJsonObject> unconfirmedMessages;
-    QByteArray buffer;
-    QVector<ChatMessage> messages;
+    int missedPings;  // pingi wysłane bez żadnej odpowiedzi klienta
+    FrameCodec codec;
+    OutputQueue outputQueue;
+    int corkDepth;
+    bool flushScheduled;
+    // Dławienie wolnego klienta: ramki czekają w outputQueue, dopóki bufor
+    // socketu nie spadnie poniżej dolnego progu
+    bool throttled;
+    int socketFrames;  // ramki przekazane do socketu od ostatniego opróżnienia jego bufora
+
+    // Ostatnie wyszukiwanie w UsernameIndex
+    struct SearchCache {
+        QString query;  // postać UsernameIndex::key
+        bool prefix = false;
+        quint64 revision = 0;
+        bool complete = false;
+        QVector<UserSearchResult> candidates;
+    };
+    SearchCache lastSearch;
+};
+
+// RAII dla cork()/uncork()
+class OutputCork
+{
+public:
+    explicit OutputCork(ClientSession* session) : m_session(session) { session->cork(); }
+    ~OutputCork() { if (m_session) m_session->uncork(); }
+    OutputCork(const OutputCork&) = delete;
+    OutputCork& operator=(const OutputCork&) = delete;
+
+private:
+    QPointer<ClientSession> m_session;
 };
 
 #endif // CLIENTSESSION_H
@@ -0,0 +1,171 @@
+/**
+ * @file DeliveryTracker.cpp
+ * @brief Sequenced chat message delivery with cumulative client acknowledgements
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "DeliveryTracker.h"
+#include "ActiveSessions.h"
+#include "ServerConfig.h"
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QDebug>
+
+DeliveryTracker& DeliveryTracker::getInstance()
+{
+    static DeliveryTracker instance(ServerConfig::instance.delivery.windowSize,
+                                    ServerConfig::instance.delivery.idleTimeoutMs);
+    return instance;
+}
+
+DeliveryTracker::DeliveryTracker(int windowSize, qint64 idleTimeoutMs)
+    : m_windowSize(qMax(1, windowSize))
+    , m_idleTimeoutMs(qMax<qint64>(0, idleTimeoutMs))
+{
+    m_clock.start();
+}
+
+bool DeliveryTracker::deliver(quint32 userId, QJsonObject message)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_windows.find(userId);
+    if (it == m_windows.end()) {
+        return false;
+    }
+
+    Window& window = *it;
+    quint64 sequence = window.nextSequence++;
+    message["seq"] = static_cast<qint64>(sequence);
+    QByteArray payload = QJsonDocument(message).toJson(QJsonDocument::Compact);
+
+    window.entries.enqueue({sequence, payload});
+    if (window.entries.size() > m_windowSize) {
+        window.entries.dequeue();
+        ++m_stats.overflowDropped;
+    }
+    ++m_stats.delivered;
+
+    // Pod blokadą - doręczenia jednego odbiorcy trafiają do jego wątku w kolejności numerów
+    ActiveSessions::getInstance().deliver(userId, payload);
+    return true;
+}
+
+DeliveryTracker::Resume DeliveryTracker::resume(quint32 userId)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 now = m_clock.elapsed();
+    if (++m_operations % SWEEP_INTERVAL == 0) {
+        sweep(now);
+    }
+
+    auto it = m_windows.find(userId);
+    if (it != m_windows.end() && it->detachedAt >= 0 && now - it->detachedAt > m_idleTimeoutMs) {
+        m_windows.erase(it);
+        it = m_windows.end();
+    }
+
+    if (it == m_windows.end()) {
+        Window window;
+        window.epoch = QString::number(QRandomGenerator::global()->generate64(), 16);
+        it = m_windows.insert(userId, window);
+    }
+
+    it->detachedAt = -1;
+
+    Resume result;
+    result.epoch = it->epoch;
+    result.acked = it->acked;
+    result.pending.reserve(it->entries.size());
+    for (const Entry& entry : it->entries) {
+        result.pending.append(entry.payload);
+    }
+    m_stats.retransmitted += result.pending.size();
+    return result;
+}
+
+int DeliveryTracker::acknowledge(quint32 userId, quint64 sequence)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_windows.find(userId);
+    if (it == m_windows.end()) {
+        return 0;
+    }
+
+    // Potwierdzenie numeru, którego jeszcze nie nadano, jest błędem klienta
+    sequence = qMin(sequence, it->nextSequence - 1);
+    int removed = 0;
+    while (!it->entries.isEmpty() && it->entries.head().sequence <= sequence) {
+        it->entries.dequeue();
+        ++removed;
+    }
+    it->acked = qMax(it->acked, sequence);
+    m_stats.acknowledged += removed;
+    return removed;
+}
+
+void DeliveryTracker::detach(quint32 userId)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 now = m_clock.elapsed();
+    auto it = m_windows.find(userId);
+    if (it != m_windows.end()) {
+        it->detachedAt = now;
+    }
+    if (++m_operations % SWEEP_INTERVAL == 0) {
+        sweep(now);
+    }
+}
+
+void DeliveryTracker::release(quint32 userId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_windows.remove(userId);
+}
+
+void DeliveryTracker::sweep(qint64 now)
+{
+    for (auto it = m_windows.begin(); it != m_windows.end();) {
+        if (it->detachedAt >= 0 && now - it->detachedAt > m_idleTimeoutMs) {
+            it = m_windows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+int DeliveryTracker::unacked(quint32 userId) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_windows.constFind(userId);
+    return it != m_windows.constEnd() ? it->entries.size() : 0;
+}
+
+quint64 DeliveryTracker::lastSequence(quint32 userId) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_windows.constFind(userId);
+    return it != m_windows.constEnd() ? it->nextSequence - 1 : 0;
+}
+
+DeliveryTracker::Snapshot DeliveryTracker::snapshot() const
+{
+    QMutexLocker locker(&m_mutex);
+    Snapshot result = m_stats;
+    result.windows = m_windows.size();
+    for (const Window& window : m_windows) {
+        result.unacked += window.entries.size();
+    }
+    return result;
+}
+
+void DeliveryTracker::log() const
+{
+    Snapshot current = snapshot();
+    qInfo() << "Delivery: windows" << current.windows
+            << "unacked" << current.unacked
+            << "delivered" << current.delivered
+            << "acknowledged" << current.acknowledged
+            << "retransmitted" << current.retransmitted
+            << "overflow dropped" << current.overflowDropped;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file DeliveryTracker.h
+ * @brief Sequenced chat message delivery with cumulative client acknowledgements
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef DELIVERYTRACKER_H
+#define DELIVERYTRACKER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QVector>
+
+// Każdy zalogowany użytkownik ma okno doręczeń: wiadomości new_messages
+// dostają kolejne numery "seq" i czekają w oknie, aż klient potwierdzi je
+// zbiorczo (message_ack z "seq" = N potwierdza wszystko do N włącznie).
+// Okno przeżywa zerwanie połączenia przez idle_timeout_ms - wiadomości
+// z tego czasu i niepotwierdzone są wysyłane ponownie po zalogowaniu.
+// Nowe okno ma nową epokę; klient porównuje ją z poprzednią, żeby wiedzieć,
+// czy numeracja jest kontynuowana. Przepełnione okno traci najstarsze
+// wpisy - luka w numeracji oznacza, że trzeba pobrać historię.
+class DeliveryTracker
+{
+public:
+    struct Resume {
+        QString epoch;
+        quint64 acked = 0;              // ostatni potwierdzony numer
+        QVector<QByteArray> pending;    // niepotwierdzone, w kolejności numerów
+    };
+
+    struct Snapshot {
+        quint64 delivered = 0;
+        quint64 retransmitted = 0;
+        quint64 acknowledged = 0;
+        quint64 overflowDropped = 0;
+        int windows = 0;
+        int unacked = 0;
+    };
+
+    static DeliveryTracker& getInstance();
+
+    DeliveryTracker(int windowSize, qint64 idleTimeoutMs);
+
+    // Nadaje numer i doręcza przez ActiveSessions; false, gdy użytkownik nie ma
+    // okna (wiadomość czeka wtedy tylko w bazie jako nieprzeczytana)
+    bool deliver(quint32 userId, QJsonObject message);
+    // Logowanie: okno zostaje zachowane albo utworzone od nowa
+    Resume resume(quint32 userId);
+    int acknowledge(quint32 userId, quint64 sequence);
+    // Sesja zerwana - okno czeka idle_timeout_ms na powrót klienta
+    void detach(quint32 userId);
+    // Wylogowanie - okno jest usuwane od razu
+    void release(quint32 userId);
+
+    int unacked(quint32 userId) const;
+    quint64 lastSequence(quint32 userId) const;
+    Snapshot snapshot() const;
+    void log() const;
+
+private:
+    struct Entry {
+        quint64 sequence;
+        QByteArray payload;
+    };
+
+    struct Window {
+        QString epoch;
+        quint64 nextSequence = 1;
+        quint64 acked = 0;
+        QQueue<Entry> entries;
+        qint64 detachedAt = -1;  // -1 = sesja aktywna
+    };
+
+    static constexpr quint64 SWEEP_INTERVAL = 256;  // co tyle logowań/rozłączeń przegląd okien
+
+    void sweep(qint64 now);
+
+    const int m_windowSize;
+    const qint64 m_idleTimeoutMs;
+    QElapsedTimer m_clock;
+
+    mutable QMutex m_mutex;
+    QHash<quint32, Window> m_windows;
+    quint64 m_operations = 0;
+    Snapshot m_stats;
+};
+
+#endif // DELIVERYTRACKER_H
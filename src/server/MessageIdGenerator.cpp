@@ -0,0 +1,49 @@
+/**
+ * @file MessageIdGenerator.cpp
+ * @brief Monotonic 64-bit message ids generated without a database round trip
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "MessageIdGenerator.h"
+#include "ServerConfig.h"
+#include <QDateTime>
+#include <utility>
+
+MessageIdGenerator& MessageIdGenerator::getInstance()
+{
+    static MessageIdGenerator instance(ServerConfig::instance.nodeId);
+    return instance;
+}
+
+MessageIdGenerator::MessageIdGenerator(quint16 nodeId, std::function<qint64()> clock)
+    : m_nodeBits(quint64(qMin(nodeId, MAX_NODE_ID)) << SEQUENCE_BITS)
+    , m_clock(std::move(clock))
+{
+    if (!m_clock) {
+        m_clock = []() { return QDateTime::currentMSecsSinceEpoch(); };
+    }
+}
+
+quint64 MessageIdGenerator::next()
+{
+    quint64 now = (quint64(qMax<qint64>(0, m_clock() - EPOCH_MS)) << TIMESTAMP_SHIFT) | m_nodeBits;
+
+    // Bez blokady - wątki sesji rywalizują tylko o m_last
+    quint64 last = m_last.loadRelaxed();
+    forever {
+        quint64 candidate;
+        if (now > last) {
+            candidate = now;
+        } else if ((last & SEQUENCE_MASK) < SEQUENCE_MASK) {
+            candidate = last + 1;
+        } else {
+            // Licznik wyczerpany albo zegar cofnięty - następna milisekunda
+            candidate = (((last >> TIMESTAMP_SHIFT) + 1) << TIMESTAMP_SHIFT) | m_nodeBits;
+        }
+
+        if (m_last.testAndSetOrdered(last, candidate, last)) {
+            return candidate;
+        }
+    }
+}
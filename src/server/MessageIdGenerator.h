@@ -0,0 +1,50 @@
+/**
+ * @file MessageIdGenerator.h
+ * @brief Monotonic 64-bit message ids generated without a database round trip
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef MESSAGEIDGENERATOR_H
+#define MESSAGEIDGENERATOR_H
+
+#include <QAtomicInteger>
+#include <functional>
+
+// Identyfikator w stylu Snowflake:
+//  41 bitów - milisekundy od EPOCH_MS (wystarcza na ~69 lat),
+//  10 bitów - numer węzła ([Server] node_id),
+//  12 bitów - licznik w obrębie milisekundy.
+// Kolejne id jednego węzła rosną ściśle, także gdy zegar się cofnie lub
+// licznik się wyczerpie - wtedy generator zajmuje następną milisekundę.
+// Klienci dostają id jako tekst (JSON nie przenosi dokładnie liczb > 2^53).
+class MessageIdGenerator
+{
+public:
+    static constexpr qint64 EPOCH_MS = 1735689600000;  // 2025-01-01T00:00:00Z
+    static constexpr int NODE_BITS = 10;
+    static constexpr int SEQUENCE_BITS = 12;
+    static constexpr quint16 MAX_NODE_ID = (1 << NODE_BITS) - 1;
+
+    // Generator węzła z ServerConfig, tworzony przy pierwszym użyciu
+    static MessageIdGenerator& getInstance();
+
+    // clock - źródło milisekund epoki Unix (testy); domyślnie zegar systemowy
+    explicit MessageIdGenerator(quint16 nodeId, std::function<qint64()> clock = {});
+
+    quint64 next();
+
+    static qint64 timestampOf(quint64 id) { return qint64(id >> (NODE_BITS + SEQUENCE_BITS)) + EPOCH_MS; }
+    static quint16 nodeOf(quint64 id) { return quint16((id >> SEQUENCE_BITS) & MAX_NODE_ID); }
+    static quint16 sequenceOf(quint64 id) { return quint16(id & SEQUENCE_MASK); }
+
+private:
+    static constexpr quint64 SEQUENCE_MASK = (quint64(1) << SEQUENCE_BITS) - 1;
+    static constexpr int TIMESTAMP_SHIFT = NODE_BITS + SEQUENCE_BITS;
+
+    quint64 m_nodeBits;
+    std::function<qint64()> m_clock;
+    QAtomicInteger<quint64> m_last = 0;
+};
+
+#endif // MESSAGEIDGENERATOR_H
@@ -1,56 +1,79 @@
-// src/server/NotificationService.cpp
+/**
+ * @file NotificationService.cpp
+ * @brief Push delivery of presence changes to online friends
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
 #include "NotificationService.h"
+#include "ActiveSessions.h"
+#include "PresenceRegistry.h"
+#include "database/DatabaseManager.h"
+#include "database/FriendGraph.h"
+#include "database/DatabaseWorkerPool.h"
+#include "network/Protocol.h"
 #include <QJsonDocument>
 #include <QDebug>
 
-NotificationService::NotificationService(QSharedPointer<ConnectionManager> connectionManager, QObject* parent)
-    : QObject(parent)
-    , connectionManager(connectionManager)
+NotificationService& NotificationService::getInstance()
 {
+    static NotificationService instance;
+    return instance;
 }
 
-void NotificationService::notifyStatusChange(int userId, const QString& status)
+bool NotificationService::publishStatus(quint32 userId, const QString& status, DatabaseManager* db)
 {
-    QJsonObject notification{
-        {"type", "status_change"},
-        {"user_id", userId},
-        {"status", status}
-    };
-
-    for (auto socket : connectionManager->getFriendConnections(userId)) {
-        sendNotification(socket, notification);
+    PresenceRegistry& presence = PresenceRegistry::getInstance();
+    if (!presence.setStatus(userId, status)) {
+        return false;
     }
-}
 
-void NotificationService::notifyNewMessage(const Message& message)
-{
-    QJsonObject notification{
-        {"type", "new_message"},
-        {"sender_id", message.getSenderId()},
-        {"message", message.getContent()}
-    };
-
-    for (auto session : connectionManager->getConnectionsForUser(message.getReceiverId())) {
-        sendNotification(session, notification);
+    QString normalizedStatus = status.toLower();
+
+    // Lista znajomych z pamięci - rozsyłamy od razu, bez przechodzenia przez wątek bazy
+    const FriendGraph& graph = FriendGraph::getInstance();
+    if (graph.isLoaded()) {
+        notifyFriends(graph.friendsOf(userId), userId, normalizedStatus);
+        return true;
     }
+
+    DatabaseWorkerPool& pool = DatabaseWorkerPool::getInstance();
+    if (pool.isRunning()) {
+        pool.submit<bool>(userId, [userId, normalizedStatus](DatabaseManager& db) {
+            notifyFriends(friendIds(db, userId), userId, normalizedStatus);
+            return true;
+        });
+    } else if (db) {
+        notifyFriends(friendIds(*db, userId), userId, normalizedStatus);
+    }
+    return true;
 }
 
-void NotificationService::notifyFriendListUpdate(int userId, int friendId, bool added)
+QVector<quint32> NotificationService::friendIds(DatabaseManager& db, quint32 userId)
 {
-    QJsonObject notification{
-        {"type", "friend_list_update"},
-        {"friend_id", friendId},
-        {"action", added ? "added" : "removed"}
-    };
-
-    for (auto session : connectionManager->getConnectionsForUser(userId)) {
-        sendNotification(session, notification);
+    QVector<quint32> ids;
+    for (const auto& friend_ : db.getFriendsList(userId)) {
+        ids.append(friend_.first);
     }
+    return ids;
 }
 
-void NotificationService::sendNotification(ClientSession* session, const QJsonObject& notification)
+void NotificationService::notifyFriends(const QVector<quint32>& friendIds, quint32 userId,
+                                        const QString& status)
 {
-    if (session) {
-        session->sendResponse(notification);
+    QByteArray notification = QJsonDocument(
+        Protocol::MessageStructure::createFriendStatusChanged(userId, status)).toJson(QJsonDocument::Compact);
+    // Nowszy status tego samego znajomego zastępuje starszy, jeśli klient nie nadąża
+    QString key = Protocol::MessageType::FRIEND_STATUS_CHANGED + ':' + QString::number(userId);
+
+    ActiveSessions& sessions = ActiveSessions::getInstance();
+    int delivered = 0;
+    for (quint32 friendId : friendIds) {
+        if (sessions.deliver(friendId, notification, OutputClass::Presence, key)) {
+            ++delivered;
+        }
     }
+
+    qDebug() << "Status of user" << userId << "changed to" << status
+             << "- notified" << delivered << "online friends";
 }
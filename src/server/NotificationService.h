@@ -1,23 +1,40 @@
-// src/server/NotificationService.h
-#pragma once
+/**
+ * @file NotificationService.h
+ * @brief Push delivery of presence changes to online friends
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
 
-#include <QObject>
-#include <QJsonObject>
-#include <QSharedPointer>
-#include "ConnectionManager.h"
-#include "ClientSession.h"
+#ifndef NOTIFICATIONSERVICE_H
+#define NOTIFICATIONSERVICE_H
 
-class NotificationService : public QObject {
-    Q_OBJECT
+#include <QString>
+#include <QVector>
+
+class DatabaseManager;
+
+// Zmiana statusu trafia do PresenceRegistry i jest od razu rozsyłana
+// zalogowanym znajomym użytkownika jako friend_status_changed - klienci
+// nie muszą okresowo odpytywać o stan całej listy znajomych.
+class NotificationService
+{
 public:
-    explicit NotificationService(QSharedPointer<ConnectionManager> connectionManager, QObject* parent = nullptr);
+    static NotificationService& getInstance();
 
-public slots:
-    void notifyStatusChange(int userId, const QString& status);
-    void notifyNewMessage(const Message& message);
-    void notifyFriendListUpdate(int userId, int friendId, bool added);
+    // Ustawia status od razu i rozsyła go znajomym z FriendGraph; dopóki graf
+    // nie jest wczytany, listę znajomych pobiera w wątku bazy danych. Nie odwołuje
+    // się do sesji, więc może być wywołana także z destruktora. db jest używany
+    // tylko wtedy, gdy pula wątków bazy nie działa (np. w testach). Zwraca false
+    // dla nieprawidłowego statusu.
+    bool publishStatus(quint32 userId, const QString& status, DatabaseManager* db);
 
 private:
-    void sendNotification(ClientSession* session, const QJsonObject& notification); // Zmieniony typ parametru
-    QSharedPointer<ConnectionManager> connectionManager;
+    static QVector<quint32> friendIds(DatabaseManager& db, quint32 userId);
+    static void notifyFriends(const QVector<quint32>& friendIds, quint32 userId, const QString& status);
+
+    NotificationService() = default;
+    NotificationService(const NotificationService&) = delete;
+    NotificationService& operator=(const NotificationService&) = delete;
 };
+
+#endif // NOTIFICATIONSERVICE_H
@@ -0,0 +1,50 @@
+/**
+ * @file OutputQueue.cpp
+ * @brief Per-session queue of encoded frames waiting for the socket
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "OutputQueue.h"
+
+void OutputQueue::push(const QByteArray& frame, OutputClass outputClass, const QString& key)
+{
+    m_entries.append({frame, outputClass, key});
+    m_bytes += frame.size();
+}
+
+bool OutputQueue::replace(const QString& key, const QByteArray& frame)
+{
+    for (int i = 0; i < m_entries.size(); ++i) {
+        if (m_entries[i].key == key) {
+            Entry entry = m_entries.takeAt(i);
+            m_bytes += frame.size() - entry.frame.size();
+            entry.frame = frame;
+            m_entries.append(entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+QByteArray OutputQueue::takeAll()
+{
+    QByteArray batch;
+    if (m_entries.size() == 1) {
+        batch = m_entries.first().frame;
+    } else {
+        batch.reserve(m_bytes);
+        for (const Entry& entry : std::as_const(m_entries)) {
+            batch.append(entry.frame);
+        }
+    }
+
+    clear();
+    return batch;
+}
+
+void OutputQueue::clear()
+{
+    m_entries.clear();
+    m_bytes = 0;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file OutputQueue.h
+ * @brief Per-session queue of encoded frames waiting for the socket
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef OUTPUTQUEUE_H
+#define OUTPUTQUEUE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Klasa ramki decyduje, co się z nią dzieje, gdy klient nie nadąża z odbiorem
+enum class OutputClass {
+    Response,      // odpowiedź na żądanie klienta
+    Message,       // przekazana wiadomość czatu
+    Presence,      // stan znajomych - nowszy zastępuje starszy
+    Notification   // powiadomienie, które klient może odtworzyć zapytaniem
+};
+
+enum class OutputPolicy {
+    Queue,     // zawsze kolejkuj (po okresie karencji sesja zostaje rozłączona)
+    Coalesce,  // zastąp oczekującą ramkę o tym samym kluczu
+    Drop       // odrzuć, gdy sesja jest przyblokowana
+};
+
+class OutputQueue
+{
+public:
+    void push(const QByteArray& frame, OutputClass outputClass, const QString& key = QString());
+    // Zastępuje oczekującą ramkę o kluczu key (nowa trafia na koniec kolejki)
+    bool replace(const QString& key, const QByteArray& frame);
+    QByteArray takeAll();
+    void clear();
+
+    bool isEmpty() const { return m_entries.isEmpty(); }
+    int count() const { return m_entries.size(); }
+    qint64 bytes() const { return m_bytes; }
+
+private:
+    struct Entry {
+        QByteArray frame;
+        OutputClass outputClass;
+        QString key;
+    };
+
+    QList<Entry> m_entries;
+    qint64 m_bytes = 0;
+};
+
+#endif // OUTPUTQUEUE_H
@@ -0,0 +1,101 @@
+/**
+ * @file PresenceRegistry.cpp
+ * @brief In-memory presence of logged in users with write-behind to MySQL
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "PresenceRegistry.h"
+#include "database/DatabaseManager.h"
+#include "database/SyncVersions.h"
+#include "network/Protocol.h"
+#include <QDebug>
+
+PresenceRegistry& PresenceRegistry::getInstance()
+{
+    static PresenceRegistry instance;
+    return instance;
+}
+
+bool PresenceRegistry::isValidStatus(const QString& status)
+{
+    return status == Protocol::UserStatus::ONLINE
+           || status == Protocol::UserStatus::OFFLINE
+           || status == Protocol::UserStatus::AWAY
+           || status == Protocol::UserStatus::BUSY;
+}
+
+bool PresenceRegistry::setStatus(quint32 userId, const QString& status)
+{
+    QString normalizedStatus = status.toLower();
+    if (!isValidStatus(normalizedStatus)) {
+        qWarning() << "Invalid status value:" << status;
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (normalizedStatus == Protocol::UserStatus::OFFLINE) {
+        m_statuses.remove(userId);
+    } else {
+        m_statuses.insert(userId, normalizedStatus);
+    }
+    m_dirty.insert(userId, normalizedStatus);
+    locker.unlock();
+
+    SyncVersions::getInstance().presenceChanged(userId);
+    return true;
+}
+
+QString PresenceRegistry::status(quint32 userId) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_statuses.value(userId, Protocol::UserStatus::OFFLINE);
+}
+
+bool PresenceRegistry::isOnline(quint32 userId) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_statuses.contains(userId);
+}
+
+int PresenceRegistry::pendingWrites() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dirty.size();
+}
+
+bool PresenceRegistry::flush(DatabaseManager& db)
+{
+    QHash<quint32, QString> batch;
+    {
+        QMutexLocker locker(&m_mutex);
+        batch.swap(m_dirty);
+    }
+
+    if (batch.isEmpty()) {
+        return true;
+    }
+
+    if (db.updateUserStatuses(batch)) {
+        return true;
+    }
+
+    // Ponowimy przy następnym flush(); nowsze zmiany mają pierwszeństwo
+    QMutexLocker locker(&m_mutex);
+    for (auto it = batch.constBegin(); it != batch.constEnd(); ++it) {
+        if (!m_dirty.contains(it.key())) {
+            m_dirty.insert(it.key(), it.value());
+        }
+    }
+    return false;
+}
+
+bool PresenceRegistry::reconcile(DatabaseManager& db)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_statuses.clear();
+        m_dirty.clear();
+    }
+    return db.resetUserStatuses();
+}
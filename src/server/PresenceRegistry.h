@@ -0,0 +1,49 @@
+/**
+ * @file PresenceRegistry.h
+ * @brief In-memory presence of logged in users with write-behind to MySQL
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef PRESENCEREGISTRY_H
+#define PRESENCEREGISTRY_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+class DatabaseManager;
+
+// Źródło prawdy o statusie użytkowników. Odczyty nie dotykają bazy; zmiany
+// trafiają do users.status zbiorczo przy flush(), a kolejne zmiany statusu
+// tego samego użytkownika przed zapisem są scalane w jedną.
+class PresenceRegistry
+{
+public:
+    static PresenceRegistry& getInstance();
+
+    static bool isValidStatus(const QString& status);
+
+    bool setStatus(quint32 userId, const QString& status);
+    QString status(quint32 userId) const;
+    bool isOnline(quint32 userId) const;
+    int pendingWrites() const;
+
+    // Zapisuje zaległe zmiany jednym zapytaniem na paczkę; wywoływane w wątku bazy
+    bool flush(DatabaseManager& db);
+
+    // Stan po nieczystym zamknięciu: przy starcie nie ma żadnych sesji, więc
+    // wszyscy użytkownicy w bazie są offline
+    bool reconcile(DatabaseManager& db);
+
+private:
+    PresenceRegistry() = default;
+    PresenceRegistry(const PresenceRegistry&) = delete;
+    PresenceRegistry& operator=(const PresenceRegistry&) = delete;
+
+    mutable QMutex m_mutex;
+    QHash<quint32, QString> m_statuses;  // tylko użytkownicy inni niż offline
+    QHash<quint32, QString> m_dirty;
+};
+
+#endif // PRESENCEREGISTRY_H
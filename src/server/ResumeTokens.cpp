@@ -0,0 +1,141 @@
+/**
+ * @file ResumeTokens.cpp
+ * @brief Signed session resumption tokens validated without a database lookup
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "ResumeTokens.h"
+#include "ServerConfig.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+#include <QDebug>
+#include <utility>
+
+namespace {
+const QByteArray::Base64Options TOKEN_ENCODING =
+    QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals;
+
+QByteArray randomSecret()
+{
+    QByteArray secret(32, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32*>(secret.data()), secret.size() / 4);
+    return secret;
+}
+}
+
+ResumeTokens& ResumeTokens::getInstance()
+{
+    static ResumeTokens instance(
+        ServerConfig::instance.resume.secret.isEmpty()
+            ? randomSecret()
+            : ServerConfig::instance.resume.secret.toUtf8(),
+        ServerConfig::instance.resume.ttlMs);
+    return instance;
+}
+
+ResumeTokens::ResumeTokens(const QByteArray& secret, qint64 ttlMs, std::function<qint64()> clock)
+    : m_secret(secret)
+    , m_ttlMs(qMax<qint64>(1000, ttlMs))
+    , m_clock(std::move(clock))
+{
+    if (!m_clock) {
+        m_clock = []() { return QDateTime::currentMSecsSinceEpoch(); };
+    }
+}
+
+QByteArray ResumeTokens::sign(const QByteArray& payload) const
+{
+    return QMessageAuthenticationCode::hash(payload, m_secret, QCryptographicHash::Sha256);
+}
+
+QString ResumeTokens::issue(quint32 userId, const QString& deliveryEpoch, qint64* expiresAt)
+{
+    qint64 now = m_clock();
+    qint64 expires = now + m_ttlMs;
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << VERSION << userId << now << expires << deliveryEpoch;
+
+    if (expiresAt) {
+        *expiresAt = expires;
+    }
+    return QString::fromLatin1(payload.toBase64(TOKEN_ENCODING) + '.' + sign(payload).toBase64(TOKEN_ENCODING));
+}
+
+bool ResumeTokens::validate(const QString& token, Claims& claims) const
+{
+    int dot = token.indexOf('.');
+    if (dot <= 0) {
+        return false;
+    }
+
+    auto payload = QByteArray::fromBase64Encoding(token.left(dot).toLatin1(),
+                                                  TOKEN_ENCODING | QByteArray::AbortOnBase64DecodingErrors);
+    auto mac = QByteArray::fromBase64Encoding(token.mid(dot + 1).toLatin1(),
+                                              TOKEN_ENCODING | QByteArray::AbortOnBase64DecodingErrors);
+    if (!payload || !mac) {
+        return false;
+    }
+
+    // Porównanie w stałym czasie - czas odpowiedzi nie zdradza poprawnego prefiksu
+    QByteArray expected = sign(*payload);
+    if (mac->size() != expected.size()) {
+        return false;
+    }
+    char diff = 0;
+    for (int i = 0; i < expected.size(); ++i) {
+        diff |= expected[i] ^ mac->at(i);
+    }
+    if (diff != 0) {
+        return false;
+    }
+
+    QDataStream in(*payload);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint8 version = 0;
+    Claims parsed;
+    in >> version >> parsed.userId >> parsed.issuedAt >> parsed.expiresAt >> parsed.deliveryEpoch;
+    if (in.status() != QDataStream::Ok || version != VERSION || parsed.userId == 0) {
+        return false;
+    }
+
+    if (parsed.expiresAt <= m_clock()) {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_revokedBefore.constFind(parsed.userId);
+        // Ta sama milisekunda jest ważna - nowe logowanie tuż po wylogowaniu
+        // nie może unieważnić właśnie wydanego tokenu
+        if (it != m_revokedBefore.constEnd() && parsed.issuedAt < *it) {
+            return false;
+        }
+    }
+
+    claims = parsed;
+    return true;
+}
+
+void ResumeTokens::revoke(quint32 userId)
+{
+    qint64 now = m_clock();
+    QMutexLocker locker(&m_mutex);
+    m_revokedBefore[userId] = now;
+
+    // Wpisy starsze niż czas życia tokenu niczego już nie blokują
+    if (++m_revocations % REVOKE_SWEEP_INTERVAL == 0) {
+        for (auto it = m_revokedBefore.begin(); it != m_revokedBefore.end();) {
+            if (now - *it > m_ttlMs) {
+                it = m_revokedBefore.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
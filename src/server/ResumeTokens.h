@@ -0,0 +1,61 @@
+/**
+ * @file ResumeTokens.h
+ * @brief Signed session resumption tokens validated without a database lookup
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef RESUMETOKENS_H
+#define RESUMETOKENS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <functional>
+
+// Token wydawany przy logowaniu pozwala po zerwaniu połączenia wrócić do
+// sesji bez hasła: base64url(ładunek) "." base64url(HMAC-SHA256(ładunek)).
+// Ładunek: wersja, id użytkownika, czas wydania, czas wygaśnięcia i epoka
+// okna doręczeń z chwili wydania. Weryfikacja odbywa się w pamięci; tabela
+// user_sessions nie jest potrzebna. Wylogowanie unieważnia tokeny wydane
+// wcześniej, ale tylko na tym węźle - węzły ze wspólnym sekretem przyjmą
+// je do wygaśnięcia. Bez [Resume] secret sekret jest losowany przy starcie,
+// więc restart serwera unieważnia wszystkie tokeny.
+class ResumeTokens
+{
+public:
+    struct Claims {
+        quint32 userId = 0;
+        qint64 issuedAt = 0;      // ms epoki Unix
+        qint64 expiresAt = 0;
+        QString deliveryEpoch;
+    };
+
+    static ResumeTokens& getInstance();
+
+    // clock - źródło milisekund epoki Unix (testy); domyślnie zegar systemowy
+    ResumeTokens(const QByteArray& secret, qint64 ttlMs, std::function<qint64()> clock = {});
+
+    QString issue(quint32 userId, const QString& deliveryEpoch, qint64* expiresAt = nullptr);
+    // false dla tokenu podrobionego, uszkodzonego, przeterminowanego lub unieważnionego
+    bool validate(const QString& token, Claims& claims) const;
+    // Unieważnia tokeny użytkownika wydane przed tą chwilą
+    void revoke(quint32 userId);
+
+private:
+    static constexpr quint8 VERSION = 1;
+    static constexpr int REVOKE_SWEEP_INTERVAL = 1024;  // co tyle unieważnień przegląd listy
+
+    QByteArray sign(const QByteArray& payload) const;
+
+    const QByteArray m_secret;
+    const qint64 m_ttlMs;
+    std::function<qint64()> m_clock;
+
+    mutable QMutex m_mutex;
+    QHash<quint32, qint64> m_revokedBefore;  // tokeny wydane wcześniej są nieważne
+    int m_revocations = 0;
+};
+
+#endif // RESUMETOKENS_H
@@ -0,0 +1,127 @@
+/**
+ * @file SendDeduplicator.cpp
+ * @brief Per-user window of client idempotency keys for send_message
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "SendDeduplicator.h"
+#include "ServerConfig.h"
+
+SendDeduplicator& SendDeduplicator::getInstance()
+{
+    static SendDeduplicator instance(ServerConfig::instance.dedup.windowSize,
+                                     ServerConfig::instance.dedup.windowMs);
+    return instance;
+}
+
+SendDeduplicator::SendDeduplicator(int windowSize, qint64 windowMs)
+    : m_windowSize(qMax(1, windowSize))
+    , m_windowMs(qMax<qint64>(1, windowMs))
+{
+    m_clock.start();
+}
+
+SendDeduplicator::Claim SendDeduplicator::claim(quint32 userId, const QString& key, quint64 messageId)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 now = m_clock.elapsed();
+    Window& window = m_windows[userId];
+    evict(window, now);
+
+    auto existing = window.entries.constFind(key);
+    if (existing != window.entries.constEnd()) {
+        ++m_duplicates;
+        return {true, existing->messageId, existing->stored};
+    }
+
+    Entry entry;
+    entry.messageId = messageId;
+    entry.createdAt = now;
+    entry.promise = std::make_shared<QPromise<bool>>();
+    entry.stored = entry.promise->future();
+    entry.promise->start();
+
+    window.entries.insert(key, entry);
+    window.order.enqueue(key);
+    ++m_size;
+    if (window.entries.size() > m_windowSize) {
+        // Miejsca ustępuje najstarszy zakończony wpis; na niezakończone mogą
+        // czekać ponowienia, więc okno chwilowo rośnie ponad limit
+        for (auto it = window.order.begin(); it != window.order.end(); ++it) {
+            auto evicted = window.entries.constFind(*it);
+            if (evicted == window.entries.constEnd() || evicted->stored.isFinished()) {
+                m_size -= window.entries.remove(*it);
+                window.order.erase(it);
+                break;
+            }
+        }
+    }
+
+    // Okna użytkowników, którzy przestali wysyłać, czyścimy co jakiś czas
+    if (++m_claims % SWEEP_INTERVAL == 0) {
+        sweep(now);
+    }
+    return {false, messageId, entry.stored};
+}
+
+void SendDeduplicator::complete(quint32 userId, const QString& key, bool stored)
+{
+    QMutexLocker locker(&m_mutex);
+    auto windowIt = m_windows.find(userId);
+    if (windowIt == m_windows.end()) {
+        return;
+    }
+
+    auto it = windowIt->entries.find(key);
+    if (it == windowIt->entries.end()) {
+        return;  // wypadł z okna
+    }
+
+    it->promise->addResult(stored);
+    it->promise->finish();
+
+    if (!stored) {
+        windowIt->entries.erase(it);
+        windowIt->order.removeOne(key);
+        --m_size;
+        if (windowIt->entries.isEmpty()) {
+            m_windows.erase(windowIt);
+        }
+    }
+}
+
+void SendDeduplicator::evict(Window& window, qint64 now)
+{
+    while (!window.order.isEmpty()) {
+        auto it = window.entries.constFind(window.order.head());
+        if (it != window.entries.constEnd() && now - it->createdAt < m_windowMs) {
+            break;
+        }
+        m_size -= window.entries.remove(window.order.dequeue());
+    }
+}
+
+void SendDeduplicator::sweep(qint64 now)
+{
+    for (auto it = m_windows.begin(); it != m_windows.end();) {
+        evict(*it, now);
+        if (it->entries.isEmpty()) {
+            it = m_windows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+quint64 SendDeduplicator::duplicates() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_duplicates;
+}
+
+int SendDeduplicator::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file SendDeduplicator.h
+ * @brief Per-user window of client idempotency keys for send_message
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef SENDDEDUPLICATOR_H
+#define SENDDEDUPLICATOR_H
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QPromise>
+#include <QQueue>
+#include <QString>
+#include <memory>
+
+// Pamięta ostatnie klucze client_message_id każdego użytkownika razem z id
+// nadanym wiadomości i wynikiem zapisu. Ponowione wysłanie (np. po
+// ponownym połączeniu, w innej sesji) dostaje to samo potwierdzenie zamiast
+// drugiego zapisu. Okno użytkownika ma ograniczony rozmiar i wiek wpisów;
+// nieudany zapis zwalnia klucz, żeby ponowienie mogło się powieść.
+class SendDeduplicator
+{
+public:
+    struct Claim {
+        bool duplicate = false;
+        quint64 messageId = 0;  // przy duplikacie - id pierwszego wysłania
+        QFuture<bool> stored;   // wynik zapisu pierwszego wysłania
+    };
+
+    static SendDeduplicator& getInstance();
+
+    SendDeduplicator(int windowSize, qint64 windowMs);
+
+    // Pierwsze wystąpienie klucza rezerwuje go dla messageId
+    Claim claim(quint32 userId, const QString& key, quint64 messageId);
+    // Wywoływane po zapisie niezależnie od tego, czy sesja jeszcze istnieje
+    void complete(quint32 userId, const QString& key, bool stored);
+
+    quint64 duplicates() const;
+    int size() const;
+
+private:
+    struct Entry {
+        quint64 messageId = 0;
+        qint64 createdAt = 0;
+        std::shared_ptr<QPromise<bool>> promise;
+        QFuture<bool> stored;
+    };
+
+    // Wpisy w kolejności dodania - najstarszy jest pierwszy do usunięcia
+    struct Window {
+        QHash<QString, Entry> entries;
+        QQueue<QString> order;
+    };
+
+    static constexpr quint64 SWEEP_INTERVAL = 1024;  // co tyle rezerwacji przegląd wszystkich okien
+
+    void evict(Window& window, qint64 now);
+    void sweep(qint64 now);
+
+    const int m_windowSize;
+    const qint64 m_windowMs;
+    QElapsedTimer m_clock;
+
+    mutable QMutex m_mutex;
+    QHash<quint32, Window> m_windows;
+    int m_size = 0;
+    quint64 m_claims = 0;
+    quint64 m_duplicates = 0;
+};
+
+#endif // SENDDEDUPLICATOR_H
@@ -1,71 +1,125 @@
 #include "Server.h"
-#include "ClientSession.h"
-#include "database/DatabaseManager.h"
+#include "ServerWorker.h"
+#include "ServerConfig.h"
+#include <QThread>
+#include <QTcpSocket>
 #include <QDebug>
 
 Server::Server(QObject *parent)
-    : QObject(parent)
-    , m_server(std::make_unique<QTcpServer>(this))
-    , m_dbManager(std::make_unique<DatabaseManager>())
+    : QTcpServer(parent)
+    , m_nextWorker(0)
 {
 }
 
 Server::~Server()
 {
-    // Czyścimy sesje klientów
-    qDeleteAll(m_clientSessions);
-    m_clientSessions.clear();
+    stop();
 }
 
 bool Server::start(quint16 port)
 {
-    if (!m_server->listen(QHostAddress::Any, port)) {
-        qCritical() << "Server failed to start. Error:" << m_server->errorString();
+    startWorkers();
+
+    if (!listen(QHostAddress::Any, port)) {
+        qCritical() << "Server failed to start. Error:" << errorString();
+        stopWorkers();
         return false;
     }
 
-    connect(m_server.get(), &QTcpServer::newConnection,
-            this, &Server::handleNewConnection);
-
-    qInfo() << "Server is listening on port" << port;
+    qInfo() << "Server is listening on port" << port
+            << "with" << m_workers.size() << "worker threads";
     return true;
 }
 
 void Server::stop()
 {
-    if (m_server->isListening()) {
-        m_server->close();
-        qDeleteAll(m_clientSessions);
-        m_clientSessions.clear();
+    if (isListening()) {
+        close();
         qInfo() << "Server stopped";
     }
+    stopWorkers();
 }
 
-void Server::handleNewConnection()
+void Server::startWorkers()
 {
-    QTcpSocket *clientSocket = m_server->nextPendingConnection();
-    if (!clientSocket) {
+    if (!m_workers.isEmpty()) {
         return;
     }
 
-    qInfo() << "New client connected:" << clientSocket->peerAddress().toString();
+    int count = qMax(1, ServerConfig::instance.workerThreads > 0
+                            ? ServerConfig::instance.workerThreads
+                            : QThread::idealThreadCount());
 
-    // Tworzymy nową sesję i ustawiamy jej rodzica na clientSocket
-    ClientSession* session = new ClientSession(clientSocket, m_dbManager.get(), clientSocket);
+    for (int i = 0; i < count; ++i) {
+        QThread* thread = new QThread(this);
+        thread->setObjectName(QString("Worker_%1").arg(i));
 
-    connect(clientSocket, &QTcpSocket::disconnected,
-            this, &Server::handleClientDisconnected);
+        ServerWorker* worker = new ServerWorker(i);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::started, worker, &ServerWorker::initialize);
 
-    m_clientSessions.insert(clientSocket, session);
+        m_threads.append(thread);
+        m_workers.append(worker);
+        thread->start();
+    }
 }
 
-void Server::handleClientDisconnected()
+void Server::stopWorkers()
 {
-    QTcpSocket *clientSocket = qobject_cast<QTcpSocket*>(sender());
-    if (clientSocket) {
-        qInfo() << "Client disconnected:" << clientSocket->peerAddress().toString();
+    for (int i = 0; i < m_workers.size(); ++i) {
+        ServerWorker* worker = m_workers[i];
+        QThread* thread = m_threads[i];
+
+        // Sesje muszą zostać usunięte w wątku, w którym żyją
+        QMetaObject::invokeMethod(worker, &ServerWorker::shutdown, Qt::BlockingQueuedConnection);
+        thread->quit();
+        thread->wait();
+
+        delete worker;
+        delete thread;
+    }
+
+    m_workers.clear();
+    m_threads.clear();
+}
 
-        // Sesja zostanie usunięta automatycznie przez system rodzica Qt
-        m_clientSessions.remove(clientSocket);
+ServerWorker* Server::selectWorker()
+{
+    if (m_workers.isEmpty()) {
+        return nullptr;
     }
+
+    if (ServerConfig::instance.dispatchPolicy == ServerConfig::DispatchPolicy::RoundRobin) {
+        ServerWorker* worker = m_workers[m_nextWorker];
+        m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+        return worker;
+    }
+
+    // Najmniej obciążony worker; przy remisie rotujemy punkt startowy,
+    // żeby seria połączeń nie trafiała zawsze do pierwszego wątku
+    ServerWorker* best = nullptr;
+    for (int i = 0; i < m_workers.size(); ++i) {
+        ServerWorker* candidate = m_workers[(m_nextWorker + i) % m_workers.size()];
+        if (!best || candidate->sessionCount() < best->sessionCount()) {
+            best = candidate;
+        }
+    }
+    m_nextWorker = (m_nextWorker + 1) % m_workers.size();
+    return best;
+}
+
+void Server::incomingConnection(qintptr socketDescriptor)
+{
+    ServerWorker* worker = selectWorker();
+    if (!worker) {
+        qWarning() << "No worker available - rejecting connection";
+        QTcpSocket socket;
+        socket.setSocketDescriptor(socketDescriptor);
+        socket.abort();
+        return;
+    }
+
+    QMetaObject::invokeMethod(worker, [worker, socketDescriptor]() {
+        worker->handleConnection(socketDescriptor);
+    }, Qt::QueuedConnection);
 }
@@ -3,14 +3,12 @@
 
 #include <QObject>
 #include <QTcpServer>
-#include <QTcpSocket>
-#include <QHash>
-#include <memory>
+#include <QVector>
 
-class ClientSession;
-class DatabaseManager;
+class QThread;
+class ServerWorker;
 
-class Server : public QObject
+class Server : public QTcpServer
 {
     Q_OBJECT
 public:
@@ -20,14 +18,18 @@ public:
     bool start(quint16 port = 1234);
     void stop();
 
-private slots:
-    void handleNewConnection();
-    void handleClientDisconnected();
+protected:
+    // Zamiast tworzyć socket w wątku głównym przekazujemy deskryptor do workera
+    void incomingConnection(qintptr socketDescriptor) override;
 
 private:
-    std::unique_ptr<QTcpServer> m_server;
-    std::unique_ptr<DatabaseManager> m_dbManager;
-    QHash<QTcpSocket*, ClientSession*> m_clientSessions;  // Zmienione z QMap na QHash i unique_ptr na zwykły wskaźnik
+    void startWorkers();
+    void stopWorkers();
+    ServerWorker* selectWorker();
+
+    QVector<QThread*> m_threads;
+    QVector<ServerWorker*> m_workers;
+    int m_nextWorker;
 };
 
 #endif // SERVER_H
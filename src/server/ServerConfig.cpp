@@ -0,0 +1,112 @@
+/**
+ * @file ServerConfig.cpp
+ * @brief Runtime configuration of the server process
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "ServerConfig.h"
+#include <QSettings>
+#include <QFile>
+#include <QThread>
+#include <QDebug>
+
+ServerConfig ServerConfig::instance;
+
+namespace {
+
+OutputPolicy parsePolicy(const QString& value, OutputPolicy fallback)
+{
+    QString policy = value.toLower();
+    if (policy == "queue") {
+        return OutputPolicy::Queue;
+    }
+    if (policy == "coalesce") {
+        return OutputPolicy::Coalesce;
+    }
+    if (policy == "drop") {
+        return OutputPolicy::Drop;
+    }
+    if (!policy.isEmpty()) {
+        qWarning() << "Unknown output policy:" << value;
+    }
+    return fallback;
+}
+
+}
+
+OutputPolicy ServerConfig::Backpressure::policyFor(OutputClass outputClass) const
+{
+    switch (outputClass) {
+    case OutputClass::Message:
+        return messagePolicy;
+    case OutputClass::Presence:
+        return presencePolicy;
+    case OutputClass::Notification:
+        return notificationPolicy;
+    case OutputClass::Response:
+        break;
+    }
+    return OutputPolicy::Queue;  // odpowiedzi nigdy nie są odrzucane
+}
+
+bool ServerConfig::load(const QString& configPath)
+{
+    if (!QFile::exists(configPath)) {
+        qWarning() << "Server config not found:" << configPath << "- using defaults";
+        instance.workerThreads = QThread::idealThreadCount();
+        return false;
+    }
+
+    QSettings settings(configPath, QSettings::IniFormat);
+
+    instance.port = static_cast<quint16>(settings.value("Server/port", instance.port).toUInt());
+
+    int threads = settings.value("Server/worker_threads", 0).toInt();
+    instance.workerThreads = threads > 0 ? threads : QThread::idealThreadCount();
+
+    instance.maxFrameSize = qMax(1024, settings.value("Server/max_frame_size", instance.maxFrameSize).toInt());
+    instance.nodeId = static_cast<quint16>(qBound(0, settings.value("Server/node_id", instance.nodeId).toInt(), 1023));
+
+    instance.presenceFlushInterval = qMax(100, settings.value("Presence/flush_interval_ms",
+                                                              instance.presenceFlushInterval).toInt());
+
+    Backpressure& bp = instance.backpressure;
+    bp.highWatermarkBytes = settings.value("Backpressure/high_watermark_bytes", bp.highWatermarkBytes).toLongLong();
+    bp.lowWatermarkBytes = qMin(bp.highWatermarkBytes,
+                                settings.value("Backpressure/low_watermark_bytes", bp.lowWatermarkBytes).toLongLong());
+    bp.highWatermarkMessages = settings.value("Backpressure/high_watermark_messages", bp.highWatermarkMessages).toInt();
+    bp.lowWatermarkMessages = qMin(bp.highWatermarkMessages,
+                                   settings.value("Backpressure/low_watermark_messages", bp.lowWatermarkMessages).toInt());
+    bp.gracePeriod = settings.value("Backpressure/grace_period_ms", bp.gracePeriod).toInt();
+    bp.messagePolicy = parsePolicy(settings.value("Backpressure/message_policy").toString(), bp.messagePolicy);
+    bp.presencePolicy = parsePolicy(settings.value("Backpressure/presence_policy").toString(), bp.presencePolicy);
+    bp.notificationPolicy = parsePolicy(settings.value("Backpressure/notification_policy").toString(), bp.notificationPolicy);
+
+    Dedup& dedup = instance.dedup;
+    dedup.windowSize = qMax(1, settings.value("Dedup/window_size", dedup.windowSize).toInt());
+    dedup.windowMs = qMax<qint64>(1000, settings.value("Dedup/window_ms", dedup.windowMs).toLongLong());
+
+    Delivery& delivery = instance.delivery;
+    delivery.windowSize = qMax(1, settings.value("Delivery/window_size", delivery.windowSize).toInt());
+    delivery.idleTimeoutMs = qMax<qint64>(0, settings.value("Delivery/idle_timeout_ms", delivery.idleTimeoutMs).toLongLong());
+
+    instance.resume.secret = settings.value("Resume/secret").toString();
+    instance.resume.ttlMs = qMax<qint64>(1000, settings.value("Resume/ttl_ms", instance.resume.ttlMs).toLongLong());
+
+    QString policy = settings.value("Server/dispatch_policy", "least_loaded").toString().toLower();
+    if (policy == "round_robin") {
+        instance.dispatchPolicy = DispatchPolicy::RoundRobin;
+    } else {
+        if (policy != "least_loaded") {
+            qWarning() << "Unknown dispatch policy:" << policy << "- using least_loaded";
+        }
+        instance.dispatchPolicy = DispatchPolicy::LeastLoaded;
+    }
+
+    qInfo() << "Server config loaded: port" << instance.port
+            << "worker threads" << instance.workerThreads
+            << "dispatch policy" << policy
+            << "max frame size" << instance.maxFrameSize;
+    return true;
+}
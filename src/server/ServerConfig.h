@@ -0,0 +1,68 @@
+/**
+ * @file ServerConfig.h
+ * @brief Runtime configuration of the server process
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef SERVERCONFIG_H
+#define SERVERCONFIG_H
+
+#include <QString>
+#include "network/Protocol.h"
+#include "OutputQueue.h"
+
+struct ServerConfig {
+    // Sposób przydziału nowych połączeń do wątków roboczych
+    enum class DispatchPolicy {
+        RoundRobin,
+        LeastLoaded
+    };
+
+    quint16 port = 1234;
+    int workerThreads = 0;  // 0 = QThread::idealThreadCount()
+    DispatchPolicy dispatchPolicy = DispatchPolicy::LeastLoaded;
+    int maxFrameSize = Protocol::Framing::DEFAULT_MAX_FRAME_SIZE;  // bajty, w obu trybach ramkowania
+    int presenceFlushInterval = 1000;  // ms między zbiorczymi zapisami statusów do bazy
+    quint16 nodeId = 0;  // 0-1023, część identyfikatorów wiadomości; unikalny w klastrze
+
+    // Ograniczenie danych oczekujących na wysłanie do wolnego klienta (sekcja [Backpressure])
+    struct Backpressure {
+        qint64 highWatermarkBytes = 1024 * 1024;
+        qint64 lowWatermarkBytes = 256 * 1024;
+        int highWatermarkMessages = 1000;
+        int lowWatermarkMessages = 250;
+        int gracePeriod = 10000;  // ms powyżej progu, po których sesja jest rozłączana
+        OutputPolicy messagePolicy = OutputPolicy::Queue;
+        OutputPolicy presencePolicy = OutputPolicy::Coalesce;
+        OutputPolicy notificationPolicy = OutputPolicy::Drop;
+
+        OutputPolicy policyFor(OutputClass outputClass) const;
+    } backpressure;
+
+    // Okno kluczy client_message_id jednego użytkownika (sekcja [Dedup])
+    struct Dedup {
+        int windowSize = 256;
+        qint64 windowMs = 10 * 60 * 1000;
+    } dedup;
+
+    // Okno niepotwierdzonych wiadomości jednego użytkownika (sekcja [Delivery])
+    struct Delivery {
+        int windowSize = 500;
+        qint64 idleTimeoutMs = 5 * 60 * 1000;  // jak długo okno czeka na ponowne logowanie
+    } delivery;
+
+    // Tokeny wznowienia sesji (sekcja [Resume])
+    struct Resume {
+        QString secret;  // pusty = losowy przy każdym starcie; wspólny dla węzłów klastra
+        qint64 ttlMs = 24 * 60 * 60 * 1000;
+    } resume;
+
+    static ServerConfig instance;
+
+    // Wczytuje sekcje [Server], [Presence], [Backpressure], [Dedup], [Delivery] i [Resume] z pliku INI;
+    // brakujące wartości pozostają domyślne
+    static bool load(const QString& configPath);
+};
+
+#endif // SERVERCONFIG_H
@@ -0,0 +1,64 @@
+/**
+ * @file ServerWorker.cpp
+ * @brief Implementation of the ServerWorker class
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "ServerWorker.h"
+#include "ClientSession.h"
+#include <QTcpSocket>
+#include <QDebug>
+
+ServerWorker::ServerWorker(int index, QObject *parent)
+    : QObject(parent)
+    , m_index(index)
+    , m_sessionCount(0)
+{
+}
+
+ServerWorker::~ServerWorker()
+{
+    shutdown();
+}
+
+void ServerWorker::initialize()
+{
+    qDebug() << "Worker" << m_index << "initialized";
+}
+
+void ServerWorker::handleConnection(qintptr socketDescriptor)
+{
+    QTcpSocket* socket = new QTcpSocket();
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qWarning() << "Worker" << m_index << "failed to adopt socket:" << socket->errorString();
+        delete socket;
+        return;
+    }
+
+    qInfo() << "Worker" << m_index << "- new client connected:"
+            << socket->peerAddress().toString();
+
+    // Sesja przejmuje socket i usuwa go w destruktorze; zapytania
+    // wykonuje DatabaseWorkerPool, więc worker nie potrzebuje własnego połączenia
+    ClientSession* session = new ClientSession(socket, nullptr, this);
+    m_sessions.insert(session);
+    m_sessionCount.ref();
+
+    connect(socket, &QTcpSocket::disconnected, session, [this, session, socket]() {
+        qInfo() << "Worker" << m_index << "- client disconnected:"
+                << socket->peerAddress().toString();
+        if (m_sessions.remove(session)) {
+            m_sessionCount.deref();
+            session->deleteLater();
+        }
+    });
+}
+
+void ServerWorker::shutdown()
+{
+    const QSet<ClientSession*> sessions = m_sessions;
+    m_sessions.clear();
+    m_sessionCount.storeRelaxed(0);
+    qDeleteAll(sessions);
+}
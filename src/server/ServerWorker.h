@@ -0,0 +1,40 @@
+/**
+ * @file ServerWorker.h
+ * @brief Declaration of the ServerWorker class
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef SERVERWORKER_H
+#define SERVERWORKER_H
+
+#include <QObject>
+#include <QSet>
+#include <QAtomicInt>
+
+class ClientSession;
+
+// Obiekt żyjący we własnym wątku z własną pętlą zdarzeń.
+// Wszystkie sesje przydzielone do workera są tworzone i obsługiwane w jego wątku.
+class ServerWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ServerWorker(int index, QObject *parent = nullptr);
+    ~ServerWorker();
+
+    int index() const { return m_index; }
+    int sessionCount() const { return m_sessionCount.loadRelaxed(); }
+
+public slots:
+    void initialize();
+    void handleConnection(qintptr socketDescriptor);
+    void shutdown();
+
+private:
+    int m_index;
+    QAtomicInt m_sessionCount;
+    QSet<ClientSession*> m_sessions;
+};
+
+#endif // SERVERWORKER_H
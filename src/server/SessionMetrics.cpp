@@ -0,0 +1,53 @@
+/**
+ * @file SessionMetrics.cpp
+ * @brief Process-wide counters of session output backpressure
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "SessionMetrics.h"
+#include <QDebug>
+
+SessionMetrics& SessionMetrics::getInstance()
+{
+    static SessionMetrics instance;
+    return instance;
+}
+
+void SessionMetrics::sessionThrottled(quintptr session, quint32 userId)
+{
+    QMutexLocker locker(&m_mutex);
+    m_throttled.insert(session, userId);
+    ++m_throttleEvents;
+}
+
+void SessionMetrics::sessionReleased(quintptr session)
+{
+    QMutexLocker locker(&m_mutex);
+    m_throttled.remove(session);
+}
+
+SessionMetrics::Snapshot SessionMetrics::snapshot() const
+{
+    Snapshot result;
+    {
+        QMutexLocker locker(&m_mutex);
+        result.throttleEvents = m_throttleEvents;
+        result.throttledUsers = m_throttled.values();
+    }
+    result.droppedFrames = m_droppedFrames.loadRelaxed();
+    result.coalescedFrames = m_coalescedFrames.loadRelaxed();
+    result.slowConsumerDisconnects = m_slowConsumerDisconnects.loadRelaxed();
+    return result;
+}
+
+void SessionMetrics::log() const
+{
+    Snapshot current = snapshot();
+    qInfo() << "Sessions: throttled now" << current.throttledUsers.size()
+            << "users" << current.throttledUsers
+            << "throttle events" << current.throttleEvents
+            << "dropped" << current.droppedFrames
+            << "coalesced" << current.coalescedFrames
+            << "slow consumer disconnects" << current.slowConsumerDisconnects;
+}
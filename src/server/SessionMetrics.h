@@ -0,0 +1,50 @@
+/**
+ * @file SessionMetrics.h
+ * @brief Process-wide counters of session output backpressure
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef SESSIONMETRICS_H
+#define SESSIONMETRICS_H
+
+#include <QAtomicInteger>
+#include <QHash>
+#include <QMutex>
+
+class SessionMetrics
+{
+public:
+    struct Snapshot {
+        quint64 throttleEvents = 0;
+        quint64 droppedFrames = 0;
+        quint64 coalescedFrames = 0;
+        quint64 slowConsumerDisconnects = 0;
+        QList<quint32> throttledUsers;  // 0 = sesja niezalogowana
+    };
+
+    static SessionMetrics& getInstance();
+
+    void sessionThrottled(quintptr session, quint32 userId);
+    void sessionReleased(quintptr session);
+    void frameDropped() { m_droppedFrames.fetchAndAddRelaxed(1); }
+    void frameCoalesced() { m_coalescedFrames.fetchAndAddRelaxed(1); }
+    void slowConsumerDisconnected() { m_slowConsumerDisconnects.fetchAndAddRelaxed(1); }
+
+    Snapshot snapshot() const;
+    void log() const;
+
+private:
+    SessionMetrics() = default;
+    SessionMetrics(const SessionMetrics&) = delete;
+    SessionMetrics& operator=(const SessionMetrics&) = delete;
+
+    mutable QMutex m_mutex;
+    QHash<quintptr, quint32> m_throttled;
+    quint64 m_throttleEvents = 0;
+    QAtomicInteger<quint64> m_droppedFrames = 0;
+    QAtomicInteger<quint64> m_coalescedFrames = 0;
+    QAtomicInteger<quint64> m_slowConsumerDisconnects = 0;
+};
+
+#endif // SESSIONMETRICS_H
@@ -0,0 +1,150 @@
+/**
+ * @file TimingWheel.cpp
+ * @brief Hierarchical hashed timing wheel shared by the sessions of one thread
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "TimingWheel.h"
+#include <QThreadStorage>
+#include <utility>
+
+namespace {
+
+QThreadStorage<TimingWheel*> wheels;
+
+int slotIndex(int level, qint64 tick)
+{
+    if (level == 0) {
+        return static_cast<int>(tick & 0xFF);
+    }
+    return static_cast<int>((tick >> (8 + 6 * (level - 1))) & 0x3F);
+}
+
+}
+
+TimingWheel::TimingWheel(int tickMs, QObject *parent)
+    : QObject(parent)
+    , m_tickMs(qMax(1, tickMs))
+{
+    m_slots[0].resize(1 << ROOT_BITS);
+    for (int level = 1; level < LEVELS; ++level) {
+        m_slots[level].resize(1 << LEVEL_BITS);
+    }
+
+    m_clock.start();
+    m_ticker.setInterval(m_tickMs);
+    connect(&m_ticker, &QTimer::timeout, this, &TimingWheel::handleTick);
+}
+
+TimingWheel* TimingWheel::local()
+{
+    if (!wheels.hasLocalData()) {
+        wheels.setLocalData(new TimingWheel());
+    }
+    return wheels.localData();
+}
+
+TimingWheel::TimerId TimingWheel::schedule(qint64 delayMs, std::function<void()> callback)
+{
+    if (m_entries.isEmpty()) {
+        // Puste koło nie było przesuwane - doganiamy zegar bez przechodzenia pustych taktów
+        m_current = qMax(m_current, clockTick());
+        m_ticker.start();
+    }
+
+    qint64 ticks = qMax<qint64>(1, (delayMs + m_tickMs - 1) / m_tickMs);
+    TimerId id = ++m_nextId;
+    m_entries.insert(id, {m_current + ticks, std::move(callback)});
+    insert(id, m_current + ticks);
+    return id;
+}
+
+bool TimingWheel::cancel(TimerId id)
+{
+    bool removed = m_entries.remove(id) > 0;
+    if (m_entries.isEmpty()) {
+        m_ticker.stop();
+    }
+    return removed;
+}
+
+void TimingWheel::advance(int ticks)
+{
+    for (int i = 0; i < ticks; ++i) {
+        processTick();
+    }
+}
+
+void TimingWheel::handleTick()
+{
+    qint64 target = clockTick();
+    while (m_current < target && !m_entries.isEmpty()) {
+        processTick();
+    }
+
+    if (m_entries.isEmpty()) {
+        m_ticker.stop();
+    }
+}
+
+void TimingWheel::insert(TimerId id, qint64 deadline)
+{
+    // Terminy dalsze niż zasięg koła czekają w ostatnim slocie i są wstawiane ponownie
+    qint64 slotTick = qMin(deadline, m_current + MAX_DELTA - 1);
+    qint64 delta = slotTick - m_current;
+
+    int level = 0;
+    if (delta >= (qint64(1) << (ROOT_BITS + LEVEL_BITS))) {
+        level = 2;
+    } else if (delta >= (qint64(1) << ROOT_BITS)) {
+        level = 1;
+    }
+    m_slots[level][slotIndex(level, slotTick)].append(id);
+}
+
+void TimingWheel::cascade(int level, int index)
+{
+    const QList<TimerId> ids = std::exchange(m_slots[level][index], {});
+    for (TimerId id : ids) {
+        auto it = m_entries.constFind(id);
+        if (it != m_entries.constEnd()) {
+            insert(id, it->deadline);
+        }
+    }
+}
+
+void TimingWheel::processTick()
+{
+    ++m_current;
+
+    int index = slotIndex(0, m_current);
+    if (index == 0) {
+        int index1 = slotIndex(1, m_current);
+        cascade(1, index1);
+        if (index1 == 0) {
+            cascade(2, slotIndex(2, m_current));
+        }
+    }
+
+    const QList<TimerId> ids = std::exchange(m_slots[0][index], {});
+    for (TimerId id : ids) {
+        auto it = m_entries.find(id);
+        if (it == m_entries.end()) {
+            continue;  // anulowany
+        }
+        if (it->deadline > m_current) {
+            insert(id, it->deadline);
+            continue;
+        }
+
+        std::function<void()> callback = std::move(it->callback);
+        m_entries.erase(it);
+        callback();
+    }
+}
+
+qint64 TimingWheel::clockTick() const
+{
+    return m_clock.elapsed() / m_tickMs;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file TimingWheel.h
+ * @brief Hierarchical hashed timing wheel shared by the sessions of one thread
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <functional>
+
+// Terminy wszystkich sesji jednej pętli zdarzeń obsługuje jeden QTimer.
+// Poziom 0 ma 256 slotów po jednym takcie, poziomy 1-2 po 64 sloty
+// obejmujące cały poprzedni poziom; przy przejściu poziomu niższego przez
+// zero zawartość slotu wyższego poziomu jest rozkładana niżej.
+// Dodanie i anulowanie terminu jest O(1) niezależnie od liczby sesji.
+class TimingWheel : public QObject
+{
+    Q_OBJECT
+public:
+    using TimerId = quint64;
+
+    static constexpr int DEFAULT_TICK_MS = 100;
+
+    explicit TimingWheel(int tickMs = DEFAULT_TICK_MS, QObject *parent = nullptr);
+
+    // Koło bieżącego wątku, tworzone przy pierwszym użyciu
+    static TimingWheel* local();
+
+    // Callback jest wywoływany jednokrotnie w wątku koła; 0 = brak terminu
+    TimerId schedule(qint64 delayMs, std::function<void()> callback);
+    bool cancel(TimerId id);
+
+    int pending() const { return m_entries.size(); }
+    int tickMs() const { return m_tickMs; }
+
+    // Przesuwa czas koła o podaną liczbę taktów niezależnie od zegara
+    void advance(int ticks);
+
+private slots:
+    void handleTick();
+
+private:
+    static constexpr int LEVELS = 3;
+    static constexpr int ROOT_BITS = 8;
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr qint64 MAX_DELTA = qint64(1) << (ROOT_BITS + 2 * LEVEL_BITS);
+
+    struct Entry {
+        qint64 deadline;  // w taktach
+        std::function<void()> callback;
+    };
+
+    void insert(TimerId id, qint64 deadline);
+    void cascade(int level, int index);
+    void processTick();
+    qint64 clockTick() const;
+
+    int m_tickMs;
+    qint64 m_current = 0;
+    TimerId m_nextId = 0;
+    QElapsedTimer m_clock;
+    QTimer m_ticker;
+    QHash<TimerId, Entry> m_entries;
+    // Anulowane terminy znikają tylko z m_entries; ich identyfikatory
+    // są pomijane, gdy slot zostanie opróżniony
+    QVector<QList<TimerId>> m_slots[LEVELS];
+};
+
+#endif // TIMINGWHEEL_H
@@ -8,8 +8,10 @@
 #include "ClientSessionTest.h"
 #include "TestDatabaseQueries.h"
 #include "network/Protocol.h"
+#include "server/DeliveryTracker.h"
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QSignalSpy>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -164,6 +166,25 @@ void ClientSessionTest::testAuthentication()
     qDebug() << "[TEST] Authentication test completed successfully";
 }
 
+void ClientSessionTest::testBootstrapLogin()
+{
+    socket->clearResponses();
+
+    QJsonObject loginMsg = createLoginMessage("testuser", "testpass");
+    loginMsg["bootstrap"] = true;
+    socket->simulateReceive(QJsonDocument(loginMsg).toJson());
+    QVERIFY2(socket->waitForResponse(), "Timeout waiting for login response");
+
+    // Znajomi i nieprzeczytane w odpowiedzi na logowanie, bez osobnych ramek
+    QJsonObject response = QJsonDocument::fromJson(
+        socket->getResponse(Protocol::MessageType::LOGIN_RESPONSE)).object();
+    QCOMPARE(response["status"].toString(), QString("success"));
+    QVERIFY(response["friends"].isArray());
+    QVERIFY(response["unread"].isArray());
+    QVERIFY(socket->getResponse(Protocol::MessageType::FRIENDS_LIST_RESPONSE).isEmpty());
+    QVERIFY(socket->getResponse(Protocol::MessageType::UNREAD_FROM).isEmpty());
+}
+
 void ClientSessionTest::testMessageHandling()
 {
     quint32 userId;
@@ -273,22 +294,72 @@ void ClientSessionTest::testMessageAcknowledgement()
     socket->simulateReceive(QJsonDocument(chatMsg).toJson());
     QVERIFY2(socket->waitForResponse(), "Timeout waiting for chat message response");
 
-    // Pobierz ID wiadomości z odpowiedzi
-    QJsonDocument response = QJsonDocument::fromJson(socket->lastWrittenData);
-    QString messageId = response.object()["message_id"].toString();
-
-    socket->lastWrittenData.clear();
+    // Wiadomość do samego siebie wraca z numerem doręczenia
+    DeliveryTracker& tracker = DeliveryTracker::getInstance();
+    quint64 sequence = tracker.lastSequence(userId);
+    QVERIFY(sequence > 0);
+    QVERIFY(tracker.unacked(userId) > 0);
 
-    // Wyślij potwierdzenie
-    QJsonObject ackMsg = Protocol::MessageStructure::createMessageAck(messageId);
+    // Potwierdzenie zbiorcze - serwer nie odpowiada, okno się opróżnia
+    QJsonObject ackMsg = Protocol::MessageStructure::createDeliveryAck(sequence);
     socket->simulateReceive(QJsonDocument(ackMsg).toJson());
-    QVERIFY2(socket->waitForResponse(), "Timeout waiting for ack response");
+    QCoreApplication::processEvents();
+    QCOMPARE(tracker.unacked(userId), 0);
 
     qDebug() << QString("[%1] Message acknowledgement test passed for user %2")
                     .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss"))
                     .arg("piotrek-pl");
 }
 
+void ClientSessionTest::testSync()
+{
+    quint32 userId;
+    QVERIFY(dbManager->authenticateUser("testuser", "testpass", userId));
+
+    QJsonObject loginMsg = createLoginMessage("testuser", "testpass");
+    socket->simulateReceive(QJsonDocument(loginMsg).toJson());
+    QVERIFY2(socket->waitForResponse(), "Timeout waiting for login response");
+
+    QJsonObject chatMsg = createChatMessage(userId, "Sync message");
+    socket->simulateReceive(QJsonDocument(chatMsg).toJson());
+    QVERIFY2(socket->waitForResponse(), "Timeout waiting for chat message response");
+
+    // Pierwszy sync bez wersji - pełna lista znajomych i wiadomości od początku
+    socket->clearResponses();
+    QJsonObject syncMsg{
+        {"type", Protocol::MessageType::SYNC},
+        {"conversations", QJsonArray{QJsonObject{{"friend_id", static_cast<int>(userId)}, {"last_id", 0}}}}
+    };
+    socket->simulateReceive(QJsonDocument(syncMsg).toJson());
+    QVERIFY2(socket->waitForResponse(), "Timeout waiting for sync response");
+
+    QJsonObject first = QJsonDocument::fromJson(socket->getResponse(Protocol::MessageType::SYNC_RESPONSE)).object();
+    QVERIFY(first.contains("friends"));
+    QVERIFY(!first["version"].toString().isEmpty());
+    QJsonArray conversations = first["conversations"].toArray();
+    QCOMPARE(conversations.size(), 1);
+    QVERIFY(!conversations[0].toObject()["messages"].toArray().isEmpty());
+
+    // Drugi sync od zwróconego stanu - bez nowych wiadomości i bez pełnej listy
+    QJsonObject known = conversations[0].toObject();
+    socket->clearResponses();
+    syncMsg["version"] = first["version"];
+    syncMsg["conversations"] = QJsonArray{QJsonObject{
+        {"friend_id", static_cast<int>(userId)},
+        {"last_id", known["next_after_id"]},
+        {"read_id", known["read_id"]},
+        {"partner_read_id", known["partner_read_id"]}
+    }};
+    socket->simulateReceive(QJsonDocument(syncMsg).toJson());
+    QVERIFY2(socket->waitForResponse(), "Timeout waiting for sync response");
+
+    QJsonObject second = QJsonDocument::fromJson(socket->getResponse(Protocol::MessageType::SYNC_RESPONSE)).object();
+    QVERIFY(!second.contains("friends"));
+    QVERIFY(second.contains("presence"));
+    QVERIFY(second["conversations"].toArray().isEmpty());
+    QVERIFY(second["complete"].toBool());
+}
+
 // Helper methods
 QJsonObject ClientSessionTest::createLoginMessage(const QString& username, const QString& password)
 {
@@ -26,10 +26,12 @@ private slots:
 
     void testConnectionInitialization();
     void testAuthentication();
+    void testBootstrapLogin();
     void testMessageHandling();
     void testPingPongMechanism();
     void testStatusUpdate();
     void testMessageAcknowledgement();
+    void testSync();
 
 private:
     TestSocket* socket;
@@ -0,0 +1,108 @@
+/**
+ * @file FrameCodecTest.cpp
+ * @brief FrameCodec test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "FrameCodecTest.h"
+#include "network/FrameCodec.h"
+#include "network/Protocol.h"
+#include <QJsonDocument>
+#include <QtEndian>
+
+void FrameCodecTest::testJsonBraceInsideString()
+{
+    FrameCodec codec;
+    codec.append(R"({"type":"send_message","content":"a } b { \"}\" c"})");
+
+    FrameCodec::Result result = codec.next();
+    QCOMPARE(result.status, FrameCodec::Status::Frame);
+    QCOMPARE(result.message["content"].toString(), QString("a } b { \"}\" c"));
+    QCOMPARE(codec.next().status, FrameCodec::Status::Incomplete);
+}
+
+void FrameCodecTest::testJsonSplitAcrossReads()
+{
+    FrameCodec codec;
+    QByteArray data = QJsonDocument(Protocol::MessageStructure::createPing()).toJson();
+
+    codec.append(data.left(5));
+    QCOMPARE(codec.next().status, FrameCodec::Status::Incomplete);
+
+    codec.append(data.mid(5));
+    FrameCodec::Result result = codec.next();
+    QCOMPARE(result.status, FrameCodec::Status::Frame);
+    QCOMPARE(result.message["type"].toString(), Protocol::MessageType::PING);
+    QCOMPARE(codec.bufferedBytes(), 0);
+}
+
+void FrameCodecTest::testJsonMultipleFrames()
+{
+    FrameCodec codec;
+    codec.append("\n{\"type\":\"ping\"}  {\"type\":\"pong\"}{\"type\":");
+
+    QCOMPARE(codec.next().message["type"].toString(), Protocol::MessageType::PING);
+    QCOMPARE(codec.next().message["type"].toString(), Protocol::MessageType::PONG);
+    QCOMPARE(codec.next().status, FrameCodec::Status::Incomplete);
+}
+
+void FrameCodecTest::testJsonFrameTooLarge()
+{
+    FrameCodec codec(64);
+    codec.append("{\"content\":\"" + QByteArray(100, 'x'));
+
+    FrameCodec::Result result = codec.next();
+    QCOMPARE(result.status, FrameCodec::Status::Error);
+    QVERIFY(result.fatal);
+}
+
+void FrameCodecTest::testBinaryRoundTrip()
+{
+    FrameCodec encoder;
+    encoder.setMode(FrameCodec::Mode::Binary);
+    QJsonObject message = Protocol::MessageStructure::createMessage(7, "{ nawiasy }");
+    QByteArray frame = encoder.encode(message);
+
+    QCOMPARE(frame.size() - Protocol::Framing::HEADER_SIZE,
+             static_cast<int>(qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(frame.constData()))));
+
+    FrameCodec decoder;
+    decoder.setMode(FrameCodec::Mode::Binary);
+    decoder.append(frame.left(3));
+    QCOMPARE(decoder.next().status, FrameCodec::Status::Incomplete);
+    decoder.append(frame.mid(3) + frame);
+
+    for (int i = 0; i < 2; ++i) {
+        FrameCodec::Result result = decoder.next();
+        QCOMPARE(result.status, FrameCodec::Status::Frame);
+        QCOMPARE(result.message["content"].toString(), QString("{ nawiasy }"));
+    }
+    QCOMPARE(decoder.next().status, FrameCodec::Status::Incomplete);
+}
+
+void FrameCodecTest::testBinaryTypeFromHeader()
+{
+    FrameCodec codec;
+    codec.setMode(FrameCodec::Mode::Binary);
+    codec.append(codec.encode(QByteArray("{\"timestamp\":1}"),
+                              FrameCodec::typeId(Protocol::MessageType::PING)));
+
+    FrameCodec::Result result = codec.next();
+    QCOMPARE(result.status, FrameCodec::Status::Frame);
+    QCOMPARE(result.message["type"].toString(), Protocol::MessageType::PING);
+}
+
+void FrameCodecTest::testBinaryFrameTooLarge()
+{
+    FrameCodec codec(1024);
+    codec.setMode(FrameCodec::Mode::Binary);
+
+    QByteArray header(Protocol::Framing::HEADER_SIZE, '\0');
+    qToBigEndian<quint32>(4096, reinterpret_cast<uchar*>(header.data()));
+    codec.append(header);
+
+    FrameCodec::Result result = codec.next();
+    QCOMPARE(result.status, FrameCodec::Status::Error);
+    QVERIFY(result.fatal);
+}
@@ -0,0 +1,28 @@
+/**
+ * @file FrameCodecTest.h
+ * @brief FrameCodec test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef FRAMECODECTEST_H
+#define FRAMECODECTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class FrameCodecTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testJsonBraceInsideString();
+    void testJsonSplitAcrossReads();
+    void testJsonMultipleFrames();
+    void testJsonFrameTooLarge();
+    void testBinaryRoundTrip();
+    void testBinaryTypeFromHeader();
+    void testBinaryFrameTooLarge();
+};
+
+#endif // FRAMECODECTEST_H
@@ -0,0 +1,64 @@
+/**
+ * @file FriendGraphTest.cpp
+ * @brief FriendGraph test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "FriendGraphTest.h"
+#include "database/FriendGraph.h"
+
+void FriendGraphTest::testBuildSortsRows()
+{
+    FriendGraph graph;
+    QVERIFY(!graph.isLoaded());
+
+    graph.build({{2, 3}, {1, 3}, {1, 2}, {2, 1}, {1, 2}}, {{1, "test1"}, {2, "test2"}, {3, "test3"}});
+
+    QVERIFY(graph.isLoaded());
+    QCOMPARE(graph.friendsOf(1), QVector<quint32>({2, 3}));
+    QCOMPARE(graph.friendsOf(2), QVector<quint32>({1, 3}));
+    QVERIFY(graph.friendsOf(3).isEmpty());
+    QVERIFY(graph.areFriends(2, 3));
+    QVERIFY(!graph.areFriends(3, 2));
+    QCOMPARE(graph.username(3), QString("test3"));
+    QCOMPARE(graph.edgeCount(), 4);
+}
+
+void FriendGraphTest::testOverlayChanges()
+{
+    FriendGraph graph;
+    graph.build({{1, 2}, {1, 4}}, {});
+
+    graph.addFriend(1, 3, "test3");
+    graph.removeFriend(1, 4);
+    QCOMPARE(graph.friendsOf(1), QVector<quint32>({2, 3}));
+    QCOMPARE(graph.pendingChanges(), 2);
+
+    // Cofnięcie zmiany usuwa ją z nakładki
+    graph.addFriend(1, 4, QString());
+    graph.removeFriend(1, 3);
+    QCOMPARE(graph.friendsOf(1), QVector<quint32>({2, 4}));
+    QCOMPARE(graph.pendingChanges(), 0);
+
+    graph.addFriend(5, 1, "test1");
+    QVERIFY(graph.areFriends(5, 1));
+    QCOMPARE(graph.username(3), QString("test3"));
+}
+
+void FriendGraphTest::testCompaction()
+{
+    FriendGraph graph;
+    graph.build({{1, 2}}, {});
+
+    const quint32 added = FriendGraph::COMPACT_THRESHOLD + 1;
+    for (quint32 i = 0; i < added; ++i) {
+        graph.addFriend(100 + i, 1, QString());
+    }
+    graph.removeFriend(1, 2);
+
+    QCOMPARE(graph.pendingChanges(), 1);
+    QVERIFY(graph.friendsOf(1).isEmpty());
+    QCOMPARE(graph.friendsOf(100), QVector<quint32>({1}));
+    QCOMPARE(graph.edgeCount(), static_cast<int>(added));
+}
@@ -0,0 +1,24 @@
+/**
+ * @file FriendGraphTest.h
+ * @brief FriendGraph test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef FRIENDGRAPHTEST_H
+#define FRIENDGRAPHTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class FriendGraphTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testBuildSortsRows();
+    void testOverlayChanges();
+    void testCompaction();
+};
+
+#endif // FRIENDGRAPHTEST_H
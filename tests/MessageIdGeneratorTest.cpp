@@ -0,0 +1,62 @@
+/**
+ * @file MessageIdGeneratorTest.cpp
+ * @brief MessageIdGenerator test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "MessageIdGeneratorTest.h"
+#include "server/MessageIdGenerator.h"
+
+void MessageIdGeneratorTest::testLayout()
+{
+    qint64 now = MessageIdGenerator::EPOCH_MS + 123456;
+    MessageIdGenerator generator(5, [&now]() { return now; });
+
+    quint64 first = generator.next();
+    QCOMPARE(MessageIdGenerator::timestampOf(first), now);
+    QCOMPARE(MessageIdGenerator::nodeOf(first), quint16(5));
+    QCOMPARE(MessageIdGenerator::sequenceOf(first), quint16(0));
+
+    quint64 second = generator.next();
+    QCOMPARE(second, first + 1);
+    QCOMPARE(MessageIdGenerator::sequenceOf(second), quint16(1));
+
+    now += 1;
+    quint64 third = generator.next();
+    QCOMPARE(MessageIdGenerator::timestampOf(third), now);
+    QCOMPARE(MessageIdGenerator::sequenceOf(third), quint16(0));
+}
+
+void MessageIdGeneratorTest::testSequenceExhaustion()
+{
+    const qint64 now = MessageIdGenerator::EPOCH_MS + 1000;
+    MessageIdGenerator generator(MessageIdGenerator::MAX_NODE_ID, [now]() { return now; });
+
+    quint64 previous = 0;
+    for (int i = 0; i < (1 << MessageIdGenerator::SEQUENCE_BITS); ++i) {
+        quint64 id = generator.next();
+        QVERIFY(id > previous);
+        previous = id;
+    }
+    QCOMPARE(MessageIdGenerator::sequenceOf(previous), quint16((1 << MessageIdGenerator::SEQUENCE_BITS) - 1));
+
+    // Licznik nie przelewa się na bity węzła - generator zajmuje następną milisekundę
+    quint64 next = generator.next();
+    QVERIFY(next > previous);
+    QCOMPARE(MessageIdGenerator::timestampOf(next), now + 1);
+    QCOMPARE(MessageIdGenerator::nodeOf(next), MessageIdGenerator::MAX_NODE_ID);
+    QCOMPARE(MessageIdGenerator::sequenceOf(next), quint16(0));
+}
+
+void MessageIdGeneratorTest::testClockGoesBack()
+{
+    qint64 now = MessageIdGenerator::EPOCH_MS + 50000;
+    MessageIdGenerator generator(1, [&now]() { return now; });
+
+    quint64 before = generator.next();
+    now -= 10000;
+    quint64 after = generator.next();
+    QVERIFY(after > before);
+    QCOMPARE(MessageIdGenerator::nodeOf(after), quint16(1));
+}
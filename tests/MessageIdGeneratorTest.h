@@ -0,0 +1,24 @@
+/**
+ * @file MessageIdGeneratorTest.h
+ * @brief MessageIdGenerator test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef MESSAGEIDGENERATORTEST_H
+#define MESSAGEIDGENERATORTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class MessageIdGeneratorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testLayout();
+    void testSequenceExhaustion();
+    void testClockGoesBack();
+};
+
+#endif // MESSAGEIDGENERATORTEST_H
@@ -0,0 +1,82 @@
+/**
+ * @file MessageJournalTest.cpp
+ * @brief MessageJournal test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "MessageJournalTest.h"
+#include "database/MessageJournal.h"
+#include <QTemporaryDir>
+
+namespace {
+
+MessageJournal::Record makeRecord(quint64 sequence, const QString& text)
+{
+    MessageJournal::Record record;
+    record.sequence = sequence;
+    record.message.senderId = 1;
+    record.message.receiverId = 2;
+    record.message.message = text;
+    record.message.sentAt = QDateTime::fromMSecsSinceEpoch(1760000000000 + sequence);
+    record.message.globalId = (quint64(1) << 40) + sequence;
+    return record;
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+}
+
+void MessageJournalTest::testCrc32()
+{
+    // Wartość kontrolna CRC-32/ISO-HDLC
+    QCOMPARE(MessageJournal::crc32("123456789"), quint32(0xCBF43926));
+    QCOMPARE(MessageJournal::crc32(QByteArray()), quint32(0));
+}
+
+void MessageJournalTest::testRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("segment.log");
+
+    QByteArray data = MessageJournal::encode(makeRecord(1, "Cześć"))
+                      + MessageJournal::encode(makeRecord(2, "Hello"));
+    QVERIFY(writeFile(path, data));
+
+    qint64 validBytes = 0;
+    QVector<MessageJournal::Record> records = MessageJournal::readSegment(path, validBytes);
+    QCOMPARE(records.size(), 2);
+    QCOMPARE(validBytes, qint64(data.size()));
+    QCOMPARE(records[0].sequence, quint64(1));
+    QCOMPARE(records[0].message.message, QString("Cześć"));
+    QCOMPARE(records[1].message.sentAt, QDateTime::fromMSecsSinceEpoch(1760000000002));
+    QCOMPARE(records[1].message.receiverId, quint32(2));
+    QCOMPARE(records[1].message.globalId, (quint64(1) << 40) + 2);
+}
+
+void MessageJournalTest::testDamagedTail()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("segment.log");
+
+    QByteArray first = MessageJournal::encode(makeRecord(1, "first"));
+    QByteArray second = MessageJournal::encode(makeRecord(2, "second"));
+
+    // Przerwany zapis - drugi rekord bez końcówki
+    QVERIFY(writeFile(path, first + second.left(second.size() - 3)));
+    qint64 validBytes = 0;
+    QCOMPARE(MessageJournal::readSegment(path, validBytes).size(), 1);
+    QCOMPARE(validBytes, qint64(first.size()));
+
+    // Uszkodzony ładunek - suma kontrolna się nie zgadza
+    second[second.size() - 1] = second.at(second.size() - 1) ^ 0x01;
+    QVERIFY(writeFile(path, first + second + MessageJournal::encode(makeRecord(3, "third"))));
+    QCOMPARE(MessageJournal::readSegment(path, validBytes).size(), 1);
+    QCOMPARE(validBytes, qint64(first.size()));
+}
@@ -0,0 +1,24 @@
+/**
+ * @file MessageJournalTest.h
+ * @brief MessageJournal test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef MESSAGEJOURNALTEST_H
+#define MESSAGEJOURNALTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class MessageJournalTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testCrc32();
+    void testRoundTrip();
+    void testDamagedTail();
+};
+
+#endif // MESSAGEJOURNALTEST_H
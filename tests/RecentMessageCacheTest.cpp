@@ -0,0 +1,122 @@
+/**
+ * @file RecentMessageCacheTest.cpp
+ * @brief RecentMessageCache test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "RecentMessageCacheTest.h"
+#include "database/RecentMessageCache.h"
+
+namespace {
+
+// Identyfikatory rozmów spoza zakresu bazy testowej - ConversationHeads ich nie zna
+constexpr qint64 CONVERSATION = 900001;
+
+QVector<RecentMessageCache::Message> newestFirst(qint64 from, qint64 to, quint32 senderId)
+{
+    QVector<RecentMessageCache::Message> messages;
+    for (qint64 id = to; id >= from; --id) {
+        messages.append({id, senderId, QString("message %1").arg(id), QDateTime()});
+    }
+    return messages;
+}
+
+}
+
+void RecentMessageCacheTest::testLoadAndAppend()
+{
+    RecentMessageCache cache(5, 1024 * 1024);
+    QVector<ChatMessage> messages;
+    QVERIFY(!cache.latest(CONVERSATION, 3, messages));
+
+    // Trzy wiadomości, mniej niż pojemność - bufor zna całą rozmowę
+    messages = cache.load(CONVERSATION, newestFirst(1, 3, 1), {{1, "alice"}, {2, "bob"}}, {}, true, 2);
+    QCOMPARE(messages.size(), 2);
+    QCOMPARE(messages.first().id, qint64(2));
+    QCOMPARE(messages.last().username, QString("alice"));
+
+    QVERIFY(cache.latest(CONVERSATION, 5, messages));
+    QCOMPARE(messages.size(), 3);
+    bool older = true;
+    QVERIFY(cache.hasBefore(CONVERSATION, 1, older));
+    QVERIFY(!older);
+
+    // Po przepełnieniu bufor przestaje sięgać początku rozmowy
+    for (qint64 id = 4; id <= 7; ++id) {
+        cache.append(CONVERSATION, {id, 2, "reply", QDateTime()});
+    }
+    QVERIFY(cache.latest(CONVERSATION, 5, messages));
+    QCOMPARE(messages.first().id, qint64(3));
+    QCOMPARE(messages.last().id, qint64(7));
+    QCOMPARE(messages.last().username, QString("bob"));
+    QVERIFY(cache.hasBefore(CONVERSATION, 3, older) == false);
+    QVERIFY(!cache.latest(CONVERSATION, 6, messages));
+}
+
+void RecentMessageCacheTest::testReadState()
+{
+    RecentMessageCache cache(10, 1024 * 1024);
+    QVector<RecentMessageCache::Message> rows{
+        {3, 2, "from bob", QDateTime()},
+        {2, 1, "from alice", QDateTime()},
+        {1, 1, "from alice", QDateTime()}
+    };
+    cache.load(CONVERSATION, rows, {{1, "alice"}, {2, "bob"}}, {{1, 0}, {2, 1}}, true, 10);
+
+    // Wiadomość jest przeczytana, gdy obejmuje ją kursor drugiego uczestnika
+    QVector<ChatMessage> messages;
+    QVERIFY(cache.latest(CONVERSATION, 10, messages));
+    QVERIFY(messages[0].isRead);
+    QVERIFY(!messages[1].isRead);
+    QVERIFY(!messages[2].isRead);
+
+    cache.advanceCursor(CONVERSATION, 2, 2);
+    cache.advanceCursor(CONVERSATION, 1, 3);
+    cache.advanceCursor(CONVERSATION, 2, 1);  // kursor się nie cofa
+    QVERIFY(cache.latest(CONVERSATION, 10, messages));
+    QVERIFY(messages[1].isRead);
+    QVERIFY(messages[2].isRead);
+}
+
+void RecentMessageCacheTest::testGapInvalidates()
+{
+    RecentMessageCache cache(10, 1024 * 1024);
+    cache.load(CONVERSATION, newestFirst(1, 2, 1), {{1, "alice"}}, {}, true, 10);
+
+    // Powtórzona wiadomość jest pomijana, luka usuwa rozmowę z pamięci
+    cache.append(CONVERSATION, {2, 1, "duplicate", QDateTime()});
+    QVector<ChatMessage> messages;
+    QVERIFY(cache.latest(CONVERSATION, 10, messages));
+    QCOMPARE(messages.size(), 2);
+
+    cache.append(CONVERSATION, {4, 1, "after gap", QDateTime()});
+    QVERIFY(!cache.latest(CONVERSATION, 10, messages));
+
+    // Nadawca bez nazwy w buforze też wymaga ponownego wczytania
+    cache.load(CONVERSATION, newestFirst(1, 2, 1), {{1, "alice"}}, {}, true, 10);
+    cache.append(CONVERSATION, {3, 2, "from bob", QDateTime()});
+    QVERIFY(!cache.latest(CONVERSATION, 10, messages));
+    QCOMPARE(cache.snapshot().invalidations, quint64(2));
+}
+
+void RecentMessageCacheTest::testBudgetEviction()
+{
+    // Budżet na mniej więcej dwie rozmowy - trzecia wypycha najdawniej czytaną
+    RecentMessageCache probe(4, 1024 * 1024);
+    probe.load(CONVERSATION, newestFirst(1, 4, 1), {{1, "alice"}}, {}, true, 4);
+    qint64 perConversation = probe.snapshot().bytes;
+
+    RecentMessageCache cache(4, perConversation * 2 + perConversation / 2);
+    cache.load(CONVERSATION, newestFirst(1, 4, 1), {{1, "alice"}}, {}, true, 4);
+    cache.load(CONVERSATION + 1, newestFirst(1, 4, 1), {{1, "alice"}}, {}, true, 4);
+
+    QVector<ChatMessage> messages;
+    QVERIFY(cache.latest(CONVERSATION, 4, messages));  // pierwsza staje się najświeższa
+
+    cache.load(CONVERSATION + 2, newestFirst(1, 4, 1), {{1, "alice"}}, {}, true, 4);
+    QCOMPARE(cache.snapshot().conversations, 2);
+    QVERIFY(cache.latest(CONVERSATION, 4, messages));
+    QVERIFY(!cache.latest(CONVERSATION + 1, 4, messages));
+    QVERIFY(cache.latest(CONVERSATION + 2, 4, messages));
+}
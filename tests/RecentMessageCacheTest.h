@@ -0,0 +1,25 @@
+/**
+ * @file RecentMessageCacheTest.h
+ * @brief RecentMessageCache test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef RECENTMESSAGECACHETEST_H
+#define RECENTMESSAGECACHETEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class RecentMessageCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testLoadAndAppend();
+    void testReadState();
+    void testGapInvalidates();
+    void testBudgetEviction();
+};
+
+#endif // RECENTMESSAGECACHETEST_H
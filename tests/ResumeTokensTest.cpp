@@ -0,0 +1,81 @@
+/**
+ * @file ResumeTokensTest.cpp
+ * @brief ResumeTokens test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "ResumeTokensTest.h"
+#include "server/ResumeTokens.h"
+
+void ResumeTokensTest::testRoundTrip()
+{
+    qint64 now = 1760000000000;
+    ResumeTokens tokens("secret", 60000, [&now]() { return now; });
+
+    qint64 expiresAt = 0;
+    QString token = tokens.issue(42, "abc", &expiresAt);
+    QCOMPARE(expiresAt, now + 60000);
+
+    ResumeTokens::Claims claims;
+    QVERIFY(tokens.validate(token, claims));
+    QCOMPARE(claims.userId, quint32(42));
+    QCOMPARE(claims.issuedAt, now);
+    QCOMPARE(claims.expiresAt, expiresAt);
+    QCOMPARE(claims.deliveryEpoch, QString("abc"));
+}
+
+void ResumeTokensTest::testTamperedToken()
+{
+    ResumeTokens tokens("secret", 60000);
+    QString token = tokens.issue(42, "abc");
+    ResumeTokens::Claims claims;
+
+    // Zmieniony ładunek lub podpis
+    QString tampered = token;
+    tampered[0] = tampered[0] == 'A' ? 'B' : 'A';
+    QVERIFY(!tokens.validate(tampered, claims));
+    tampered = token;
+    int signature = token.indexOf('.') + 1;
+    tampered[signature] = tampered[signature] == 'A' ? 'B' : 'A';
+    QVERIFY(!tokens.validate(tampered, claims));
+
+    // Inny sekret, śmieci
+    ResumeTokens other("other", 60000);
+    QVERIFY(!other.validate(token, claims));
+    QVERIFY(!tokens.validate("", claims));
+    QVERIFY(!tokens.validate("not-a-token", claims));
+    QVERIFY(!tokens.validate(".", claims));
+}
+
+void ResumeTokensTest::testExpiry()
+{
+    qint64 now = 1760000000000;
+    ResumeTokens tokens("secret", 60000, [&now]() { return now; });
+    QString token = tokens.issue(7, QString());
+    ResumeTokens::Claims claims;
+
+    now += 59999;
+    QVERIFY(tokens.validate(token, claims));
+    now += 1;
+    QVERIFY(!tokens.validate(token, claims));
+}
+
+void ResumeTokensTest::testRevoke()
+{
+    qint64 now = 1760000000000;
+    ResumeTokens tokens("secret", 60000, [&now]() { return now; });
+    QString token = tokens.issue(7, QString());
+    QString otherUser = tokens.issue(8, QString());
+    ResumeTokens::Claims claims;
+
+    now += 10;
+    tokens.revoke(7);
+    QVERIFY(!tokens.validate(token, claims));
+    QVERIFY(tokens.validate(otherUser, claims));
+
+    // Token wydany po wylogowaniu jest ważny, także w tej samej milisekundzie
+    QVERIFY(tokens.validate(tokens.issue(7, QString()), claims));
+    now += 10;
+    QVERIFY(tokens.validate(tokens.issue(7, QString()), claims));
+}
@@ -0,0 +1,25 @@
+/**
+ * @file ResumeTokensTest.h
+ * @brief ResumeTokens test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef RESUMETOKENSTEST_H
+#define RESUMETOKENSTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class ResumeTokensTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip();
+    void testTamperedToken();
+    void testExpiry();
+    void testRevoke();
+};
+
+#endif // RESUMETOKENSTEST_H
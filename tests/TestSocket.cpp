@@ -89,6 +89,32 @@ qint64 TestSocket::writeData(const char *data, qint64 maxSize)
     return maxSize;
 }
 
+QList<QByteArray> TestSocket::splitDocuments(const QByteArray& data)
+{
+    QList<QByteArray> documents;
+    QByteArray rest = data.trimmed();
+
+    while (!rest.isEmpty()) {
+        QJsonParseError error;
+        QJsonDocument::fromJson(rest, &error);
+
+        if (error.error == QJsonParseError::NoError) {
+            documents.append(rest);
+            break;
+        }
+        if (error.error != QJsonParseError::GarbageAtEnd) {
+            // Nie JSON - zwracamy resztę bez zmian, niech porównanie zawiedzie
+            documents.append(rest);
+            break;
+        }
+
+        documents.append(rest.left(error.offset));
+        rest = rest.mid(error.offset).trimmed();
+    }
+
+    return documents;
+}
+
 bool TestSocket::waitForResponse(int timeout)
 {
     qDebug() << QString("[%1] TestSocket::waitForResponse - Starting wait with timeout: %2ms")
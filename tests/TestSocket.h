@@ -25,15 +25,20 @@ public:
     }
 
     QByteArray getResponse(const QString& type) {
-        for (const QByteArray& response : writtenData) {
-            QJsonDocument doc = QJsonDocument::fromJson(response);
-            if (doc.isObject() && doc.object()["type"].toString() == type) {
-                return response;
+        for (const QByteArray& written : writtenData) {
+            for (const QByteArray& response : splitDocuments(written)) {
+                QJsonDocument doc = QJsonDocument::fromJson(response);
+                if (doc.isObject() && doc.object()["type"].toString() == type) {
+                    return response;
+                }
             }
         }
         return QByteArray();
     }
 
+    // Sesja skleja kilka odpowiedzi w jeden zapis - dzielimy go na dokumenty JSON
+    static QList<QByteArray> splitDocuments(const QByteArray& data);
+
 protected:
     qint64 writeData(const char *data, qint64 maxSize) override;
     qint64 readData(char *data, qint64 maxSize) override;
@@ -0,0 +1,76 @@
+/**
+ * @file TimingWheelTest.cpp
+ * @brief TimingWheel test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "TimingWheelTest.h"
+#include "server/TimingWheel.h"
+
+// Takt sekundowy - zegar koła nie zdąży się przesunąć w trakcie testu,
+// więc czas wyznacza wyłącznie advance()
+static constexpr int TICK_MS = 1000;
+
+void TimingWheelTest::testFiresAfterDelay()
+{
+    TimingWheel wheel(TICK_MS);
+    int fired = 0;
+    wheel.schedule(3500, [&fired]() { ++fired; });
+    QCOMPARE(wheel.pending(), 1);
+
+    wheel.advance(3);
+    QCOMPARE(fired, 0);
+    wheel.advance(1);
+    QCOMPARE(fired, 1);
+    QCOMPARE(wheel.pending(), 0);
+}
+
+void TimingWheelTest::testCancel()
+{
+    TimingWheel wheel(TICK_MS);
+    int fired = 0;
+    TimingWheel::TimerId first = wheel.schedule(2 * TICK_MS, [&fired]() { fired += 1; });
+    wheel.schedule(2 * TICK_MS, [&fired]() { fired += 10; });
+
+    QVERIFY(wheel.cancel(first));
+    QVERIFY(!wheel.cancel(first));
+    wheel.advance(2);
+    QCOMPARE(fired, 10);
+}
+
+void TimingWheelTest::testCascadesLongDelays()
+{
+    TimingWheel wheel(TICK_MS);
+    // Poziom 1, poziom 2 i termin poza zasięgiem koła
+    const QList<qint64> delays{300, 20000, 2000000};
+    QList<qint64> firedAt;
+    qint64 now = 0;
+
+    for (qint64 delay : delays) {
+        wheel.schedule(delay * TICK_MS, [&firedAt, &now]() { firedAt.append(now); });
+    }
+
+    while (wheel.pending() > 0 && now <= delays.last()) {
+        ++now;
+        wheel.advance(1);
+    }
+
+    QCOMPARE(firedAt, delays);
+}
+
+void TimingWheelTest::testRescheduleFromCallback()
+{
+    TimingWheel wheel(TICK_MS);
+    int fired = 0;
+    std::function<void()> periodic = [&]() {
+        if (++fired < 3) {
+            wheel.schedule(TICK_MS, periodic);
+        }
+    };
+    wheel.schedule(TICK_MS, periodic);
+
+    wheel.advance(10);
+    QCOMPARE(fired, 3);
+    QCOMPARE(wheel.pending(), 0);
+}
@@ -0,0 +1,25 @@
+/**
+ * @file TimingWheelTest.h
+ * @brief TimingWheel test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef TIMINGWHEELTEST_H
+#define TIMINGWHEELTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class TimingWheelTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testFiresAfterDelay();
+    void testCancel();
+    void testCascadesLongDelays();
+    void testRescheduleFromCallback();
+};
+
+#endif // TIMINGWHEELTEST_H
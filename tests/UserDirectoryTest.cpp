@@ -0,0 +1,65 @@
+/**
+ * @file UserDirectoryTest.cpp
+ * @brief UserDirectory test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "UserDirectoryTest.h"
+#include "database/UserDirectory.h"
+
+void UserDirectoryTest::testLookups()
+{
+    UserDirectory directory([]() { return qint64(0); });
+    directory.build({{1, "alice"}, {2, "Bob"}});
+    QCOMPARE(directory.size(), 2);
+
+    QString username;
+    QCOMPARE(directory.username(2, username), UserDirectory::Lookup::Found);
+    QCOMPARE(username, QString("Bob"));
+    QCOMPARE(directory.username(3, username), UserDirectory::Lookup::Unknown);
+
+    // Nazwy porównywane jak w bazie - bez rozróżniania wielkości liter
+    quint32 userId = 0;
+    QCOMPARE(directory.userId("bob", userId), UserDirectory::Lookup::Found);
+    QCOMPARE(userId, 2u);
+    QCOMPARE(directory.userId("carol", userId), UserDirectory::Lookup::Unknown);
+}
+
+void UserDirectoryTest::testNegativeExpiry()
+{
+    qint64 now = 1000;
+    UserDirectory directory([&now]() { return now; });
+
+    directory.addMissing(7);
+    directory.addMissing(QString("ghost"));
+
+    QString username;
+    quint32 userId = 0;
+    QCOMPARE(directory.username(7, username), UserDirectory::Lookup::Missing);
+    QCOMPARE(directory.userId("Ghost", userId), UserDirectory::Lookup::Missing);
+
+    now += UserDirectory::NEGATIVE_TTL_MS;
+    QCOMPARE(directory.username(7, username), UserDirectory::Lookup::Unknown);
+    QCOMPARE(directory.userId("ghost", userId), UserDirectory::Lookup::Unknown);
+}
+
+void UserDirectoryTest::testAddClearsNegative()
+{
+    UserDirectory directory([]() { return qint64(0); });
+    directory.addMissing(5);
+    directory.addMissing(QString("dave"));
+
+    directory.add(5, "dave");
+
+    QString username;
+    quint32 userId = 0;
+    QCOMPARE(directory.username(5, username), UserDirectory::Lookup::Found);
+    QCOMPARE(username, QString("dave"));
+    QCOMPARE(directory.userId("dave", userId), UserDirectory::Lookup::Found);
+    QCOMPARE(userId, 5u);
+
+    // Znany użytkownik nie trafia do wpisów negatywnych
+    directory.addMissing(5);
+    QCOMPARE(directory.username(5, username), UserDirectory::Lookup::Found);
+}
@@ -0,0 +1,24 @@
+/**
+ * @file UserDirectoryTest.h
+ * @brief UserDirectory test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef USERDIRECTORYTEST_H
+#define USERDIRECTORYTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class UserDirectoryTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testLookups();
+    void testNegativeExpiry();
+    void testAddClearsNegative();
+};
+
+#endif // USERDIRECTORYTEST_H
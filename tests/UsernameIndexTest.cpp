@@ -0,0 +1,94 @@
+/**
+ * @file UsernameIndexTest.cpp
+ * @brief UsernameIndex test implementation
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#include "UsernameIndexTest.h"
+#include "database/UsernameIndex.h"
+
+namespace {
+
+QStringList names(const QVector<UserSearchResult>& results)
+{
+    QStringList list;
+    for (const UserSearchResult& result : results) {
+        list.append(result.username);
+    }
+    return list;
+}
+
+}
+
+void UsernameIndexTest::testSubstringSearch()
+{
+    UsernameIndex index;
+    index.build({{1, "zed_smith"}, {2, "Anna"}, {3, "johnsmith"}, {4, "smithy"}, {5, "bob"}});
+
+    // Wyniki alfabetycznie, bez rozróżniania wielkości liter
+    QCOMPARE(names(index.search("SMITH", false, 20)),
+             QStringList({"johnsmith", "smithy", "zed_smith"}));
+    QCOMPARE(names(index.search("nn", false, 20)), QStringList({"Anna"}));
+    QCOMPARE(names(index.search("o", false, 20)), QStringList({"bob", "johnsmith"}));
+    QVERIFY(index.search("xyz", false, 20).isEmpty());
+    // Znaki specjalne LIKE są zwykłymi znakami
+    QCOMPARE(names(index.search("d_s", false, 20)), QStringList({"zed_smith"}));
+    QVERIFY(index.search("d%s", false, 20).isEmpty());
+}
+
+void UsernameIndexTest::testPrefixSearch()
+{
+    UsernameIndex index;
+    index.build({{1, "alice"}, {2, "Alfred"}, {3, "malice"}, {4, "bob"}});
+
+    QCOMPARE(names(index.search("al", true, 20)), QStringList({"Alfred", "alice"}));
+    QCOMPARE(names(index.search("ali", true, 20)), QStringList({"alice"}));
+    QVERIFY(index.search("c", true, 20).isEmpty());
+
+    QVERIFY(UsernameIndex::matches("Alice", "ali", true));
+    QVERIFY(!UsernameIndex::matches("malice", "ali", true));
+    QVERIFY(UsernameIndex::matches("malice", "ali", false));
+}
+
+void UsernameIndexTest::testLimitAndCompleteness()
+{
+    QVector<QPair<quint32, QString>> users;
+    for (quint32 id = 1; id <= 50; ++id) {
+        users.append({id, QString("user%1").arg(id, 2, 10, QChar('0'))});
+    }
+    UsernameIndex index;
+    index.build(users);
+
+    bool complete = true;
+    QVector<UserSearchResult> results = index.search("user", false, 20, &complete);
+    QCOMPARE(results.size(), 20);
+    QVERIFY(!complete);
+    QCOMPARE(results.first().username, QString("user01"));
+    QCOMPARE(results.last().username, QString("user20"));
+
+    results = index.search("user4", true, 20, &complete);
+    QCOMPARE(results.size(), 10);
+    QVERIFY(complete);
+}
+
+void UsernameIndexTest::testRegistrationsAndCompaction()
+{
+    UsernameIndex index;
+    index.add(1, "ignored");  // przed wczytaniem
+    index.build({{1, "carol"}, {2, "dave"}});
+    QCOMPARE(index.size(), 2);
+
+    quint64 revision = index.revision();
+    index.add(3, "caroline");
+    QVERIFY(index.revision() != revision);
+    QCOMPARE(names(index.search("car", false, 20)), QStringList({"carol", "caroline"}));
+    QCOMPARE(names(index.search("line", false, 20)), QStringList({"caroline"}));
+
+    for (int i = 0; i < UsernameIndex::COMPACT_THRESHOLD; ++i) {
+        index.add(100 + i, QString("member%1").arg(i, 4, 10, QChar('0')));
+    }
+    QCOMPARE(index.size(), 3 + UsernameIndex::COMPACT_THRESHOLD);
+    QCOMPARE(names(index.search("ember0001", false, 20)), QStringList({"member0001"}));
+    QCOMPARE(names(index.search("carol", true, 20)), QStringList({"carol", "caroline"}));
+}
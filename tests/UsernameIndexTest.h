@@ -0,0 +1,25 @@
+/**
+ * @file UsernameIndexTest.h
+ * @brief UsernameIndex test class definition
+ * @author piotrek-pl
+ * @date 2026-10-15
+ */
+
+#ifndef USERNAMEINDEXTEST_H
+#define USERNAMEINDEXTEST_H
+
+#include <QObject>
+#include <QtTest>
+
+class UsernameIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSubstringSearch();
+    void testPrefixSearch();
+    void testLimitAndCompleteness();
+    void testRegistrationsAndCompaction();
+};
+
+#endif // USERNAMEINDEXTEST_H
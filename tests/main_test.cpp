@@ -8,6 +8,15 @@
 #include <QCoreApplication>
 #include <QTest>
 #include "ProtocolTest.h"
+#include "FrameCodecTest.h"
+#include "TimingWheelTest.h"
+#include "MessageIdGeneratorTest.h"
+#include "ResumeTokensTest.h"
+#include "FriendGraphTest.h"
+#include "RecentMessageCacheTest.h"
+#include "UserDirectoryTest.h"
+#include "UsernameIndexTest.h"
+#include "MessageJournalTest.h"
 #include "ClientSessionTest.h"
 
 int main(int argc, char *argv[])
@@ -21,6 +30,51 @@ int main(int argc, char *argv[])
         status |= QTest::qExec(&tc, argc, argv);
     }
 
+    {
+        FrameCodecTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        TimingWheelTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        MessageIdGeneratorTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        ResumeTokensTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        FriendGraphTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        RecentMessageCacheTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        UserDirectoryTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        UsernameIndexTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
+    {
+        MessageJournalTest tc;
+        status |= QTest::qExec(&tc, argc, argv);
+    }
+
     {
         ClientSessionTest tc;
         status |= QTest::qExec(&tc, argc, argv);